@@ -0,0 +1,185 @@
+#include "acpi.h"
+#include "print/print.h"
+#include "config.h"
+#include "status.h"
+#include <stdbool.h>
+
+#define ACPI_EBDA_SEGMENT_PTR	0x40E		// BIOS data area word holding the EBDA's real mode segment
+#define ACPI_EBDA_SEARCH_LEN	1024
+#define ACPI_BIOS_START		0x000E0000
+#define ACPI_BIOS_END		0x00100000
+
+#define MADT_LOCAL_APIC		0
+#define MADT_IO_APIC		1
+#define MADT_LAPIC_ENABLED	(1 << 0)
+
+/* Refer to the ACPI specification, chapter 5.2 */
+struct acpi_rsdp {
+	char signature[8];		// "RSD PTR ", on a 16 byte boundary
+	uint8_t checksum;		// covers the first 20 bytes
+	char oem_id[6];
+	uint8_t revision;
+	uint32_t rsdt_address;
+} __attribute__((packed));
+
+struct acpi_sdt_header {
+	char signature[4];
+	uint32_t length;		// of the whole table, header included
+	uint8_t revision;
+	uint8_t checksum;		// covers the whole table
+	char oem_id[6];
+	char oem_table_id[8];
+	uint32_t oem_revision;
+	uint32_t creator_id;
+	uint32_t creator_revision;
+} __attribute__((packed));
+
+struct acpi_madt {
+	struct acpi_sdt_header header;
+	uint32_t lapic_address;
+	uint32_t flags;
+	/* variable length entries follow, each starting with struct madt_entry */
+} __attribute__((packed));
+
+struct madt_entry {
+	uint8_t type;
+	uint8_t length;
+} __attribute__((packed));
+
+struct madt_local_apic {
+	struct madt_entry entry;
+	uint8_t processor_id;
+	uint8_t apic_id;
+	uint32_t flags;
+} __attribute__((packed));
+
+struct madt_io_apic {
+	struct madt_entry entry;
+	uint8_t io_apic_id;
+	uint8_t reserved;
+	uint32_t address;
+	uint32_t gsi_base;
+} __attribute__((packed));
+
+static uint8_t cpu_apic_ids[CONFIG_MAX_CPUS];
+static int cpu_count = 0;
+static uint32_t ioapic_address = 0;
+
+/* Every ACPI structure is valid only if its bytes sum to 0 */
+static bool acpi_checksum_ok(const void *table, uint32_t len)
+{
+	const uint8_t *bytes = table;
+	uint8_t sum = 0;
+
+	for (uint32_t i = 0; i < len; i++) {
+		sum += bytes[i];
+	}
+	return sum == 0;
+}
+
+static bool acpi_signature_is(const char *signature, const char *expected, int len)
+{
+	for (int i = 0; i < len; i++) {
+		if (signature[i] != expected[i])
+			return false;
+	}
+	return true;
+}
+
+static struct acpi_rsdp *acpi_scan_rsdp(uint32_t start, uint32_t end)
+{
+	for (uint32_t addr = start; addr + sizeof(struct acpi_rsdp) <= end; addr += 16) {
+		struct acpi_rsdp *rsdp = (struct acpi_rsdp *)addr;
+		if (acpi_signature_is(rsdp->signature, "RSD PTR ", 8) && acpi_checksum_ok(rsdp, sizeof(*rsdp)))
+			return rsdp;
+	}
+	return 0;
+}
+
+/* The RSDP is either in the first KiB of the EBDA or in the BIOS rom area */
+static struct acpi_rsdp *acpi_find_rsdp()
+{
+	uint32_t ebda = (uint32_t)*(volatile uint16_t *)ACPI_EBDA_SEGMENT_PTR << 4;
+	struct acpi_rsdp *rsdp = 0;
+
+	if (ebda)
+		rsdp = acpi_scan_rsdp(ebda, ebda + ACPI_EBDA_SEARCH_LEN);
+	if (!rsdp)
+		rsdp = acpi_scan_rsdp(ACPI_BIOS_START, ACPI_BIOS_END);
+	return rsdp;
+}
+
+static struct acpi_sdt_header *acpi_find_table(struct acpi_rsdp *rsdp, const char *signature)
+{
+	struct acpi_sdt_header *rsdt = (struct acpi_sdt_header *)rsdp->rsdt_address;
+	uint32_t *entries = (uint32_t *)(rsdt + 1);
+	int count;
+
+	if (!acpi_signature_is(rsdt->signature, "RSDT", 4) || !acpi_checksum_ok(rsdt, rsdt->length))
+		return 0;
+
+	count = (rsdt->length - sizeof(*rsdt)) / sizeof(uint32_t);
+	for (int i = 0; i < count; i++) {
+		struct acpi_sdt_header *table = (struct acpi_sdt_header *)entries[i];
+		if (acpi_signature_is(table->signature, signature, 4) && acpi_checksum_ok(table, table->length))
+			return table;
+	}
+	return 0;
+}
+
+static void acpi_parse_madt(struct acpi_madt *madt)
+{
+	uint8_t *pos = (uint8_t *)(madt + 1);
+	uint8_t *end = (uint8_t *)madt + madt->header.length;
+
+	while (pos + sizeof(struct madt_entry) <= end) {
+		struct madt_entry *entry = (struct madt_entry *)pos;
+		if (entry->length < sizeof(struct madt_entry))
+			break;			// malformed, don't loop forever
+
+		if (entry->type == MADT_LOCAL_APIC) {
+			struct madt_local_apic *lapic = (struct madt_local_apic *)entry;
+			if ((lapic->flags & MADT_LAPIC_ENABLED) && cpu_count < CONFIG_MAX_CPUS)
+				cpu_apic_ids[cpu_count++] = lapic->apic_id;
+		} else if (entry->type == MADT_IO_APIC && !ioapic_address) {
+			ioapic_address = ((struct madt_io_apic *)entry)->address;
+		}
+
+		pos += entry->length;
+	}
+}
+
+int acpi_init()
+{
+	struct acpi_rsdp *rsdp = acpi_find_rsdp();
+	struct acpi_sdt_header *madt;
+
+	if (!rsdp)
+		return -ENODEV;
+
+	madt = acpi_find_table(rsdp, "APIC");
+	if (!madt)
+		return -ENODEV;
+
+	acpi_parse_madt((struct acpi_madt *)madt);
+
+	print("ACPI: ");
+	print_dec(cpu_count);
+	print(" processors\n");
+	return 0;
+}
+
+int acpi_cpu_count()
+{
+	return cpu_count;
+}
+
+uint8_t acpi_cpu_apic_id(int i)
+{
+	return cpu_apic_ids[i];
+}
+
+uint32_t acpi_ioapic_address()
+{
+	return ioapic_address;
+}
@@ -0,0 +1,30 @@
+/* acpi.h
+ * just enough ACPI table parsing to find the processors and the io apic (the MADT)
+ */
+
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+/*
+ * acpi_init - find the RSDP, walk the RSDT and read the processors out of the MADT
+ *
+ * Returns 0 on success, -ENODEV if the firmware has no ACPI tables or no MADT.  Without
+ * them the kernel only knows about the processor it is running on.
+ *
+ * prereq - paging is set up (the tables live wherever the firmware put them, we rely on
+ * the identity map to reach them)
+ */
+int acpi_init();
+
+/* Number of enabled processors in the MADT, including the one we booted on.  0 before acpi_init */
+int acpi_cpu_count();
+
+/* Local apic id of the ith enabled processor in the MADT, in table order */
+uint8_t acpi_cpu_apic_id(int i);
+
+/* Physical address of the first io apic in the MADT, 0 if there was none */
+uint32_t acpi_ioapic_address();
+
+#endif /* ACPI_H */
@@ -0,0 +1,214 @@
+#include "apic.h"
+#include "cpu/cpu.h"
+#include "pic/pic.h"
+#include "idt/irq.h"
+#include "memory/paging/paging.h"
+#include "acpi/acpi.h"
+#include "config.h"
+#include "status.h"
+#include "lib/atomic.h"
+
+#define APIC_BASE_ENABLE	(1 << 11)	// global enable bit in IA32_APIC_BASE
+#define APIC_BASE_ADDR_MASK	0xfffff000
+
+/* Local apic registers, as byte offsets into its mmio window (refer to the Intel SDM, vol 3 chapter 10) */
+#define LAPIC_REG_ID		0x020
+#define LAPIC_REG_TPR		0x080
+#define LAPIC_REG_EOI		0x0B0
+#define LAPIC_REG_SVR		0x0F0
+#define LAPIC_REG_ICR_LOW	0x300		// writing the low half sends the ipi
+#define LAPIC_REG_ICR_HIGH	0x310		// destination apic id in bits 24-31
+#define LAPIC_REG_LVT_TIMER	0x320
+#define LAPIC_REG_LVT_LINT0	0x350
+#define LAPIC_REG_LVT_ERROR	0x370
+#define LAPIC_REG_TIMER_INIT	0x380
+#define LAPIC_REG_TIMER_CURRENT	0x390
+#define LAPIC_REG_TIMER_DIVIDE	0x3E0
+#define LAPIC_SVR_ENABLE	0x100
+#define LAPIC_LVT_MASKED	(1 << 16)
+#define LAPIC_TIMER_PERIODIC	(1 << 17)
+#define LAPIC_TIMER_DIVIDE_16	0x3
+#define LAPIC_ICR_INIT		0x00000500
+#define LAPIC_ICR_STARTUP	0x00000600
+#define LAPIC_ICR_PENDING	(1 << 12)	// delivery status: the last ipi hasn't been accepted yet
+#define LAPIC_ICR_ASSERT	(1 << 14)
+
+/* The io apic is accessed indirectly: write a register number to IOREGSEL, then access IOWIN */
+#define IOAPIC_IOREGSEL		0x00
+#define IOAPIC_IOWIN		0x10
+#define IOAPIC_REG_VER		0x01
+#define IOAPIC_REG_REDTBL	0x10		// two 32 bit registers per pin
+#define IOAPIC_REDIR_MASKED	(1 << 16)
+#define IOAPIC_ISA_IRQS		16
+
+static volatile uint32_t *lapic = 0;
+static volatile uint32_t *ioapic = 0;
+static bool apic_active = false;
+static int ioapic_pins = 0;
+
+/* ISA irq -> io apic pin.  Identity except for the PIT, which almost every chipset (and QEMU)
+ * wires to pin 2 since pin 0 carries the PIC's ExtINT
+ */
+static uint8_t ioapic_isa_pin[IOAPIC_ISA_IRQS] = {
+	2, 1, 0, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+static uint32_t lapic_read(uint32_t reg)
+{
+	return lapic[reg / sizeof(uint32_t)];
+}
+
+static void lapic_write(uint32_t reg, uint32_t val)
+{
+	lapic[reg / sizeof(uint32_t)] = val;
+}
+
+static uint32_t ioapic_read(uint32_t reg)
+{
+	ioapic[IOAPIC_IOREGSEL / sizeof(uint32_t)] = reg;
+	return ioapic[IOAPIC_IOWIN / sizeof(uint32_t)];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t val)
+{
+	ioapic[IOAPIC_IOREGSEL / sizeof(uint32_t)] = reg;
+	ioapic[IOAPIC_IOWIN / sizeof(uint32_t)] = val;
+}
+
+static void ioapic_write_redir(int pin, uint32_t low, uint32_t high)
+{
+	/* Write the high half (destination) first so the entry is never live with a stale destination */
+	ioapic_write(IOAPIC_REG_REDTBL + pin * 2 + 1, high);
+	ioapic_write(IOAPIC_REG_REDTBL + pin * 2, low);
+}
+
+/* Device registers must not be cached.  Our page tables identity map everything, so only the flags change */
+static void apic_map_mmio(uint32_t addr)
+{
+	void *page = (void *)(addr & PTE_PAGE_FRAME_ADDR);
+	paging_set(paging_current_pgd(), page, (uint32_t)page | PAGING_CACHE_DISABLE | PAGING_WRITE_THROUGH | PAGING_READ_WRITE | PAGING_PRESENT);
+	paging_invalidate(page);
+}
+
+void lapic_init_cpu()
+{
+	/* Accept every priority, stop taking PIC interrupts through LINT0 and software enable the local apic */
+	lapic_write(LAPIC_REG_TPR, 0);
+	lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | IRQ_SPURIOUS_VECTOR);
+}
+
+int apic_init()
+{
+	struct cpuid_regs regs;
+	uint64_t base;
+
+	if (!CONFIG_APIC)
+		return -ENODEV;
+
+	cpuid_read(CPUID_FEATURES, &regs);
+	if (!(regs.edx & CPUID_FEAT_EDX_APIC) || !(regs.edx & CPUID_FEAT_EDX_MSR))
+		return -ENODEV;
+
+	base = read_msr(MSR_IA32_APIC_BASE);
+	write_msr(MSR_IA32_APIC_BASE, base | APIC_BASE_ENABLE);
+	lapic = (volatile uint32_t *)(uint32_t)(base & APIC_BASE_ADDR_MASK);
+	ioapic = (volatile uint32_t *)(acpi_ioapic_address() ? acpi_ioapic_address() : IOAPIC_DEFAULT_BASE);
+	apic_map_mmio((uint32_t)lapic);
+	apic_map_mmio((uint32_t)ioapic);
+
+	lapic_init_cpu();
+
+	/* Bits 16-23 of the version register hold the index of the last redirection entry */
+	ioapic_pins = ((ioapic_read(IOAPIC_REG_VER) >> 16) & 0xff) + 1;
+	for (int pin = 0; pin < ioapic_pins; pin++) {
+		ioapic_write_redir(pin, IOAPIC_REDIR_MASKED | (IRQ_VECTOR_BASE + pin), 0);
+	}
+
+	pic_disable();
+	apic_active = true;
+	return 0;
+}
+
+bool apic_enabled()
+{
+	return apic_active;
+}
+
+void lapic_eoi()
+{
+	lapic[LAPIC_REG_EOI / sizeof(uint32_t)] = 0;
+}
+
+uint32_t lapic_id()
+{
+	return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+void ioapic_unmask(int irq)
+{
+	int pin = ioapic_isa_pin[irq];
+	if (pin >= ioapic_pins)
+		return;
+
+	/* Fixed delivery, physical destination, active high, edge triggered - the ISA defaults */
+	ioapic_write_redir(pin, IRQ_VECTOR_BASE + irq, lapic_id() << 24);
+}
+
+void ioapic_mask(int irq)
+{
+	int pin = ioapic_isa_pin[irq];
+	if (pin >= ioapic_pins)
+		return;
+
+	ioapic_write_redir(pin, IOAPIC_REDIR_MASKED | (IRQ_VECTOR_BASE + irq), lapic_id() << 24);
+}
+
+void lapic_timer_start(uint32_t count, bool periodic)
+{
+	uint32_t lvt = LAPIC_TIMER_VECTOR;
+	if (periodic)
+		lvt |= LAPIC_TIMER_PERIODIC;
+
+	lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+	lapic_write(LAPIC_REG_LVT_TIMER, lvt);
+	lapic_write(LAPIC_REG_TIMER_INIT, count);	// writing the initial count starts the countdown
+}
+
+void lapic_timer_stop()
+{
+	lapic_write(LAPIC_REG_TIMER_INIT, 0);
+	lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+}
+
+uint32_t lapic_timer_current()
+{
+	return lapic_read(LAPIC_REG_TIMER_CURRENT);
+}
+
+static void lapic_send_icr(uint32_t apic_id, uint32_t low)
+{
+	lapic_write(LAPIC_REG_ICR_HIGH, apic_id << 24);
+	lapic_write(LAPIC_REG_ICR_LOW, low);
+
+	while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING) {
+		cpu_relax();
+	}
+}
+
+void lapic_send_init(uint32_t apic_id)
+{
+	lapic_send_icr(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+}
+
+void lapic_send_startup(uint32_t apic_id, uint32_t start_addr)
+{
+	/* The vector field holds the page number of the real mode start address */
+	lapic_send_icr(apic_id, LAPIC_ICR_STARTUP | LAPIC_ICR_ASSERT | (start_addr >> 12));
+}
+
+void lapic_send_ipi(uint32_t apic_id, int vector)
+{
+	lapic_send_icr(apic_id, LAPIC_ICR_ASSERT | vector);
+}
@@ -0,0 +1,67 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt/irq.h"
+
+#define LAPIC_DEFAULT_BASE	0xFEE00000
+#define IOAPIC_DEFAULT_BASE	0xFEC00000
+
+#define LAPIC_TIMER_VECTOR	(IRQ_LOCAL_VECTOR_BASE + 0)
+#define IPI_WAKEUP_VECTOR	(IRQ_LOCAL_VECTOR_BASE + 1)	// no handler, it only needs to end a hlt
+
+/*
+ * apic_init - switch interrupt delivery from the 8259 PICs to the local and io apics
+ *
+ * Detects the local apic through cpuid and the IA32_APIC_BASE msr, enables it, masks every
+ * io apic pin and masks the PICs.  Returns -ENODEV (leaving the PICs in charge) if there is
+ * no usable apic.
+ *
+ * prereq - paging is set up, since the register windows get remapped uncached, and acpi_init()
+ * has had a chance to find the io apic
+ */
+int apic_init();
+
+/* Set up the calling cpu's local apic.  apic_init does this for the boot cpu */
+void lapic_init_cpu();
+
+/* True once apic_init succeeded and the io apic is routing interrupts */
+bool apic_enabled();
+
+/* Acknowledge the interrupt currently being serviced by this cpu's local apic */
+void lapic_eoi();
+
+/* Id of the local apic of the calling cpu */
+uint32_t lapic_id();
+
+/* Route isa irq (0-15) to its vector on this cpu and unmask it */
+void ioapic_unmask(int irq);
+
+/* Mask isa irq (0-15) at the io apic */
+void ioapic_mask(int irq);
+
+/*
+ * lapic_timer_start - start this cpu's local apic timer
+ *
+ * The timer counts down from count at the bus clock divided by 16 and raises LAPIC_TIMER_VECTOR
+ * when it reaches 0.  A periodic timer reloads count and keeps going.
+ */
+void lapic_timer_start(uint32_t count, bool periodic);
+
+/* Stop and mask the local apic timer */
+void lapic_timer_stop();
+
+/* Current value of the local apic timer's down counter */
+uint32_t lapic_timer_current();
+
+/* Send an INIT ipi, which resets the processor with local apic id apic_id to wait for a startup ipi */
+void lapic_send_init(uint32_t apic_id);
+
+/* Send a startup ipi, which starts apic_id in real mode at start_addr (page aligned, below 1 MiB) */
+void lapic_send_startup(uint32_t apic_id, uint32_t start_addr);
+
+/* Raise interrupt vector on the processor with local apic id apic_id */
+void lapic_send_ipi(uint32_t apic_id, int vector);
+
+#endif /* APIC_H */
@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "print/print.h"
+#include "timer/clock.h"
+
+static uint32_t bench_seed = 2463534242U;
+
+void bench_report(const char *name, uint64_t value, const char *unit)
+{
+	print(name);
+	print(": ");
+	print_dec(value);
+	print(" ");
+	print(unit);
+	print("\n");
+}
+
+/* xorshift32 */
+uint32_t bench_rand()
+{
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+	return bench_seed;
+}
+
+/* Shell sort, samples are too few for anything smarter to matter */
+static void bench_sort(uint32_t *samples, int n)
+{
+	for (int gap = n / 2; gap > 0; gap /= 2) {
+		for (int i = gap; i < n; i++) {
+			uint32_t val = samples[i];
+			int j;
+			for (j = i; j >= gap && samples[j - gap] > val; j -= gap) {
+				samples[j] = samples[j - gap];
+			}
+			samples[j] = val;
+		}
+	}
+}
+
+static void bench_report_percentile(const char *label, uint32_t cycles)
+{
+	print(label);
+	print_dec(cycles);
+	print(" (");
+	print_dec(cycles_to_ns(cycles));
+	print(" ns)");
+}
+
+void bench_report_histogram(const char *name, uint32_t *samples, int n)
+{
+	if (n <= 0)
+		return;
+
+	bench_sort(samples, n);
+
+	print(name);
+	print(" cycles:");
+	bench_report_percentile(" min ", samples[0]);
+	bench_report_percentile(" p50 ", samples[n / 2]);
+	bench_report_percentile(" p99 ", samples[n * 99 / 100]);
+	bench_report_percentile(" max ", samples[n - 1]);
+	print("\n");
+}
@@ -0,0 +1,56 @@
+/* bench.h
+ * in kernel benchmarks.  kernel_main runs them at boot when CONFIG_BENCHMARKS is set
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+/* Print "name: value unit" on its own line */
+void bench_report(const char *name, uint64_t value, const char *unit);
+
+/*
+ * bench_report_histogram - sort samples (tsc cycles) in place and print their min, p50, p99
+ * and max, in cycles and nanoseconds
+ */
+void bench_report_histogram(const char *name, uint32_t *samples, int n);
+
+/* Cheap deterministic pseudo random numbers, so runs are comparable */
+uint32_t bench_rand();
+
+/* Timer wheel vs a sorted list baseline, with BENCH_TIMERS armed timers */
+void bench_timer_wheel();
+
+/* Interrupt latency and jitter: deadline to handler entry, and handler exit back to the
+ * interrupted code, using the timer's tick source in one shot mode
+ */
+void bench_irq_latency();
+
+/* Memset a large buffer on one cpu, then split across every online cpu, to show the cores scale */
+void bench_smp_memset();
+
+/* Every lock type taken by every online cpu at once, each running the same critical section */
+void bench_locks();
+
+/* Build a full set of page tables with the task pool on 1, 2, ... up to every online cpu */
+void bench_task_pool();
+
+/* Null system call round trip from ring 3, through int 0x80 and through sysenter */
+void bench_syscall();
+
+/* Reading the time from ring 3 through the vdso */
+void bench_vdso();
+
+/* Round trip of a short ipc call and reply between two processes */
+void bench_ipc();
+
+/* Start up to exit of a process that touches one page, from a small and a large ELF executable
+ * (demand paged) and from the same text as a flat image (copied in up front)
+ */
+void bench_elf_exec();
+
+/* Pipe throughput between two processes, with page aligned buffers and with unaligned ones */
+void bench_pipe();
+
+#endif /* BENCH_H */
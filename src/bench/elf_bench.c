@@ -0,0 +1,131 @@
+#include "bench.h"
+#include "loader/elf.h"
+#include "task/process.h"
+#include "disk/disk.h"
+#include "timer/clock.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "print/print.h"
+#include "config.h"
+#include <stdbool.h>
+
+/* Text sizes to start, the small one is a single page */
+#define ELF_BENCH_SMALL_PAGES		1
+#define ELF_BENCH_LARGE_PAGES		256		// 1 MiB
+#define ELF_BENCH_SECTORS_PER_PAGE	(PAGING_PAGE_SIZE / DISK_SECTOR_SIZE)
+
+/* The executable goes at the end of the disk's data area, clear of whatever init is at its start */
+#define ELF_BENCH_LBA	(DISK_DATA_LBA + DISK_DATA_SECTORS - (1 + ELF_BENCH_LARGE_PAGES) * ELF_BENCH_SECTORS_PER_PAGE)
+
+extern uint8_t elf_bench_start[];
+extern uint8_t elf_bench_end[];
+
+/* A page of headers, then pages of text that start with elf_bench_start.  Text is read only, so
+ * the loader maps it through the page cache
+ */
+static void elf_bench_build(uint8_t *file, uint32_t pages)
+{
+	struct elf_header *header = (struct elf_header *)file;
+	struct elf_program_header *ph = (struct elf_program_header *)(file + sizeof(struct elf_header));
+
+	memset(file, 0, (1 + pages) * PAGING_PAGE_SIZE);
+
+	header->magic = ELF_MAGIC;
+	header->class = ELF_CLASS_32;
+	header->data = ELF_DATA_LSB;
+	header->ident_version = 1;
+	header->type = ELF_TYPE_EXEC;
+	header->machine = ELF_MACHINE_386;
+	header->version = 1;
+	header->entry = PROCESS_USER_START;
+	header->phoff = sizeof(struct elf_header);
+	header->ehsize = sizeof(struct elf_header);
+	header->phentsize = sizeof(struct elf_program_header);
+	header->phnum = 1;
+
+	ph->type = ELF_PT_LOAD;
+	ph->offset = PAGING_PAGE_SIZE;
+	ph->vaddr = PROCESS_USER_START;
+	ph->paddr = PROCESS_USER_START;
+	ph->filesz = pages * PAGING_PAGE_SIZE;
+	ph->memsz = pages * PAGING_PAGE_SIZE;
+	ph->flags = ELF_PF_R | ELF_PF_X;
+	ph->align = PAGING_PAGE_SIZE;
+
+	memcpy(file + PAGING_PAGE_SIZE, elf_bench_start, elf_bench_end - elf_bench_start);
+}
+
+static int elf_bench_write(uint8_t *file, uint32_t pages)
+{
+	uint32_t sectors = (1 + pages) * ELF_BENCH_SECTORS_PER_PAGE;
+
+	for (uint32_t done = 0; done < sectors; done += DISK_MAX_SECTORS) {
+		uint32_t n = sectors - done < DISK_MAX_SECTORS ? sectors - done : DISK_MAX_SECTORS;
+		int res = disk_write_block(disk_get(0), ELF_BENCH_LBA + done, n, file + done * DISK_SECTOR_SIZE);
+		if (res < 0)
+			return res;
+	}
+
+	return 0;
+}
+
+/* Wait for a process to exit, false if it didn't start or failed */
+static bool elf_bench_wait(int pid)
+{
+	int code;
+
+	if (pid < 0)
+		return false;
+
+	process_wait(pid, &code);
+	return code == 0;
+}
+
+/* Time from asking for the process to it having exited, for pages of text as an ELF executable
+ * and as a flat image
+ */
+static void elf_bench_run(uint8_t *file, uint32_t pages, const char *elf_name, const char *flat_name)
+{
+	uint64_t start, elf_ns, flat_ns;
+	bool ok;
+
+	elf_bench_build(file, pages);
+	if (elf_bench_write(file, pages) < 0) {
+		print("elf bench: couldn't write the executable\n");
+		return;
+	}
+
+	/* Demand paged: the headers, then the one page of text it touches */
+	start = ktime_ns();
+	ok = elf_bench_wait(elf_exec("elf bench", ELF_BENCH_LBA, 0));
+	elf_ns = ktime_ns() - start;
+
+	/* The baseline copies all of it in before the process runs */
+	start = ktime_ns();
+	ok = elf_bench_wait(process_create("flat bench", file + PAGING_PAGE_SIZE, pages * PAGING_PAGE_SIZE, 0)) && ok;
+	flat_ns = ktime_ns() - start;
+
+	if (!ok) {
+		print("elf bench: a process didn't run\n");
+		return;
+	}
+
+	bench_report(elf_name, elf_ns, "ns");
+	bench_report(flat_name, flat_ns, "ns");
+}
+
+void bench_elf_exec()
+{
+	uint8_t *file = kmalloc((1 + ELF_BENCH_LARGE_PAGES) * PAGING_PAGE_SIZE);
+
+	if (!file) {
+		print("elf bench: out of memory\n");
+		return;
+	}
+
+	elf_bench_run(file, ELF_BENCH_SMALL_PAGES, "elf start up 4 KiB", "flat start up 4 KiB");
+	elf_bench_run(file, ELF_BENCH_LARGE_PAGES, "elf start up 1 MiB", "flat start up 1 MiB");
+
+	kfree(file);
+}
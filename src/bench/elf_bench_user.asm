@@ -0,0 +1,19 @@
+section .asm
+
+; User mode half of the ELF start up benchmark.  elf_bench.c copies it to the start of the text
+; of an executable of ELF_BENCH_LARGE_PAGES pages and writes that to the disk.  It exits right
+; away, so only the first page of the text is ever touched.
+
+SYS_EXIT equ 1				; in syscall.h
+SYSCALL_VECTOR equ 0x80
+
+global elf_bench_start
+global elf_bench_end
+
+bits 32
+
+elf_bench_start:
+	xor ebx, ebx			; exit code 0
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+elf_bench_end:
@@ -0,0 +1,51 @@
+#include "bench.h"
+#include "task/process.h"
+#include "timer/clock.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "print/print.h"
+
+#define IPC_BENCH_ITERATIONS		10000		// keep in sync with ipc_bench_user.asm
+#define IPC_BENCH_SERVER_ID_OFFSET	1		// the immediate of the client's first instruction
+
+extern uint8_t ipc_bench_server_start[];
+extern uint8_t ipc_bench_server_end[];
+extern uint8_t ipc_bench_client_start[];
+extern uint8_t ipc_bench_client_end[];
+
+void bench_ipc()
+{
+	uint32_t size = ipc_bench_client_end - ipc_bench_client_start;
+	uint8_t *client;
+	int server_pid;
+	int client_pid;
+	int cycles;
+	int code;
+
+	server_pid = process_create("ipc server", ipc_bench_server_start, ipc_bench_server_end - ipc_bench_server_start, 0);
+	client = kmalloc(size);
+	if (server_pid < 0 || !client) {
+		print("ipc bench: couldn't start the server\n");
+		return;
+	}
+
+	/* The client has no other way of learning who to call */
+	memcpy(client, ipc_bench_client_start, size);
+	*(uint32_t *)(client + IPC_BENCH_SERVER_ID_OFFSET) = server_pid;
+	client_pid = process_create("ipc client", client, size, 0);
+	kfree(client);
+
+	if (client_pid < 0) {
+		print("ipc bench: couldn't start the client\n");
+		return;
+	}
+
+	process_wait(client_pid, &cycles);
+	process_wait(server_pid, &code);
+
+	print("ipc call/reply round trip: ");
+	print_dec((uint32_t)cycles);
+	print(" cycles (");
+	print_dec(cycles_to_ns((uint32_t)cycles));
+	print(" ns)\n");
+}
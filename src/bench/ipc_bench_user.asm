@@ -0,0 +1,74 @@
+section .asm
+
+; User mode halves of the ipc ping-pong benchmark.  process_create copies each blob between its
+; start and end labels to the start of a new process's user space, so the code must be position
+; independent: relative jumps only and no data of its own.
+;
+; The server echoes every message back to its caller until one says IPC_BENCH_QUIT.  The client
+; times IPC_BENCH_ITERATIONS calls with rdtsc and exits with the average round trip in cycles.
+; The ipc system calls overwrite ebx, esi, edi and ebp, so the client keeps its state on the stack.
+
+SYS_EXIT equ 1				; in syscall.h
+SYS_IPC_CALL equ 4
+SYS_IPC_REPLY_WAIT equ 5
+SYSCALL_VECTOR equ 0x80
+IPC_ID_MASK equ 0x3FFFFFFF		; in ipc.h
+IPC_BENCH_ITERATIONS equ 10000		; in ipc_bench.c
+IPC_BENCH_QUIT equ 0xFFFFFFFF
+
+global ipc_bench_server_start
+global ipc_bench_server_end
+global ipc_bench_client_start
+global ipc_bench_client_end
+
+bits 32
+
+ipc_bench_server_start:
+	xor ebx, ebx			; nobody to reply to yet
+.loop:
+	mov eax, SYS_IPC_REPLY_WAIT
+	int SYSCALL_VECTOR
+	test eax, eax
+	jnz ipc_bench_server_start
+
+	cmp esi, IPC_BENCH_QUIT
+	je .quit
+	and ebx, IPC_ID_MASK		; reply with the same words to whoever sent them
+	jmp .loop
+
+.quit:
+	xor ebx, ebx
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+ipc_bench_server_end:
+
+ipc_bench_client_start:
+	mov ecx, 0			; the server's id, ipc_bench.c patches the immediate (offset 1)
+	push ecx			; [esp + 8]: server
+	push dword IPC_BENCH_ITERATIONS	; [esp + 4]: calls left
+	rdtsc
+	push eax			; [esp]: start, the low half is plenty
+.loop:
+	mov ebx, [esp + 8]
+	mov esi, 1
+	mov eax, SYS_IPC_CALL
+	int SYSCALL_VECTOR
+	dec dword [esp + 4]
+	jnz .loop
+
+	rdtsc
+	sub eax, [esp]
+	xor edx, edx
+	mov ecx, IPC_BENCH_ITERATIONS
+	div ecx
+	mov [esp], eax			; cycles per round trip
+
+	mov ebx, [esp + 8]		; let the server go
+	mov esi, IPC_BENCH_QUIT
+	mov eax, SYS_IPC_CALL
+	int SYSCALL_VECTOR		; fails with -ENODEV, the server exits instead of replying
+
+	mov ebx, [esp]
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+ipc_bench_client_end:
@@ -0,0 +1,81 @@
+#include "bench.h"
+#include "timer/timer.h"
+#include "timer/clock.h"
+#include "idt/irq.h"
+#include "cpu/cpu.h"
+#include "lib/atomic.h"
+#include "memory/heap/kernel_heap.h"
+#include "print/print.h"
+
+#define IRQ_BENCH_SAMPLES	1000
+
+/* Short enough that the tick source's calibration error against the tsc is a few cycles */
+#define IRQ_BENCH_DELAY_NS	(100 * NSEC_PER_USEC)
+
+static struct {
+	uint64_t handler_entry;
+	uint64_t handler_exit;
+	uint32_t fired;
+} sample;
+
+static void irq_bench_handler(struct interrupt_frame *frame, void *ctx)
+{
+	sample.handler_entry = read_tsc();
+	atomic_store(&sample.fired, 1);
+	sample.handler_exit = read_tsc();
+}
+
+void bench_irq_latency()
+{
+	struct clock_event *dev = timer_clock_event();
+	uint32_t *entry_latency = kzalloc(IRQ_BENCH_SAMPLES * sizeof(uint32_t));
+	uint32_t *exit_latency = kzalloc(IRQ_BENCH_SAMPLES * sizeof(uint32_t));
+	uint64_t delay_cycles = ns_to_cycles(IRQ_BENCH_DELAY_NS);
+
+	if (!entry_latency || !exit_latency) {
+		print("irq latency bench: out of memory\n");
+		goto out;
+	}
+
+	timer_suspend();
+	irq_register(dev->vector, irq_bench_handler, 0);
+
+	for (int i = 0; i < IRQ_BENCH_SAMPLES; i++) {
+		uint64_t deadline;
+		uint64_t resume;
+
+		/* The count starts with the last register write of set_oneshot, so take the tsc
+		 * after it: what programming the timer costs isn't interrupt latency
+		 */
+		sample.fired = 0;
+		dev->set_oneshot(IRQ_BENCH_DELAY_NS);
+		deadline = read_tsc() + delay_cycles;
+
+		/* Play the interrupted code: keep reading the tsc, the first read after the
+		 * handler finished is when we got the cpu back
+		 */
+		while (1) {
+			resume = read_tsc();
+			if (atomic_load(&sample.fired) && resume > sample.handler_exit)
+				break;
+		}
+
+		entry_latency[i] = sample.handler_entry > deadline ? sample.handler_entry - deadline : 0;
+		exit_latency[i] = resume - sample.handler_exit;
+	}
+
+	irq_unregister(dev->vector);
+	timer_resume();
+
+	print("irq latency (");
+	print(dev->name);
+	print(")\n");
+	bench_report_histogram("deadline to handler", entry_latency, IRQ_BENCH_SAMPLES);
+	bench_report_histogram("handler to interrupted code", exit_latency, IRQ_BENCH_SAMPLES);
+
+out:
+	if (entry_latency)
+		kfree(entry_latency);
+	if (exit_latency)
+		kfree(exit_latency);
+}
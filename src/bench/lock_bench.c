@@ -0,0 +1,101 @@
+#include "bench.h"
+#include "lib/spinlock.h"
+#include "smp/smp.h"
+#include "cpu/cpu.h"
+#include "timer/clock.h"
+#include "lib/math.h"
+#include "print/print.h"
+
+#define LOCK_BENCH_ITERS	100000
+#define LOCK_BENCH_WORDS	8	// shared words the critical section touches
+
+LOCK_CLASS(bench_spin_class, "bench spinlock");
+LOCK_CLASS(bench_ticket_class, "bench ticket");
+LOCK_CLASS(bench_mcs_class, "bench mcs");
+
+static spinlock_t bench_spin;
+static ticket_lock_t bench_ticket;
+static mcs_lock_t bench_mcs;
+
+static volatile uint32_t shared[LOCK_BENCH_WORDS];
+
+/* The one critical section every lock type runs, so only the lock differs between them */
+static void critical_section()
+{
+	for (int i = 0; i < LOCK_BENCH_WORDS; i++)
+		shared[i]++;
+}
+
+static void spin_loop(void *arg)
+{
+	(void)arg;
+	for (int i = 0; i < LOCK_BENCH_ITERS; i++) {
+		spin_lock(&bench_spin);
+		critical_section();
+		spin_unlock(&bench_spin);
+	}
+}
+
+static void ticket_loop(void *arg)
+{
+	(void)arg;
+	for (int i = 0; i < LOCK_BENCH_ITERS; i++) {
+		ticket_lock(&bench_ticket);
+		critical_section();
+		ticket_unlock(&bench_ticket);
+	}
+}
+
+static void mcs_loop(void *arg)
+{
+	struct mcs_node node;
+
+	(void)arg;
+	for (int i = 0; i < LOCK_BENCH_ITERS; i++) {
+		mcs_lock(&bench_mcs, &node);
+		critical_section();
+		mcs_unlock(&bench_mcs, &node);
+	}
+}
+
+/* Run loop on every online cpu at once and report the cycles per acquire, all cpus together */
+static void bench_lock(const char *name, smp_fn_t loop)
+{
+	int ncpus = smp_cpu_count();
+	uint32_t expected = ncpus * LOCK_BENCH_ITERS;
+	uint64_t start, cycles;
+
+	for (int i = 0; i < LOCK_BENCH_WORDS; i++)
+		shared[i] = 0;
+
+	start = read_tsc();
+	for (int i = 1; i < ncpus; i++) {
+		smp_call(i, loop, 0);
+	}
+	loop(0);
+	for (int i = 1; i < ncpus; i++) {
+		smp_wait(i);
+	}
+	cycles = read_tsc() - start;
+
+	if (shared[0] != expected) {
+		print("lock bench: ");
+		print(name);
+		print(" lost updates\n");
+	}
+
+	div64_32(&cycles, expected);
+	bench_report(name, cycles, "cycles/acquire");
+}
+
+void bench_locks()
+{
+	spin_lock_init(&bench_spin, &bench_spin_class);
+	ticket_lock_init(&bench_ticket, &bench_ticket_class);
+	mcs_lock_init(&bench_mcs, &bench_mcs_class);
+
+	bench_report("lock bench cpus", smp_cpu_count(), "");
+	bench_lock("spinlock", spin_loop);
+	bench_lock("ticket lock", ticket_loop);
+	bench_lock("mcs lock", mcs_loop);
+}
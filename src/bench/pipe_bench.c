@@ -0,0 +1,99 @@
+#include "bench.h"
+#include "pipe/pipe.h"
+#include "task/process.h"
+#include "timer/clock.h"
+#include "lib/math.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "print/print.h"
+#include "config.h"
+#include "status.h"
+
+/* Keep in sync with pipe_bench_user.asm */
+#define PIPE_BENCH_BUFFER		(PROCESS_USER_START + PAGING_PAGE_SIZE)
+#define PIPE_BENCH_CHUNK		65536
+#define PIPE_BENCH_WRITES		256		// 16 MB a run
+#define PIPE_BENCH_ID_OFFSET		1		// immediates of the first two instructions
+#define PIPE_BENCH_SKEW_OFFSET		6
+
+/* The code page, the buffer and a page of slack to skew it by */
+#define PIPE_BENCH_IMAGE_SIZE		(PAGING_PAGE_SIZE + PIPE_BENCH_CHUNK + PAGING_PAGE_SIZE)
+
+extern uint8_t pipe_bench_writer_start[];
+extern uint8_t pipe_bench_writer_end[];
+extern uint8_t pipe_bench_reader_start[];
+extern uint8_t pipe_bench_reader_end[];
+
+static int pipe_bench_start(const char *name, uint8_t *start, uint8_t *end, int pipe, uint32_t skew)
+{
+	uint8_t *image = kzalloc(PIPE_BENCH_IMAGE_SIZE);
+	int pid;
+
+	if (!image)
+		return -ENOMEM;
+
+	memcpy(image, start, end - start);
+	*(uint32_t *)(image + PIPE_BENCH_ID_OFFSET) = pipe;
+	*(uint32_t *)(image + PIPE_BENCH_SKEW_OFFSET) = skew;
+
+	pid = process_create(name, image, PIPE_BENCH_IMAGE_SIZE, 0);
+	kfree(image);
+	return pid;
+}
+
+/* Stream PIPE_BENCH_WRITES chunks from a writer process to a reader process, with both buffers
+ * skew bytes off page alignment
+ */
+static void pipe_bench_run(const char *what, uint32_t skew)
+{
+	uint64_t start = ktime_ns();
+	uint64_t elapsed;
+	int pipe = pipe_create();
+	int reader = -ENOMEM;
+	int writer = -ENOMEM;
+	int bytes;
+	int code;
+
+	if (pipe >= 0)
+		reader = pipe_bench_start("pipe reader", pipe_bench_reader_start, pipe_bench_reader_end, pipe, skew);
+	if (reader >= 0)
+		writer = pipe_bench_start("pipe writer", pipe_bench_writer_start, pipe_bench_writer_end, pipe, skew);
+
+	if (writer < 0) {
+		print("pipe bench: couldn't start the processes\n");
+		if (pipe < 0)
+			return;
+
+		/* A reader that started sees the end of the pipe and exits */
+		pipe_abandon(pipe, PIPE_WRITE);
+		if (reader >= 0)
+			process_wait(reader, &bytes);
+		else
+			pipe_abandon(pipe, PIPE_READ);
+		return;
+	}
+
+	process_wait(writer, &code);
+	process_wait(reader, &bytes);
+	elapsed = ktime_ns() - start;
+
+	if (code != 0 || bytes != PIPE_BENCH_CHUNK * PIPE_BENCH_WRITES) {
+		print("pipe bench: transfer failed\n");
+		return;
+	}
+
+	/* Bytes per microsecond is MB/s */
+	div64_32(&elapsed, 1000);
+	print("pipe ");
+	print(what);
+	print(": ");
+	print_dec(elapsed ? (uint32_t)bytes / (uint32_t)elapsed : 0);
+	print(" MB/s\n");
+}
+
+void bench_pipe()
+{
+	pipe_bench_run("page aligned, pages move", 0);
+	pipe_bench_run("unaligned, bytes copied", 1);
+}
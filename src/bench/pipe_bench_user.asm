@@ -0,0 +1,97 @@
+section .asm
+
+; User mode halves of the pipe throughput benchmark.  ipc_bench.c's trick again: each blob is
+; copied to the start of a process image, followed by a PIPE_BENCH_CHUNK buffer at
+; PIPE_BENCH_BUFFER, and pipe_bench.c patches the pipe id and how far the buffer is skewed off
+; page alignment into the immediates of the first two instructions.  Position independent, with
+; the state on the stack.
+;
+; The writer sends PIPE_BENCH_WRITES chunks and exits with 0, or whatever a write returned.  The
+; reader reads until the end of the pipe and exits with the number of bytes it got.  Neither
+; touches the data, the benchmark measures the pipe.
+
+SYS_EXIT equ 1				; in syscall.h
+SYS_PIPE_OPEN equ 8
+SYS_PIPE_READ equ 9
+SYS_PIPE_WRITE equ 10
+SYSCALL_VECTOR equ 0x80
+PIPE_READ equ 0				; in pipe.h
+PIPE_WRITE equ 1
+PIPE_BENCH_BUFFER equ 0x40001000	; in pipe_bench.c
+PIPE_BENCH_CHUNK equ 65536
+PIPE_BENCH_WRITES equ 256
+
+global pipe_bench_writer_start
+global pipe_bench_writer_end
+global pipe_bench_reader_start
+global pipe_bench_reader_end
+
+bits 32
+
+pipe_bench_writer_start:
+	mov ecx, 0			; the pipe, patched in at offset 1
+	mov edx, 0			; the buffer's skew, patched in at offset 6
+	push ecx			; [esp + 8]: pipe
+	add edx, PIPE_BENCH_BUFFER
+	push edx			; [esp + 4]: buffer
+	push dword PIPE_BENCH_WRITES	; [esp]: writes left
+
+	mov ebx, [esp + 8]
+	mov esi, PIPE_WRITE
+	mov eax, SYS_PIPE_OPEN
+	int SYSCALL_VECTOR
+	test eax, eax
+	jnz .exit
+
+.loop:
+	mov ebx, [esp + 8]
+	mov esi, [esp + 4]
+	mov edi, PIPE_BENCH_CHUNK
+	xor ebp, ebp
+	mov eax, SYS_PIPE_WRITE
+	int SYSCALL_VECTOR
+	cmp eax, PIPE_BENCH_CHUNK
+	jne .exit
+	dec dword [esp]
+	jnz .loop
+	xor eax, eax
+
+.exit:
+	mov ebx, eax			; exiting closes the write end, which ends the reader's loop
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+pipe_bench_writer_end:
+
+pipe_bench_reader_start:
+	mov ecx, 0			; the pipe, patched in at offset 1
+	mov edx, 0			; the buffer's skew, patched in at offset 6
+	push ecx			; [esp + 8]: pipe
+	add edx, PIPE_BENCH_BUFFER
+	push edx			; [esp + 4]: buffer
+	push dword 0			; [esp]: bytes read
+
+	mov ebx, [esp + 8]
+	mov esi, PIPE_READ
+	mov eax, SYS_PIPE_OPEN
+	int SYSCALL_VECTOR
+	test eax, eax
+	jnz .exit
+
+.loop:
+	mov ebx, [esp + 8]
+	mov esi, [esp + 4]
+	mov edi, PIPE_BENCH_CHUNK
+	mov eax, SYS_PIPE_READ
+	int SYSCALL_VECTOR
+	test eax, eax
+	jle .done			; 0 at the end of the pipe
+	add [esp], eax
+	jmp .loop
+
+.done:
+	mov eax, [esp]
+.exit:
+	mov ebx, eax
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+pipe_bench_reader_end:
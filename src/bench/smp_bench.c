@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "smp/smp.h"
+#include "cpu/cpu.h"
+#include "timer/clock.h"
+#include "memory/memory.h"
+#include "lib/math.h"
+#include "memory/heap/kernel_heap.h"
+#include "print/print.h"
+#include "config.h"
+
+#define SMP_BENCH_BYTES		(16 * 1024 * 1024)
+
+struct memset_slice {
+	uint8_t *start;
+	uint32_t len;
+};
+
+static void memset_slice(void *arg)
+{
+	struct memset_slice *slice = arg;
+	memset(slice->start, 0xa5, slice->len);
+}
+
+void bench_smp_memset()
+{
+	struct memset_slice slices[CONFIG_MAX_CPUS];
+	int ncpus = smp_cpu_count();
+	uint32_t per_cpu = SMP_BENCH_BYTES / ncpus;
+	uint8_t *buf = kmalloc(SMP_BENCH_BYTES);
+	uint64_t start, one_cpu, all_cpus, speedup;
+
+	if (!buf) {
+		print("smp bench: out of memory\n");
+		return;
+	}
+
+	/* Touch it once so neither run pays for first use */
+	memset(buf, 0, SMP_BENCH_BYTES);
+
+	start = read_tsc();
+	memset(buf, 0xa5, SMP_BENCH_BYTES);
+	one_cpu = read_tsc() - start;
+
+	for (int i = 0; i < ncpus; i++) {
+		slices[i].start = buf + i * per_cpu;
+		slices[i].len = i == ncpus - 1 ? SMP_BENCH_BYTES - i * per_cpu : per_cpu;
+	}
+
+	start = read_tsc();
+	for (int i = 1; i < ncpus; i++) {
+		smp_call(i, memset_slice, &slices[i]);
+	}
+	memset_slice(&slices[0]);
+	for (int i = 1; i < ncpus; i++) {
+		smp_wait(i);
+	}
+	all_cpus = read_tsc() - start;
+
+	/* Scale both down so the multiply by 100 can't overflow */
+	speedup = (one_cpu >> 8) * 100;
+	div64_32(&speedup, (all_cpus >> 8) + 1);
+
+	bench_report("smp memset cpus", ncpus, "");
+	bench_report("smp memset 1 cpu", cycles_to_ns(one_cpu), "ns");
+	bench_report("smp memset all cpus", cycles_to_ns(all_cpus), "ns");
+	bench_report("smp memset speedup", speedup, "% of 1 cpu");
+
+	for (int i = 1; i < ncpus; i++) {
+		print("cpu ");
+		print_dec(i);
+		print(" ticks ");
+		print_dec(smp_cpu_ticks(i));
+		print("\n");
+	}
+
+	kfree(buf);
+}
@@ -0,0 +1,40 @@
+#include "bench.h"
+#include "syscall/syscall.h"
+#include "task/process.h"
+#include "timer/clock.h"
+#include "print/print.h"
+
+#define SYSCALL_BENCH_ITERATIONS	10000		// keep in sync with syscall_bench_user.asm
+
+extern uint8_t syscall_bench_int_start[];
+extern uint8_t syscall_bench_int_end[];
+extern uint8_t syscall_bench_sysenter_start[];
+extern uint8_t syscall_bench_sysenter_end[];
+
+/* Run one of the user mode loops in a fresh process and report the cycles per call it exits with */
+static void bench_null_syscall(const char *name, uint8_t *start, uint8_t *end)
+{
+	int pid = process_create(name, start, end - start, 0);
+	int cycles;
+
+	if (pid < 0) {
+		print("syscall bench: couldn't start a process\n");
+		return;
+	}
+
+	process_wait(pid, &cycles);
+	print(name);
+	print(": ");
+	print_dec((uint32_t)cycles);
+	print(" cycles (");
+	print_dec(cycles_to_ns((uint32_t)cycles));
+	print(" ns) per call\n");
+}
+
+void bench_syscall()
+{
+	bench_null_syscall("null syscall int 0x80", syscall_bench_int_start, syscall_bench_int_end);
+
+	if (syscall_sysenter_supported())
+		bench_null_syscall("null syscall sysenter", syscall_bench_sysenter_start, syscall_bench_sysenter_end);
+}
@@ -0,0 +1,65 @@
+section .asm
+
+; User mode halves of the null system call benchmark.  process_create copies each blob between
+; its start and end labels to the start of a new process's user space, so the code must be
+; position independent: relative jumps only and no data of its own.
+;
+; Each times SYSCALL_BENCH_ITERATIONS null system calls with rdtsc and exits with the average
+; round trip in cycles as its exit code.
+
+SYS_NULL equ 0				; in syscall.h
+SYS_EXIT equ 1
+SYSCALL_VECTOR equ 0x80
+SYSCALL_BENCH_ITERATIONS equ 10000	; in syscall_bench.c
+
+global syscall_bench_int_start
+global syscall_bench_int_end
+global syscall_bench_sysenter_start
+global syscall_bench_sysenter_end
+
+bits 32
+
+syscall_bench_int_start:
+	mov edi, SYSCALL_BENCH_ITERATIONS
+	rdtsc
+	mov esi, eax			; the low half is plenty for 10000 calls
+.loop:
+	mov eax, SYS_NULL
+	int SYSCALL_VECTOR
+	dec edi
+	jnz .loop
+
+	rdtsc
+	sub eax, esi
+	xor edx, edx
+	mov ecx, SYSCALL_BENCH_ITERATIONS
+	div ecx
+	mov ebx, eax			; exit code: cycles per call
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+syscall_bench_int_end:
+
+syscall_bench_sysenter_start:
+	mov edi, SYSCALL_BENCH_ITERATIONS
+	rdtsc
+	mov esi, eax
+.loop:
+	mov eax, SYS_NULL
+	call .enter			; pushes the address sysexit should come back to
+	dec edi
+	jnz .loop
+
+	rdtsc
+	sub eax, esi
+	xor edx, edx
+	mov ecx, SYSCALL_BENCH_ITERATIONS
+	div ecx
+	mov ebx, eax
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+
+.enter:
+	pop edx				; resume right after the call
+	mov ecx, esp
+	sysenter
+syscall_bench_sysenter_end:
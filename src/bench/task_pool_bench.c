@@ -0,0 +1,56 @@
+#include "bench.h"
+#include "task/task_pool.h"
+#include "smp/smp.h"
+#include "cpu/cpu.h"
+#include "timer/clock.h"
+#include "lib/math.h"
+#include "memory/paging/paging.h"
+#include "print/print.h"
+
+#define TASK_POOL_BENCH_RUNS	4
+
+/* Best of a few runs, the first one also pays for warming up the heap */
+static uint64_t bench_page_tables_once()
+{
+	uint64_t best = ~0ULL;
+
+	for (int run = 0; run < TASK_POOL_BENCH_RUNS; run++) {
+		uint64_t start = read_tsc();
+		struct paging_desc *paging = init_page_tables(PAGING_READ_WRITE | PAGING_PRESENT);
+		uint64_t cycles = read_tsc() - start;
+
+		paging_free(paging);
+		if (cycles < best)
+			best = cycles;
+	}
+
+	return best;
+}
+
+void bench_task_pool()
+{
+	int ncpus = smp_cpu_count();
+	uint64_t one_cpu = 0;
+
+	for (int cpus = 1; cpus <= ncpus; cpus++) {
+		uint64_t cycles, speedup;
+
+		task_pool_set_workers(cpus - 1);
+		cycles = bench_page_tables_once();
+		if (cpus == 1)
+			one_cpu = cycles;
+
+		speedup = (one_cpu >> 8) * 100;
+		div64_32(&speedup, (cycles >> 8) + 1);
+
+		print("page tables on ");
+		print_dec(cpus);
+		print(" cpus: ");
+		print_dec(cycles_to_ns(cycles));
+		print(" ns, ");
+		print_dec(speedup);
+		print("% of 1 cpu\n");
+	}
+
+	task_pool_set_workers(-1);
+}
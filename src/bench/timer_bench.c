@@ -0,0 +1,125 @@
+#include "bench.h"
+#include "timer/timer_wheel.h"
+#include "memory/heap/kernel_heap.h"
+#include "cpu/cpu.h"
+#include "lib/list.h"
+#include "lib/math.h"
+#include "print/print.h"
+
+#define BENCH_TIMERS		10000
+#define BENCH_CHURN_OPS		10000
+#define BENCH_MAX_DELAY		(1 << 16)	// ticks, about a minute at 1000 Hz
+
+/* The baseline: a list kept sorted by expiry.  O(n) insert, O(1) delete and expire */
+static void sorted_list_add(struct list_head *head, struct timer *t, uint64_t expires)
+{
+	struct list_head *pos;
+
+	t->expires = expires;
+	list_for_each(pos, head) {
+		if (list_entry(pos, struct timer, entry)->expires > expires)
+			break;
+	}
+	list_add_tail(&t->entry, pos);		// i.e. insert right before pos
+}
+
+static uint64_t per_op(uint64_t cycles, uint32_t ops)
+{
+	div64_32(&cycles, ops);
+	return cycles;
+}
+
+static void bench_wheel(struct timer *timers, uint64_t *expiries)
+{
+	struct timer_wheel *wheel = kzalloc(sizeof(struct timer_wheel));
+	uint64_t start;
+	uint32_t expired = 0;
+
+	if (!wheel) {
+		print("timer bench: out of memory\n");
+		return;
+	}
+	timer_wheel_init(wheel, 0);
+
+	start = read_tsc();
+	for (int i = 0; i < BENCH_TIMERS; i++) {
+		timer_wheel_add(wheel, &timers[i], expiries[i]);
+	}
+	bench_report("wheel add", per_op(read_tsc() - start, BENCH_TIMERS), "cycles/op");
+
+	start = read_tsc();
+	for (int i = 0; i < BENCH_CHURN_OPS; i++) {
+		struct timer *t = &timers[bench_rand() % BENCH_TIMERS];
+		timer_wheel_del(wheel, t);
+		timer_wheel_add(wheel, t, 1 + bench_rand() % BENCH_MAX_DELAY);
+	}
+	bench_report("wheel del+add", per_op(read_tsc() - start, BENCH_CHURN_OPS), "cycles/op");
+
+	start = read_tsc();
+	timer_wheel_advance(wheel, BENCH_MAX_DELAY);
+	while (timer_wheel_pop_expired(wheel)) {
+		expired++;
+	}
+	bench_report("wheel expire", per_op(read_tsc() - start, expired), "cycles/timer");
+
+	kfree(wheel);
+}
+
+static void bench_sorted_list(struct timer *timers, uint64_t *expiries)
+{
+	struct list_head head;
+	uint64_t start;
+	uint32_t expired = 0;
+
+	list_init(&head);
+
+	start = read_tsc();
+	for (int i = 0; i < BENCH_TIMERS; i++) {
+		sorted_list_add(&head, &timers[i], expiries[i]);
+	}
+	bench_report("sorted list add", per_op(read_tsc() - start, BENCH_TIMERS), "cycles/op");
+
+	start = read_tsc();
+	for (int i = 0; i < BENCH_CHURN_OPS; i++) {
+		struct timer *t = &timers[bench_rand() % BENCH_TIMERS];
+		list_del(&t->entry);
+		sorted_list_add(&head, t, 1 + bench_rand() % BENCH_MAX_DELAY);
+	}
+	bench_report("sorted list del+add", per_op(read_tsc() - start, BENCH_CHURN_OPS), "cycles/op");
+
+	start = read_tsc();
+	while (!list_empty(&head)) {
+		list_del(head.next);
+		expired++;
+	}
+	bench_report("sorted list expire", per_op(read_tsc() - start, expired), "cycles/timer");
+}
+
+void bench_timer_wheel()
+{
+	struct timer *timers = kzalloc(BENCH_TIMERS * sizeof(struct timer));
+	uint64_t *expiries = kzalloc(BENCH_TIMERS * sizeof(uint64_t));
+
+	if (!timers || !expiries) {
+		print("timer bench: out of memory\n");
+		goto out;
+	}
+
+	/* Both structures get the same workload */
+	for (int i = 0; i < BENCH_TIMERS; i++) {
+		timer_setup(&timers[i], 0, 0);
+		expiries[i] = 1 + bench_rand() % BENCH_MAX_DELAY;
+	}
+	bench_wheel(timers, expiries);
+
+	for (int i = 0; i < BENCH_TIMERS; i++) {
+		timer_setup(&timers[i], 0, 0);
+	}
+	bench_sorted_list(timers, expiries);
+
+out:
+	if (timers)
+		kfree(timers);
+	if (expiries)
+		kfree(expiries);
+}
@@ -0,0 +1,27 @@
+#include "bench.h"
+#include "task/process.h"
+#include "timer/clock.h"
+#include "print/print.h"
+
+#define VDSO_BENCH_ITERATIONS		10000		// keep in sync with vdso_bench_user.asm
+
+extern uint8_t vdso_bench_start[];
+extern uint8_t vdso_bench_end[];
+
+void bench_vdso()
+{
+	int pid = process_create("vdso time", vdso_bench_start, vdso_bench_end - vdso_bench_start, 0);
+	int cycles;
+
+	if (pid < 0) {
+		print("vdso bench: couldn't start a process\n");
+		return;
+	}
+
+	process_wait(pid, &cycles);
+	print("vdso time_ns: ");
+	print_dec((uint32_t)cycles);
+	print(" cycles (");
+	print_dec(cycles_to_ns((uint32_t)cycles));
+	print(" ns) per call\n");
+}
@@ -0,0 +1,37 @@
+section .asm
+
+; User mode half of the vdso benchmark.  process_create copies the blob between the start and end
+; labels to the start of a new process's user space, so the code must be position independent.
+;
+; Times VDSO_BENCH_ITERATIONS calls of the vdso's time_ns with rdtsc and exits with the average
+; in cycles as its exit code.
+
+SYS_EXIT equ 1				; in syscall.h
+SYSCALL_VECTOR equ 0x80
+VDSO_TIME_NS equ 0x7FFE1000		; in vdso.h
+VDSO_BENCH_ITERATIONS equ 10000		; in vdso_bench.c
+
+global vdso_bench_start
+global vdso_bench_end
+
+bits 32
+
+vdso_bench_start:
+	mov edi, VDSO_BENCH_ITERATIONS
+	rdtsc
+	mov esi, eax
+.loop:
+	mov eax, VDSO_TIME_NS
+	call eax			; keeps ebx, esi, edi and ebp
+	dec edi
+	jnz .loop
+
+	rdtsc
+	sub eax, esi
+	xor edx, edx
+	mov ecx, VDSO_BENCH_ITERATIONS
+	div ecx
+	mov ebx, eax			; exit code: cycles per call
+	mov eax, SYS_EXIT
+	int SYSCALL_VECTOR
+vdso_bench_end:
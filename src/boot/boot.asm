@@ -7,6 +7,9 @@ BITS 16				; Tells the assembler we are using a 16 bit architecture
 CODE_SEG equ gdt_code - gdt_start	; EQU is a NASM psuedo instruction that gives a symbol (CODE_SEG) a corresponding value (gdt_code - gdt_start)
 DATA_SEG equ gdt_data - gdt_start	; These symbols will be used to give us our offsets into the GDT for the respective segment descriptors
 
+KERNEL_SECTORS equ 256			; how much of the disk after the boot sector holds the kernel (128 KiB).  Keep in sync with the Makefile
+KERNEL_CHUNK_SECTORS equ 128		; sectors per read command
+
 _start:				; the following instructions signify the start of the boot record (look at wiki.osdev.org/FAT)
 	jmp short start
 	nop
@@ -93,10 +96,18 @@ message:
 load32:
 	; in 32 bit mode here
 	; the goal is to load our kernel into memory and jump to it
+	; the sector count register is only 8 bits wide, so the kernel is read in chunks
 	mov eax, 1		; eax will contain the starting sector we want to load from (0 is boot sector)
-	mov ecx, 100		; ecx will contain the total number of sectors we want to load
 	mov edi, 0x0100000	; edi will contain the address we want to load these sectors in to (1 MB)
-	call ata_lba_read	; ata_lba_read is the label that will talk with the drive and load the sectors into memory
+	mov esi, KERNEL_SECTORS / KERNEL_CHUNK_SECTORS
+.next_chunk:
+	push eax
+	mov ecx, KERNEL_CHUNK_SECTORS	; ecx will contain the total number of sectors we want to load
+	call ata_lba_read	; ata_lba_read is the label that will talk with the drive and load the sectors into memory (advances edi)
+	pop eax
+	add eax, KERNEL_CHUNK_SECTORS
+	dec esi
+	jnz .next_chunk
 	jmp CODE_SEG:0x0100000 	; jump to 1 MB which is the location where we've read the kernel sectors into memory
 
 ata_lba_read:
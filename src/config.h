@@ -1,8 +1,10 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#define KERNEL_CODE_SELECTOR 0x08;
-#define KERNEL_DATA_SELECTOR 0x10;
+#define KERNEL_CODE_SELECTOR 0x08
+#define KERNEL_DATA_SELECTOR 0x10
+#define USER_CODE_SELECTOR 0x1B			/* GDT_USER_CODE, rpl 3 */
+#define USER_DATA_SELECTOR 0x23			/* GDT_USER_DATA, rpl 3 */
 
 /* TODO: in an ideal system, this wouldn't be statically defined */
 #define KERNEL_HEAP_SIZE 	104857600	/* 100 MB */
@@ -12,4 +14,67 @@
 #define KERNEL_HEAP_ADDRESS	0x01000000	
 #define KERNEL_HEAP_TABLE_ADDR	0x00007E00	/* Ok to use as long as it's < 480.5 KiB */
 
+/* Freed single block allocations each cpu keeps for reuse instead of returning them to the heap */
+#define HEAP_CACHE_BLOCKS	16
+
+/* Route interrupts through the local and io apics when the cpu has them.  Set to 0 to
+ * stay on the legacy 8259 PICs, e.g. to compare interrupt latency between the two
+ */
+#define CONFIG_APIC		1
+
+/* Upper bound on the number of processors we keep per cpu state for */
+#define CONFIG_MAX_CPUS		16
+
+/* Hardware interrupts run on their own stack, with an unmapped guard page below it */
+#define IRQ_STACK_SIZE		16384
+#define DOUBLE_FAULT_STACK_SIZE	4096
+
+/* Size of each kernel thread's stack */
+#define THREAD_STACK_SIZE	8192
+
+/* Virtual address range of a process's user space, both 4 MiB aligned.  The rest of its address
+ * space is the kernel's, which ring 3 can't access
+ */
+#define PROCESS_USER_START	0x40000000
+#define PROCESS_USER_END	0x80000000
+#define PROCESS_STACK_SIZE	16384		// user stack, just below PROCESS_USER_END
+#define VDSO_ADDRESS		0x7FFE0000	// the vdso's two pages (src/vdso/vdso.h), in every process
+
+/* io rings (src/ioring/ioring.h): the most submission entries a ring can have, a power of 2, the
+ * size of its buffer area, where it is mapped in its process, and how long the IORING_SETUP_SQPOLL
+ * thread polls an empty queue before going to sleep
+ */
+#define IORING_MAX_ENTRIES	256
+#define IORING_BUFFER_SIZE	65536
+#define IORING_USER_ADDRESS	0x7F000000
+#define IORING_SQPOLL_IDLE_MS	10
+
+/* The disk: the boot sector, KERNEL_SECTORS of kernel (src/boot/boot.asm), then a data area.  The
+ * first user program, init, is the ELF executable at the start of the data area if there is one.
+ * Keep in sync with the Makefile
+ */
+#define DISK_DATA_LBA		257
+#define DISK_DATA_SECTORS	4096		// 2 MiB
+
+/* Pages of data a pipe (src/pipe/pipe.h) holds before writers have to wait */
+#define PIPE_BUFFERS		16
+
+/* Capacity of each cpu's work stealing deque (src/task/task_pool.h), a power of 2.  Tasks spawned
+ * into a full deque run right away instead
+ */
+#define TASK_DEQUE_SIZE		256
+
+/* Scheduler time slice, and how long a runnable thread waits before it is raised a priority level */
+#define SCHED_TIMESLICE_MS	10
+#define SCHED_AGING_MS		100
+
+/* Frequency of the periodic timer tick */
+#define TIMER_HZ		1000
+
+/* Run the in kernel benchmarks (src/bench) at boot */
+#define CONFIG_BENCHMARKS	0
+
+/* Keep per lock class acquire, contention and hold time statistics (src/lib/spinlock.h) */
+#define CONFIG_LOCK_STAT	0
+
 #endif
@@ -0,0 +1,73 @@
+[BITS 32]
+
+section .asm
+
+global read_tsc
+
+read_tsc:
+	rdtsc				; loads the 64 bit time stamp counter into edx:eax, which is exactly how
+	ret				; a uint64_t is returned under the cdecl calling convention
+
+global cpuid_read
+global read_msr
+global write_msr
+
+cpuid_read:
+	push ebp			; preserve caller's frame pointer
+	mov ebp, esp
+	push ebx			; cpuid clobbers ebx and we use edi, both are callee saved
+	push edi
+
+	mov eax, [ebp+8]		; leaf
+	xor ecx, ecx			; sub leaf 0
+	cpuid
+	mov edi, [ebp+12]		; struct cpuid_regs *
+	mov [edi], eax
+	mov [edi+4], ebx
+	mov [edi+8], ecx
+	mov [edi+12], edx
+
+	pop edi
+	pop ebx
+	pop ebp
+	ret
+
+read_msr:
+	push ebp
+	mov ebp, esp
+
+	mov ecx, [ebp+8]		; msr number
+	rdmsr				; value comes back in edx:eax, which is also how we return a uint64_t
+
+	pop ebp
+	ret
+
+write_msr:
+	push ebp
+	mov ebp, esp
+
+	mov ecx, [ebp+8]		; msr number
+	mov eax, [ebp+12]		; low 32 bits of the value
+	mov edx, [ebp+16]		; high 32 bits of the value
+	wrmsr
+
+	pop ebp
+	ret
+
+global cpu_wait_for_interrupt
+
+cpu_wait_for_interrupt:
+	sti				; sti only takes effect after the next instruction, so no interrupt can sneak in between
+	hlt				; the caller's last check with interrupts disabled and the hlt.  Wakes on the next interrupt
+	ret
+
+global cpu_halt
+global read_cr2
+
+cpu_halt:
+	hlt				; sleep until the next interrupt (or forever, if interrupts are disabled)
+	ret
+
+read_cr2:
+	mov eax, cr2			; linear address that caused the last page fault
+	ret
@@ -0,0 +1,48 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+/* Registers returned by the cpuid instruction */
+struct cpuid_regs {
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+};
+
+#define CPUID_FEATURES			0x01
+#define CPUID_FEAT_EDX_TSC		(1 << 4)
+#define CPUID_FEAT_EDX_MSR		(1 << 5)
+#define CPUID_FEAT_EDX_APIC		(1 << 9)
+#define CPUID_FEAT_EDX_SEP		(1 << 11)	// sysenter/sysexit
+
+#define MSR_IA32_APIC_BASE		0x1B
+#define MSR_IA32_SYSENTER_CS		0x174
+#define MSR_IA32_SYSENTER_ESP		0x175
+#define MSR_IA32_SYSENTER_EIP		0x176
+
+/* Read the processor's time stamp counter (cycles since reset) */
+uint64_t read_tsc();
+
+/* Execute cpuid for leaf (sub leaf 0) and store the result in regs */
+void cpuid_read(uint32_t leaf, struct cpuid_regs *regs);
+
+/* Read the model specific register msr */
+uint64_t read_msr(uint32_t msr);
+
+/* Write val to the model specific register msr */
+void write_msr(uint32_t msr, uint64_t val);
+
+/* Enable interrupts and halt until the next one arrives.  Call with interrupts disabled
+ * after checking there's nothing left to do, the sti/hlt pair closes the wakeup race
+ */
+void cpu_wait_for_interrupt();
+
+/* Halt until the next interrupt, with whatever interrupt flag the caller has */
+void cpu_halt();
+
+/* Faulting linear address of the most recent page fault */
+uint32_t read_cr2();
+
+#endif /* CPU_H */
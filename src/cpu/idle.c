@@ -0,0 +1,74 @@
+#include "idle.h"
+#include "cpu.h"
+#include "idt/idt.h"
+#include "timer/timer_wheel.h"
+#include "softirq/softirq.h"
+#include "task/thread.h"
+#include "lib/math.h"
+#include "print/print.h"
+#include "smp/percpu.h"
+
+
+/* Anything that needs the cpu before it may halt */
+static bool cpu_has_work()
+{
+	return softirq_pending() || thread_runnable();
+}
+
+void cpu_idle_loop()
+{
+	struct percpu *cpu = this_cpu();
+	uint64_t halt_start;
+
+	cpu->idle_start_tsc = read_tsc();
+
+	while (1) {
+		softirq_run();
+		thread_yield();
+
+		/* Interrupts stay off from the last check until the hlt, otherwise work queued by
+		 * an interrupt in between would sit there until the one after it
+		 */
+		disable_interrupts();
+		if (cpu_has_work()) {
+			enable_interrupts();
+			continue;
+		}
+
+		timer_set_tickless(true);
+
+		halt_start = read_tsc();
+		cpu_wait_for_interrupt();
+		cpu->idle.idle_cycles += read_tsc() - halt_start;
+		cpu->idle.wakeups++;
+	}
+}
+
+void cpu_idle_get_stats(struct idle_stats *out)
+{
+	uint32_t flags = interrupts_save_disable();
+	struct percpu *cpu = this_cpu();
+
+	*out = cpu->idle;
+	out->total_cycles = read_tsc() - cpu->idle_start_tsc;
+
+	interrupts_restore(flags);
+}
+
+void cpu_idle_print_stats()
+{
+	struct idle_stats now;
+	uint64_t percent;
+
+	cpu_idle_get_stats(&now);
+
+	/* Scale both down so the multiply by 100 can't overflow */
+	percent = (now.idle_cycles >> 8) * 100;
+	div64_32(&percent, (now.total_cycles >> 8) + 1);
+
+	print("idle ");
+	print_dec(percent);
+	print("%, wakeups ");
+	print_dec(now.wakeups);
+	print("\n");
+}
@@ -0,0 +1,27 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+
+struct idle_stats {
+	uint64_t idle_cycles;		// tsc cycles spent halted
+	uint64_t total_cycles;		// tsc cycles since the idle loop started
+	uint32_t wakeups;
+};
+
+/*
+ * cpu_idle_loop - what the cpu does when there is nothing else to do.  Never returns
+ *
+ * Runs deferred work (softirqs) and lets every runnable thread have a turn, then halts until an interrupt arrives.  While halted the tick is
+ * tickless, so the timer only fires for the next armed timer instead of TIMER_HZ times
+ * a second.
+ */
+void cpu_idle_loop();
+
+/* Copy the calling cpu's idle accounting into out */
+void cpu_idle_get_stats(struct idle_stats *out);
+
+/* Print how much of the time since the idle loop started was spent halted */
+void cpu_idle_print_stats();
+
+#endif /* IDLE_H */
@@ -2,60 +2,279 @@
 #include "disk.h"
 #include "memory/memory.h"
 #include "status.h"
+#include "idt/irq.h"
+#include "lib/atomic.h"
+#include "kernel.h"
+#include "memory/vm/page_cache.h"
 
-#define BUSY_BIT                0x0008                          // If the busy bit is set, the disk drive still has control of the command block
+#define STATUS_BSY              0x0080                          // the drive still has control of the command block
+#define STATUS_DRQ              0x0008                          // the drive is ready to move a sector through the data port
+#define ERROR_BIT               0x0001
 #define ATA_COMMAND_IO_PORT     0x01F7
 #define ATA_DATA_PORT           0x01F0
+#define ATA_CONTROL_PORT        0x03F6                          // device control, writing 0 clears nIEN so the drive raises irqs
+#define ATA_ALT_STATUS_PORT     0x03F6                          // reading it doesn't acknowledge the irq like the status register does
 #define ATA_READ_SECTORS        0x0020
+#define ATA_WRITE_SECTORS       0x0030
+#define ATA_CACHE_FLUSH         0x00E7
+#define ATA_IRQ                 14
+#define ATA_POLL_LIMIT          100000
+
+LOCK_CLASS(disk_lock_class, "disk");
 
 struct disk disk;
 
-/* Read sectors at lba 
- * lba - the logical block address to read from
- * total - the number of sectors to read
- * buf - the buffer to store read data
+/* Only writes poll: the drive doesn't raise an irq before it wants the first sector.  Called by
+ * disk_thread without disk.lock, never from an irq handler
+ */
+static int disk_wait_drq()
+{
+        for (int i = 0; i < ATA_POLL_LIMIT; i++) {
+                uint8_t status = insb(ATA_ALT_STATUS_PORT);
+                if (status & STATUS_BSY)
+                        continue;
+                if (status & ERROR_BIT)
+                        return -EIO;
+                if (status & STATUS_DRQ)
+                        return 0;
+        }
+
+        return -EIO;
+}
+
+/* Move the next sector of req between the data port and its buffer, two bytes at a time */
+static void disk_transfer(struct disk_request *req)
+{
+        unsigned short *ptr = (unsigned short *)((uint8_t *)req->buf + req->done * DISK_SECTOR_SIZE);
+
+        for (int j = 0; j < DISK_SECTOR_SIZE / 2; j++) {
+                if (req->op == DISK_READ) {
+                        ptr[j] = insw(ATA_DATA_PORT);
+                } else {
+                        outw(ATA_DATA_PORT, ptr[j]);
+                }
+        }
+
+        req->done++;
+}
+
+/* Hand req to the controller.  disk.lock is held
  * 
  * I'm still somewhat unsure as to where the specification with these ports is defined.
  * I'm just using OSDev as a resource for these now.
- * 
+ *
  * TODO: pull out the ports into macros
  */
-int disk_read_sector(int lba, int total, void *buf)
+static void disk_start(struct disk_request *req)
 {
-        outb(0x1F6, (lba >> 24) | 0xE0);                        // Select the master drive                       
-        outb(0x1F2, total);                                     // Set sectorcount
+        uint32_t lba = req->lba;
+
+        req->done = 0;
+        req->flushing = false;
+
+        outb(0x1F6, ((lba >> 24) & 0x0F) | 0xE0);              // Select the master drive
+        outb(0x1F2, (unsigned char)req->total);                 // Set sectorcount, 0 means 256
         outb(0x1F3, (unsigned char)(lba & 0xFF));               // Set LBAlo
+        outb(0x1F4, (unsigned char)(lba >> 8));                 // Set LBAmid
         outb(0x1F5, (unsigned char)(lba >> 16));                // Set LBAhi
-        outb(ATA_COMMAND_IO_PORT, ATA_READ_SECTORS);            // 0x20 is read sector(s) command
-        
-        /* Read two bytes at a time */
-        unsigned short *ptr = (unsigned short *)buf;
-        for (int i = 0; i < total; i++) {
-
-                /* Wait for the buffer to be ready */
-                char c = insb(ATA_COMMAND_IO_PORT);             // Get the status register contents
-                while(!(c & BUSY_BIT)) {        
-                        c = insb(0x1F7);
+
+        if (req->op == DISK_READ) {
+                outb(ATA_COMMAND_IO_PORT, ATA_READ_SECTORS);
+                return;
+        }
+
+        /* disk_thread waits for the drive to take the first sector, we may be in an irq handler */
+        outb(ATA_COMMAND_IO_PORT, ATA_WRITE_SECTORS);
+        atomic_store(&disk.write_pending, true);
+        wake_up_one(&disk.write_wait);
+}
+
+/* Start the oldest queued request if the controller is idle.  disk.lock is held */
+static void disk_start_next()
+{
+        struct disk_request *req;
+
+        if (disk.active || list_empty(&disk.queue))
+                return;
+
+        req = list_first_entry(&disk.queue, struct disk_request, entry);
+        list_del(&req->entry);
+        disk.active = req;
+        disk_start(req);
+}
+
+static void disk_finish(struct disk_request *req, int status, struct list_head *finished)
+{
+        req->status = status;
+        list_add_tail(&req->entry, finished);
+        disk.active = 0;
+}
+
+static void disk_complete_all(struct list_head *finished)
+{
+        while (!list_empty(finished)) {
+                struct disk_request *req = list_first_entry(finished, struct disk_request, entry);
+                list_del(&req->entry);
+                if (req->complete)
+                        req->complete(req);
+        }
+}
+
+/* The drive raises an irq each time a sector is ready to read, has been written, and once the
+ * write cache is flushed.  Reading the status register acknowledges it
+ */
+static void disk_interrupt(struct interrupt_frame *frame, void *ctx)
+{
+        uint8_t status = insb(ATA_COMMAND_IO_PORT);
+        struct disk_request *req;
+        struct list_head finished;
+
+        list_init(&finished);
+        spin_lock(&disk.lock);
+
+        req = disk.active;
+        if (!req) {
+                spin_unlock(&disk.lock);
+                return;
+        }
+
+        if (status & ERROR_BIT) {
+                disk_finish(req, -EIO, &finished);
+        } else if (req->op == DISK_READ) {
+                if (!(status & STATUS_DRQ)) {
+                        disk_finish(req, -EIO, &finished);
+                } else {
+                        disk_transfer(req);
+                        if (req->done == req->total)
+                                disk_finish(req, 0, &finished);
                 }
+        } else if (req->done == 0) {
+                /* disk_thread hasn't sent the first sector yet, this irq isn't about the write */
+        } else if (req->done < req->total) {
+                disk_transfer(req);
+        } else if (!req->flushing) {
+                /* Every sector is in the drive's cache, only complete once they're on the platter */
+                req->flushing = true;
+                outb(ATA_COMMAND_IO_PORT, ATA_CACHE_FLUSH);
+        } else {
+                disk_finish(req, 0, &finished);
+        }
+
+        disk_start_next();
+        spin_unlock(&disk.lock);
+
+        disk_complete_all(&finished);
+}
+
+/* Feeds the first sector of each write to the drive.  Polling for it can take a while, so it is
+ * done here, with interrupts on and without disk.lock, rather than wherever the write was started
+ */
+static void disk_thread(void *arg)
+{
+        while (1) {
+                struct list_head finished;
+                struct disk_request *req;
+                uint32_t flags;
+                int res;
+
+                wait_event(&disk.write_wait, atomic_load(&disk.write_pending));
+                atomic_store(&disk.write_pending, false);
+
+                flags = spin_lock_irqsave(&disk.lock);
+                req = disk.active;
+                spin_unlock_irqrestore(&disk.lock, flags);
+                if (!req || req->op != DISK_WRITE || req->done)
+                        continue;
 
-                /* Copy from the hard disk to memory */
-                for (int j = 0; j < DISK_SECTOR_SIZE / 2; j++) {
-                        *ptr = insw(ATA_DATA_PORT);
-                        ptr++;
+                res = disk_wait_drq();
+
+                /* Only an error irq can end the write before its first sector, check it didn't */
+                list_init(&finished);
+                flags = spin_lock_irqsave(&disk.lock);
+                if (disk.active == req && req->done == 0) {
+                        if (res < 0) {
+                                disk_finish(req, res, &finished);
+                                disk_start_next();
+                        } else {
+                                disk_transfer(req);
+                        }
                 }
 
+                spin_unlock_irqrestore(&disk.lock, flags);
+                disk_complete_all(&finished);
         }
+}
+
+int disk_submit(struct disk *idisk, struct disk_request *req)
+{
+        uint32_t flags;
+
+        if (idisk != &disk)
+                return -EINVARG;                        // not a disk disk_get handed out, e.g. 0 for a missing one
 
+        if (req->total <= 0 || req->total > DISK_MAX_SECTORS)
+                return -EINVARG;
+
+        /* Before it is queued, so no page cache miss can cache the old data after this */
+        if (req->op == DISK_WRITE)
+                page_cache_invalidate(req->lba, req->total);
+
+        flags = spin_lock_irqsave(&disk.lock);
+        list_add_tail(&req->entry, &disk.queue);
+        disk_start_next();
+        spin_unlock_irqrestore(&disk.lock, flags);
 
         return 0;
 }
 
+static void disk_sync_complete(struct disk_request *req)
+{
+        atomic_store((uint32_t *)req->data, 1);
+        wake_up_all(&disk.sync_wait);
+}
+
+/* Submit a request and sleep until the irq handler says it's done.  Other threads get the cpu
+ * while the drive works, instead of us polling the status register
+ */
+static int disk_request_sync(struct disk *idisk, enum disk_op op, unsigned int lba, int total, void *buf)
+{
+        struct disk_request req;
+        uint32_t finished = 0;
+        int res;
+
+        memset(&req, 0, sizeof(req));
+        req.op = op;
+        req.lba = lba;
+        req.total = total;
+        req.buf = buf;
+        req.complete = disk_sync_complete;
+        req.data = &finished;
+
+        res = disk_submit(idisk, &req);
+        if (res < 0)
+                return res;
+
+        wait_event(&disk.sync_wait, atomic_load(&finished));
+        return req.status;
+}
+
 /* Doesn't do actual search yet.  Just here for the future when we have more disks than the physical hard drive */
 void disk_search_and_init()  
 {
         memset(&disk, 0, sizeof(struct disk));
         disk.type = REAL;
         disk.sector_size = DISK_SECTOR_SIZE;
+        spin_lock_init(&disk.lock, &disk_lock_class);
+        list_init(&disk.queue);
+        wait_queue_init(&disk.sync_wait);
+        wait_queue_init(&disk.write_wait);
+
+        if (!thread_create("disk", 0, disk_thread, 0))
+                panic("disk: no memory for the disk thread");
+
+        irq_register(IRQ_VECTOR_BASE + ATA_IRQ, disk_interrupt, 0);
+        irq_unmask(ATA_IRQ);
+        outb(ATA_CONTROL_PORT, 0);
 }
 
 /* For now, since we only have one disk, the implementation is very basic */
@@ -69,8 +288,10 @@ struct disk *disk_get(int index)
 
 int disk_read_block(struct disk *idisk, unsigned int lba, int total, void *buf)
 {
-        if (idisk != &disk)
-                return -EIO;                            // disk wasn't initialized yet
+        return disk_request_sync(idisk, DISK_READ, lba, total, buf);
+}
 
-        return disk_read_sector(lba, total, buf);       // eventually, disk_read_sector will take in a base port # which it acquires from disk
-}
\ No newline at end of file
+int disk_write_block(struct disk *idisk, unsigned int lba, int total, const void *buf)
+{
+        return disk_request_sync(idisk, DISK_WRITE, lba, total, (void *)buf);
+}
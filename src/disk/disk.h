@@ -1,20 +1,59 @@
 #ifndef DISK_H
 #define DISK_H
 
+#include <stdint.h>
+#include "lib/list.h"
+#include "lib/spinlock.h"
+#include "task/wait.h"
+
 #define DISK_SECTOR_SIZE        512
+#define DISK_MAX_SECTORS        256                             // most sectors one command can transfer
 
 enum disk_type {
         REAL,                   // represents real physical hard drive
 };
 
+enum disk_op {
+        DISK_READ,
+        DISK_WRITE,
+};
+
+struct disk_request;
+
+/* Called from the disk's irq handler once a request is done, so it must not sleep */
+typedef void (*disk_complete_t)(struct disk_request *req);
+
+/* One read or write, owned by the disk from disk_submit until complete is called */
+struct disk_request {
+        enum disk_op op;
+        uint32_t lba;
+        int total;                      // sectors, 1 to DISK_MAX_SECTORS
+        void *buf;
+        int status;                     // 0 or a negative status code, valid in complete
+        disk_complete_t complete;
+        void *data;                     // for complete
+        int done;                       // sectors transferred so far
+        bool flushing;                  // writes: all sectors are out, waiting for the cache flush
+        struct list_head entry;         // on the disk's queue
+};
+
 struct disk {
         enum disk_type type;
         int sector_size;
+        spinlock_t lock;                // protects queue and active, taken by the irq handler too
+        struct list_head queue;         // requests waiting for the controller, oldest first
+        struct disk_request *active;    // the request the controller is working on, 0 when idle
+        struct wait_queue sync_wait;    // threads in disk_read_block and disk_write_block
+        struct wait_queue write_wait;   // the disk thread, waiting for a write to start
+        bool write_pending;             // a write command was issued, the disk thread sends its first sector
 };
 
 
 /* disk_search_and_init
  * Searches for disks and initializes them 
+ *
+ * prereq - called irq_controller_init() and idt_init(), reads are interrupt driven, and
+ * thread_init(), writes need the disk thread
  */
 void disk_search_and_init();
 
@@ -26,16 +65,31 @@ void disk_search_and_init();
  */
 struct disk *disk_get(int index);
 
+/*
+ * disk_submit
+ * Queue a request and return without waiting for it
+ *
+ * The controller takes one command at a time, requests are started in the order they were
+ * submitted.  The irq handler moves the data a sector at a time as the drive asks for it and
+ * calls req->complete when the request is done.  Safe from any context.  Returns -EINVARG if
+ * idisk isn't a disk or req's sector count is out of range, in which case complete is never called
+ */
+int disk_submit(struct disk *idisk, struct disk_request *req);
+
 /*
  * disk_read_block
  * 
  * idisk - the disk to read from
  * lba - the logical block address to start the read at
- * lba - the total number of sectors to read
+ * total - the total number of sectors to read
  * buf - output buffer to store read data
  * 
+ * Submits the read and sleeps until it completes
  */
 int disk_read_block(struct disk *idisk, unsigned int lba, int total, void *buf);
 
+/* Write total sectors from buf starting at lba, sleeping until they are on the disk */
+int disk_write_block(struct disk *idisk, unsigned int lba, int total, const void *buf);
+
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,119 @@
+#include "futex.h"
+#include "task/process.h"
+#include "task/thread.h"
+#include "lib/atomic.h"
+#include "memory/vm/vm.h"
+#include "status.h"
+
+#define FUTEX_MASK		(FUTEX_BUCKETS - 1)
+
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+LOCK_CLASS(futex_lock_class, "futex bucket");
+
+void futex_init()
+{
+	for (int i = 0; i < FUTEX_BUCKETS; i++) {
+		spin_lock_init(&buckets[i].lock, &futex_lock_class);
+		list_init(&buckets[i].waiters);
+		wait_queue_init(&buckets[i].wait);
+	}
+}
+
+/* Words in the same cache line mostly belong to one lock, so hash on the line */
+static struct futex_bucket *futex_bucket(uint32_t key)
+{
+	uint32_t line = key / 64;
+
+	return &buckets[(line ^ (line / FUTEX_BUCKETS)) & FUTEX_MASK];
+}
+
+/* The key of the word at addr.  Writable: the word is there to be changed, and a copy on write
+ * page has to become the process's own first, or it would sleep on a frame it's about to leave
+ */
+static int futex_key(uint32_t addr, uint32_t *key_out)
+{
+	struct process *self = process_current();
+
+	if (!self || (addr & 3))
+		return -EINVARG;
+
+	return vm_user_phys(self, addr, true, key_out);
+}
+
+int futex_wait(uint32_t addr, uint32_t val)
+{
+	struct process *self = process_current();
+	struct futex_bucket *bucket;
+	struct futex_q q;
+	uint32_t flags;
+	int res = futex_key(addr, &q.key);
+
+	if (res < 0)
+		return res;
+
+	bucket = futex_bucket(q.key);
+	q.woken = false;
+
+	/* Only this thread changes our page tables, so the key still holds.  Frames are identity
+	 * mapped, the word can be read through its key
+	 */
+	flags = spin_lock_irqsave(&bucket->lock);
+
+	if (*(volatile uint32_t *)q.key != val) {
+		spin_unlock_irqrestore(&bucket->lock, flags);
+		return -EAGAIN;
+	}
+
+	list_add_tail(&q.entry, &bucket->waiters);
+	spin_unlock_irqrestore(&bucket->lock, flags);
+
+	/* Queued, so a wake from here on sets woken before it wakes the bucket */
+	wait_event(&bucket->wait, atomic_load(&q.woken) || self->killed);
+	if (atomic_load(&q.woken))
+		return 0;
+
+	/* Killed.  It exits on the way back to ring 3, just get off the bucket first */
+	flags = spin_lock_irqsave(&bucket->lock);
+	if (!q.woken)
+		list_del(&q.entry);
+	spin_unlock_irqrestore(&bucket->lock, flags);
+	return -EAGAIN;
+}
+
+int futex_wake(uint32_t addr, uint32_t count)
+{
+	struct futex_bucket *bucket;
+	struct list_head *pos;
+	struct list_head *n;
+	uint32_t key;
+	uint32_t flags;
+	int woken = 0;
+	int res = futex_key(addr, &key);
+
+	if (res < 0)
+		return res;
+
+	bucket = futex_bucket(key);
+	flags = spin_lock_irqsave(&bucket->lock);
+
+	list_for_each_safe(pos, n, &bucket->waiters) {
+		struct futex_q *q = list_entry(pos, struct futex_q, entry);
+
+		if ((uint32_t)woken == count)
+			break;
+		if (q->key != key)
+			continue;
+
+		list_del(&q->entry);
+		atomic_store(&q->woken, true);
+		woken++;
+	}
+
+	spin_unlock_irqrestore(&bucket->lock, flags);
+
+	/* Waiters on other words in the bucket wake too, see their woken unset and sleep again */
+	if (woken)
+		wake_up_all(&bucket->wait);
+
+	return woken;
+}
@@ -0,0 +1,64 @@
+/* futex.h
+ * fast user space locking
+ *
+ * A futex is a 32 bit word in user memory.  User space takes and releases its locks with atomic
+ * instructions on the word and only enters the kernel when there is contention: FUTEX_WAIT to
+ * sleep while the word still holds the value it saw, FUTEX_WAKE to wake whoever sleeps on the
+ * word.  An uncontended lock and unlock needs no system call at all.
+ *
+ * Waiters are keyed by the physical address of the word, so processes sharing a page (IPC_SHARE)
+ * meet on the same futex wherever each of them maps it.  They queue on one of FUTEX_BUCKETS
+ * hashed buckets and sleep on its wait queue.  A wait queue wakes without regard to the key, so
+ * the bucket also lists its waiters with their keys, and a wake marks the ones it picks before
+ * waking the bucket.
+ *
+ * The kernel's check of the word and the queueing happen under the bucket lock, and a wake takes
+ * the same lock, so a wake between user space's last look at the word and the sleep can't be
+ * lost: either the word changed before the check, and FUTEX_WAIT returns -EAGAIN, or the waiter
+ * is queued by the time the wake comes.  There is no timeout.
+ */
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/list.h"
+#include "lib/spinlock.h"
+#include "task/wait.h"
+
+#define FUTEX_BUCKETS		64		// power of 2
+
+#define FUTEX_WAIT		0
+#define FUTEX_WAKE		1
+
+/* A waiter, on its thread's stack while it sleeps */
+struct futex_q {
+	uint32_t key;			// physical address of the word
+	bool woken;			// picked by a futex_wake, and off the bucket's list
+	struct list_head entry;		// on its bucket's waiters
+};
+
+struct futex_bucket {
+	spinlock_t lock;
+	struct list_head waiters;	// struct futex_q, oldest first
+	struct wait_queue wait;		// where they sleep
+};
+
+void futex_init();
+
+/*
+ * futex_wait - sleep on the word at user address addr if it still holds val
+ *
+ * Returns 0 once woken by futex_wake, -EAGAIN right away if the word doesn't hold val or once the
+ * process has been killed, -EINVARG if addr isn't an aligned word of writable memory of the
+ * calling process
+ */
+int futex_wait(uint32_t addr, uint32_t val);
+
+/* Wake up to count threads sleeping on the word at user address addr, oldest first.  Returns the
+ * number woken, or -EINVARG like futex_wait
+ */
+int futex_wake(uint32_t addr, uint32_t count);
+
+#endif /* FUTEX_H */
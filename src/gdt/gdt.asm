@@ -0,0 +1,43 @@
+[BITS 32]
+
+section .asm
+
+global gdt_load
+global tss_load
+global gs_load
+
+gdt_load:
+	push ebp			; preserve caller's frame pointer
+	mov ebp, esp
+
+	mov eax, [ebp+8]		; struct gdtr_desc *
+	lgdt [eax]
+
+	mov eax, [ebp+16]		; data segment selector
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+
+	push dword [ebp+12]		; code segment selector.  cs can only be reloaded with a far jump/return,
+	push .reload_cs			; so fake the far return address and return to the next line through it
+	retf
+.reload_cs:
+	pop ebp
+	ret
+
+tss_load:
+	push ebp
+	mov ebp, esp
+
+	mov eax, [ebp+8]		; tss selector
+	ltr ax				; load the task register
+
+	pop ebp
+	ret
+
+gs_load:
+	mov eax, [esp+4]		; per cpu segment selector
+	mov gs, ax
+	ret
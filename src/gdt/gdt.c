@@ -0,0 +1,204 @@
+#include "gdt.h"
+#include "idt/idt.h"
+#include "idt/exception.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "print/print.h"
+#include "kernel.h"
+#include "config.h"
+#include "status.h"
+#include "smp/smp.h"
+#include "smp/percpu.h"
+
+#define GDT_ACCESS_PRESENT	0x80
+#define GDT_ACCESS_SEGMENT	0x10		// code or data, as opposed to a system descriptor
+#define GDT_ACCESS_CODE		0x0A		// executable, readable
+#define GDT_ACCESS_DATA		0x02		// writable
+#define GDT_ACCESS_TSS		0x09		// 32 bit available tss
+#define GDT_ACCESS_RING3	0x60		// descriptor privilege level 3
+
+#define GDT_FLAGS_4K_32BIT	0xC0		// page granular limit, 32 bit segment
+#define GDT_FLAGS_BYTE		0x00
+#define GDT_FLAGS_BYTE_32BIT	0x40		// byte granular limit, 32 bit segment
+
+#define EFLAGS_RESERVED		0x02		// bit 1 of eflags always reads as 1
+
+struct gdt_entry {
+	uint16_t limit_low;
+	uint16_t base_low;
+	uint8_t base_middle;
+	uint8_t access;
+	uint8_t flags_limit_high;	// flags in the high nibble, limit bits 16-19 in the low nibble
+	uint8_t base_high;
+} __attribute__((packed));
+
+struct gdtr_desc {			// format of the gdtr register
+	uint16_t limit;
+	uint32_t base;
+} __attribute__((packed));
+
+/* Each cpu has its own gdt, since a tss descriptor is marked busy while loaded and every cpu
+ * needs its own tss anyway
+ */
+struct gdt_cpu {
+	struct gdt_entry gdt[GDT_ENTRIES];
+	struct gdtr_desc gdtr;
+	struct tss tss;
+	struct tss double_fault_tss;
+	uint8_t *double_fault_stack;
+};
+
+static struct gdt_cpu *gdt_cpus[CONFIG_MAX_CPUS];
+
+/* The boot cpu's are static, gdt_init runs before the heap exists */
+static struct gdt_cpu boot_gdt;
+static uint8_t boot_double_fault_stack[DOUBLE_FAULT_STACK_SIZE];
+
+extern void gdt_load(struct gdtr_desc *desc, uint32_t code_selector, uint32_t data_selector);
+extern void tss_load(uint32_t selector);
+extern void gs_load(uint32_t selector);
+
+static void gdt_set_entry(struct gdt_entry *gdt, int index, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags)
+{
+	struct gdt_entry *entry = &gdt[index];
+	entry->limit_low = limit & 0xffff;
+	entry->base_low = base & 0xffff;
+	entry->base_middle = (base >> 16) & 0xff;
+	entry->access = access;
+	entry->flags_limit_high = flags | ((limit >> 16) & 0x0f);
+	entry->base_high = base >> 24;
+}
+
+/* Runs as its own hardware task, on its own stack, so it works even when the kernel stack is gone.
+ * The cpu saved the state of the task that faulted in the main tss
+ */
+static void double_fault_task()
+{
+	struct tss *tss = gdt_tss();
+
+	print("Double fault\n");
+	print("eip=");
+	print_hex(tss->eip);
+	print(" esp=");
+	print_hex(tss->esp);
+	print(" ebp=");
+	print_hex(tss->ebp);
+	print("\n");
+
+	panic("Double fault (interrupt or kernel stack overflow?)");
+}
+
+static void gdt_init_double_fault_tss(struct tss *tss, uint8_t *stack)
+{
+	memset(tss, 0, sizeof(*tss));
+	tss->eip = (uint32_t)double_fault_task;
+	tss->esp = (uint32_t)(stack + DOUBLE_FAULT_STACK_SIZE);
+	tss->eflags = EFLAGS_RESERVED;		// interrupts stay off
+	tss->cr3 = (uint32_t)paging_current_pgd();
+	tss->cs = GDT_SELECTOR(GDT_KERNEL_CODE, 0);
+	tss->ds = GDT_SELECTOR(GDT_KERNEL_DATA, 0);
+	tss->es = tss->ds;
+	tss->fs = tss->ds;
+	tss->gs = GDT_SELECTOR(GDT_PERCPU, 0);
+	tss->ss = tss->ds;
+	tss->iomap_base = sizeof(struct tss);
+}
+
+static void gdt_build(struct gdt_cpu *g, struct percpu *area, uint8_t *double_fault_stack)
+{
+	memset(g, 0, sizeof(*g));
+	gdt_init_double_fault_tss(&g->double_fault_tss, double_fault_stack);
+
+	/* Flat 4 GiB segments, we use paging rather than segmentation */
+	gdt_set_entry(g->gdt, GDT_KERNEL_CODE, 0, 0xfffff, GDT_ACCESS_PRESENT | GDT_ACCESS_SEGMENT | GDT_ACCESS_CODE, GDT_FLAGS_4K_32BIT);
+	gdt_set_entry(g->gdt, GDT_KERNEL_DATA, 0, 0xfffff, GDT_ACCESS_PRESENT | GDT_ACCESS_SEGMENT | GDT_ACCESS_DATA, GDT_FLAGS_4K_32BIT);
+	gdt_set_entry(g->gdt, GDT_USER_CODE, 0, 0xfffff, GDT_ACCESS_PRESENT | GDT_ACCESS_SEGMENT | GDT_ACCESS_CODE | GDT_ACCESS_RING3, GDT_FLAGS_4K_32BIT);
+	gdt_set_entry(g->gdt, GDT_USER_DATA, 0, 0xfffff, GDT_ACCESS_PRESENT | GDT_ACCESS_SEGMENT | GDT_ACCESS_DATA | GDT_ACCESS_RING3, GDT_FLAGS_4K_32BIT);
+	gdt_set_entry(g->gdt, GDT_PERCPU, (uint32_t)area, sizeof(*area) - 1,
+		      GDT_ACCESS_PRESENT | GDT_ACCESS_SEGMENT | GDT_ACCESS_DATA, GDT_FLAGS_BYTE_32BIT);
+
+	/* The main tss gives the kernel stack to switch to on the way in from ring 3 (esp0, kept
+	 * up to date by the scheduler) and is where the cpu saves our state to when it switches to
+	 * the double fault task
+	 */
+	g->tss.ss0 = GDT_SELECTOR(GDT_KERNEL_DATA, 0);
+	g->tss.iomap_base = sizeof(struct tss);		// no io permission bitmap
+	gdt_set_entry(g->gdt, GDT_TSS, (uint32_t)&g->tss, sizeof(g->tss) - 1, GDT_ACCESS_PRESENT | GDT_ACCESS_TSS, GDT_FLAGS_BYTE);
+	gdt_set_entry(g->gdt, GDT_DOUBLE_FAULT_TSS, (uint32_t)&g->double_fault_tss, sizeof(g->double_fault_tss) - 1,
+		      GDT_ACCESS_PRESENT | GDT_ACCESS_TSS, GDT_FLAGS_BYTE);
+
+	g->gdtr.limit = sizeof(g->gdt) - 1;
+	g->gdtr.base = (uint32_t)g->gdt;
+	g->double_fault_stack = double_fault_stack;
+}
+
+int gdt_init_cpu(int cpu)
+{
+	struct percpu *area = percpu_area(cpu);
+	struct gdt_cpu *g;
+	uint8_t *stack;
+
+	if (!area)
+		return -EINVARG;
+
+	g = kmalloc(sizeof(struct gdt_cpu));
+	if (!g)
+		return -ENOMEM;
+
+	stack = kzalloc(DOUBLE_FAULT_STACK_SIZE);
+	if (!stack) {
+		kfree(g);
+		return -ENOMEM;
+	}
+
+	gdt_build(g, area, stack);
+	gdt_cpus[cpu] = g;
+	return 0;
+}
+
+void gdt_free_cpu(int cpu)
+{
+	struct gdt_cpu *g = gdt_cpus[cpu];
+
+	if (cpu == 0 || !g)
+		return;
+
+	gdt_cpus[cpu] = 0;
+	kfree(g->double_fault_stack);
+	kfree(g);
+}
+
+void gdt_load_cpu(int cpu)
+{
+	struct gdt_cpu *g = gdt_cpus[cpu];
+
+	gdt_load(&g->gdtr, GDT_SELECTOR(GDT_KERNEL_CODE, 0), GDT_SELECTOR(GDT_KERNEL_DATA, 0));
+	tss_load(GDT_SELECTOR(GDT_TSS, 0));
+	gs_load(GDT_SELECTOR(GDT_PERCPU, 0));
+}
+
+void gdt_init()
+{
+	gdt_build(&boot_gdt, percpu_init(0), boot_double_fault_stack);
+	gdt_cpus[0] = &boot_gdt;
+	gdt_load_cpu(0);
+}
+
+void gdt_set_kernel_pgd(uint32_t *pgd)
+{
+	for (int i = 0; i < CONFIG_MAX_CPUS; i++) {
+		if (gdt_cpus[i])
+			gdt_cpus[i]->double_fault_tss.cr3 = (uint32_t)pgd;
+	}
+}
+
+struct tss *gdt_tss()
+{
+	return &gdt_cpus[smp_processor_id()]->tss;
+}
+
+void gdt_set_kernel_stack(uint32_t esp0)
+{
+	gdt_tss()->esp0 = esp0;
+}
@@ -0,0 +1,88 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include <stdint.h>
+
+/* Descriptor indexes in the gdt.  Kernel code/data and user code/data must stay in this
+ * order and next to each other, sysenter/sysexit derive the other selectors from the first
+ */
+#define GDT_NULL		0
+#define GDT_KERNEL_CODE		1
+#define GDT_KERNEL_DATA		2
+#define GDT_USER_CODE		3		// ring 3 code, USER_CODE_SELECTOR in config.h
+#define GDT_USER_DATA		4		// ring 3 data and stack, USER_DATA_SELECTOR
+#define GDT_TSS			5
+#define GDT_DOUBLE_FAULT_TSS	6
+#define GDT_PERCPU		7		// data segment based at the cpu's struct percpu, kept in gs
+#define GDT_ENTRIES		8
+
+#define GDT_SELECTOR(index, rpl)	(((index) << 3) | (rpl))
+
+/* 32 bit task state segment (Intel SDM vol 3, figure 7-2) */
+struct tss {
+	uint32_t link;
+	uint32_t esp0;			// stack loaded on a switch to ring 0
+	uint32_t ss0;
+	uint32_t esp1;
+	uint32_t ss1;
+	uint32_t esp2;
+	uint32_t ss2;
+	uint32_t cr3;
+	uint32_t eip;
+	uint32_t eflags;
+	uint32_t eax;
+	uint32_t ecx;
+	uint32_t edx;
+	uint32_t ebx;
+	uint32_t esp;
+	uint32_t ebp;
+	uint32_t esi;
+	uint32_t edi;
+	uint32_t es;
+	uint32_t cs;
+	uint32_t ss;
+	uint32_t ds;
+	uint32_t fs;
+	uint32_t gs;
+	uint32_t ldt;
+	uint16_t trap;
+	uint16_t iomap_base;
+} __attribute__((packed));
+
+/*
+ * gdt_init - replace the boot sector's gdt with the boot cpu's own, load its tss and point gs
+ * at its per cpu area
+ *
+ * Also sets up the double fault task: a double fault switches to a separate tss with its own
+ * stack, so it can still be reported when the kernel stack is what overflowed.
+ *
+ * Needs nothing else to be set up, and must run before anything uses per cpu data (the heap
+ * does).  Call gdt_set_kernel_pgd once paging is on.
+ */
+void gdt_init();
+
+/* Tell the double fault tasks which page directory to switch to */
+void gdt_set_kernel_pgd(uint32_t *pgd);
+
+/*
+ * gdt_init_cpu - build the gdt, tss and double fault task for cpu, without loading them
+ *
+ * Returns -ENOMEM if they can't be allocated
+ *
+ * prereq - percpu_init(cpu)
+ */
+int gdt_init_cpu(int cpu);
+
+/* Free what gdt_init_cpu built for cpu, which must not have loaded it or be running */
+void gdt_free_cpu(int cpu);
+
+/* Load the gdt, tss and per cpu segment gdt_init_cpu built for cpu on the calling processor */
+void gdt_load_cpu(int cpu);
+
+/* The task state segment of the calling cpu */
+struct tss *gdt_tss();
+
+/* Stack the calling cpu switches to when an interrupt or exception takes it out of ring 3 */
+void gdt_set_kernel_stack(uint32_t esp0);
+
+#endif /* GDT_H */
@@ -0,0 +1,115 @@
+#include "exception.h"
+#include "cpu/cpu.h"
+#include "print/print.h"
+#include "kernel.h"
+#include "task/process.h"
+
+/* Refer to the Intel SDM vol 3, table 6-1 */
+static const char *exception_names[EXCEPTION_COUNT] = {
+	"Divide error",
+	"Debug",
+	"Non maskable interrupt",
+	"Breakpoint",
+	"Overflow",
+	"BOUND range exceeded",
+	"Invalid opcode",
+	"Device not available",
+	"Double fault",
+	"Coprocessor segment overrun",
+	"Invalid TSS",
+	"Segment not present",
+	"Stack segment fault",
+	"General protection fault",
+	"Page fault",
+	"Reserved",
+	"x87 floating point error",
+	"Alignment check",
+	"Machine check",
+	"SIMD floating point exception",
+	"Virtualization exception",
+	"Control protection exception",
+	"Reserved",
+	"Reserved",
+	"Reserved",
+	"Reserved",
+	"Reserved",
+	"Reserved",
+	"Hypervisor injection exception",
+	"VMM communication exception",
+	"Security exception",
+	"Reserved",
+};
+
+const char *exception_name(int vector)
+{
+	if (vector < 0 || vector >= EXCEPTION_COUNT)
+		return "Not an exception";
+
+	return exception_names[vector];
+}
+
+static void print_reg(const char *name, uint32_t val)
+{
+	print(name);
+	print("=");
+	print_hex(val);
+	print(" ");
+}
+
+void interrupt_frame_print(struct interrupt_frame *frame)
+{
+	print_reg("vector", frame->vector);
+	print_reg("error", frame->error_code);
+	print("\n");
+	print_reg("eip", frame->eip);
+	print_reg("cs", frame->cs);
+	print_reg("eflags", frame->eflags);
+	print("\n");
+	print_reg("eax", frame->eax);
+	print_reg("ebx", frame->ebx);
+	print_reg("ecx", frame->ecx);
+	print_reg("edx", frame->edx);
+	print("\n");
+	print_reg("esi", frame->esi);
+	print_reg("edi", frame->edi);
+	print_reg("ebp", frame->ebp);
+	print_reg("esp", frame->kernel_esp);
+	print("\n");
+	print_reg("ds", frame->ds);
+	print_reg("es", frame->es);
+	print_reg("fs", frame->fs);
+	print_reg("gs", frame->gs);
+	print("\n");
+
+	if (interrupt_frame_from_user(frame)) {
+		print_reg("user esp", frame->user_esp);
+		print_reg("user ss", frame->user_ss);
+		print("\n");
+	}
+}
+
+void exception_unhandled(struct interrupt_frame *frame)
+{
+	print(exception_name(frame->vector));
+	print("\n");
+	if (frame->vector == EXCEPTION_PAGE_FAULT) {
+		print_reg("fault address", interrupt_frame_from_user(frame) ? thread_current()->fault_address : read_cr2());
+		print("\n");
+	}
+	interrupt_frame_print(frame);
+
+	/* A fault in ring 3 is the process's problem, not the kernel's */
+	if (interrupt_frame_from_user(frame) && process_current()) {
+		process_kill(process_current());
+		return;
+	}
+
+	switch (frame->vector) {
+	case EXCEPTION_DEBUG:
+	case EXCEPTION_NMI:
+	case EXCEPTION_BREAKPOINT:
+		return;
+	default:
+		panic(exception_name(frame->vector));
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef EXCEPTION_H
+#define EXCEPTION_H
+
+#include "irq.h"
+
+/* Vectors 0-31 are reserved for exceptions raised by the cpu itself */
+#define EXCEPTION_COUNT		32
+
+#define EXCEPTION_DIVIDE_ERROR	0
+#define EXCEPTION_DEBUG		1
+#define EXCEPTION_NMI		2
+#define EXCEPTION_BREAKPOINT	3
+#define EXCEPTION_DOUBLE_FAULT	8
+#define EXCEPTION_GP_FAULT	13
+#define EXCEPTION_PAGE_FAULT	14
+
+/* Page fault error code bits */
+#define PAGE_FAULT_PRESENT	0x01		// set: protection violation, clear: page not present
+#define PAGE_FAULT_WRITE	0x02
+#define PAGE_FAULT_USER		0x04
+
+/* Name of exception vector, e.g. "Page fault" */
+const char *exception_name(int vector);
+
+/* Print every register in frame */
+void interrupt_frame_print(struct interrupt_frame *frame);
+
+/*
+ * exception_unhandled - called by the dispatcher for an exception nobody registered a handler for
+ *
+ * Debug traps, breakpoints and NMIs are reported and execution continues, everything else is
+ * reported and panics.  Except in user mode, where the faulting process gets killed instead
+ */
+void exception_unhandled(struct interrupt_frame *frame);
+
+#endif /* EXCEPTION_H */
@@ -1,20 +1,41 @@
 section .asm
 
-extern int21h_handler
-extern int_generic_handler
+KERNEL_DATA_SEG equ 0x10
+PERCPU_SEG equ 0x38			; GDT_PERCPU in gdt.h
+EXCEPTION_COUNT equ 32
+FRAME_VECTOR equ 48			; offset of the vector in struct interrupt_frame (after pushad and 4 segment registers)
+FRAME_CS equ 60				; offset of the interrupted cs, its low 2 bits are the privilege level we came from
+
+extern interrupt_dispatch
+extern irq_stack_enter
+extern irq_stack_leave
+extern sched_preempt_irq
+extern process_return_to_user
 
 global idt_load
-global int21h_entry
-global int_generic_entry
+global int_stub_table
 global enable_interrupts
 global disable_interrupts
+global interrupts_save_disable
+global interrupts_restore
 
 enable_interrupts:
-	sti 
+	sti
 	ret
 
 disable_interrupts:
-	cli 
+	cli
+	ret
+
+interrupts_save_disable:
+	pushfd				; return the current eflags (which holds the interrupt flag) and then disable interrupts
+	pop eax
+	cli
+	ret
+
+interrupts_restore:
+	push dword [esp+4]		; eflags value returned by interrupts_save_disable
+	popfd				; only re-enables interrupts if they were enabled when they were saved
 	ret
 
 idt_load:
@@ -27,19 +48,84 @@ idt_load:
 	pop ebp				; restore the caller's base pointer value by popping ebp off the stack
 	ret				; return to the caller - ret finds and removes the appropriate return address from the stack
 
-int21h_entry:				; keyboard interrupt handler (Interrupt vector #0x21)
-	cli				; clear interrupt flag
-	pushad				; Push EAX, ECX, EDX, EBX, original ESP, EBP, ESI, and EDI (all general purpose registers)
-	call int21h_handler
-	popad				; restore general purpose registers
-	sti				; set interrupt flag (allow processor to respond to maskable hardware interrupts)
-	iret				; interrupt return
+; Every vector gets its own tiny entry stub that records which vector fired and then joins the common path.
+; This way drivers register a C handler with irq_register instead of writing a new stub in here.
+;
+; The cpu pushes an error code for some exceptions (double fault, invalid tss, segment not present, stack fault,
+; general protection, page fault, alignment check, control protection, vmm communication and security exceptions)
+; but not for anything else.  The stubs for everything else push a dummy 0, so every frame has the same layout.
+%assign i 0
+%rep 256
+int_stub_%+i:
+%if !(i == 8 || (i >= 10 && i <= 14) || i == 17 || i == 21 || i == 29 || i == 30)
+	push dword 0			; dummy error code
+%endif
+	push dword i			; vector number, becomes part of the interrupt frame
+	jmp int_common_entry
+%assign i i+1
+%endrep
 
-int_generic_entry:				; for interrupts vectors that we haven't written handlers for yet
-	cli				; clear interrupt flag
+int_common_entry:			; we come in through an interrupt gate, so the cpu has already cleared the interrupt flag
+	push ds				; save the segment registers, we may have come from code using different ones
+	push es
+	push fs
+	push gs
 	pushad				; Push EAX, ECX, EDX, EBX, original ESP, EBP, ESI, and EDI (all general purpose registers)
-	call int_generic_handler
+
+	mov ax, KERNEL_DATA_SEG		; make sure the c code runs with the kernel's data segments
+	mov ds, ax
+	mov es, ax
+	mov ax, PERCPU_SEG		; and with gs on this cpu's per cpu area
+	mov gs, ax
+	cld				; the c code expects the direction flag to be clear
+
+	mov ebx, esp			; esp now points at the saved registers, which is our struct interrupt_frame.
+					; ebx is callee saved, so it still points there after the call
+
+	; Hardware interrupts move onto the dedicated interrupt stack, unless they nested on top of one
+	; that is already using it.  Exceptions stay on the stack they interrupted, their handlers may sleep
+	cmp dword [ebx+FRAME_VECTOR], EXCEPTION_COUNT
+	jb .dispatch
+	call irq_stack_enter		; returns this cpu's interrupt stack, or 0 if we're already on it
+	test eax, eax
+	jz .dispatch
+	mov esp, eax
+
+.dispatch:
+	push ebx			; struct interrupt_frame *
+	call interrupt_dispatch
+	mov esp, ebx			; back to the interrupted stack (and pops the argument)
+
+	cmp dword [ebx+FRAME_VECTOR], EXCEPTION_COUNT
+	jb .restore
+	call irq_stack_leave		; interrupts are still disabled here
+	test al, al			; bool return, only al is defined
+	jz .restore
+
+	; Leaving the outermost hardware interrupt, on the interrupted thread's stack.  If that thread
+	; is switched out here, the frame waits on its stack until it's switched back in
+	call sched_preempt_irq
+
+.restore:
+	test dword [ebx+FRAME_CS], 3
+	jz .restore_regs
+	push ebx			; on the way back to ring 3, a killed process exits here instead
+	call process_return_to_user
+	add esp, 4
+
+.restore_regs:
 	popad				; restore general purpose registers
-	sti				; set interrupt flag (allow processor to respond to maskable hardware interrupts)
-	iret				; interrupt return
+	pop gs
+	pop fs
+	pop es
+	pop ds
+	add esp, 8			; pop the vector number and error code
+	iret				; interrupt return - restores eflags, which turns interrupts back on
 
+; Addresses of the stubs above, indexed by vector.  idt_init points each idt entry at its stub
+int_stub_table:
+%assign i 0
+%rep 256
+	dd int_stub_%+i
+%assign i i+1
+%endrep
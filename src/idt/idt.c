@@ -2,12 +2,11 @@
 #include "memory/memory.h"
 #include "config.h"
 #include "print/print.h"		// TODO: make some sort of include folder so I don't have to use relative paths in includes
-#include "io/io.h"
+#include "irq.h"
+#include "exception.h"
+#include "gdt/gdt.h"
 #include <stdint.h>
 
-#define CONIFEROS_TOTAL_INTERRUPTS 256	
-
-
 struct idt_entry {			// idt entry for interreupt gate descriptor
 	uint16_t offset_1; 
 	uint16_t selector;
@@ -25,28 +24,7 @@ static struct idt_entry idt[CONIFEROS_TOTAL_INTERRUPTS];
 static struct idtr_desc idtr;
 
 extern void idt_load(struct idtr_desc  *val);
-extern void int21h_entry();
-extern void int_generic_entry();
-
-void int21h_handler()
-{
-	print("Keyboard pressed\n");
-	outb(0x20, 0x20);		// send PIC an acknowledgment
-}
-
-void int_generic_handler()
-{
-	outb(0x20, 0x20);		// send PIC an acknowledgment
-}
-
-/* 
- * idt_zero - handler for interrupt 0
- */
-void idt_zero()
-{
-	print("Divide by zero error\n");
-}
-
+extern void *int_stub_table[CONIFEROS_TOTAL_INTERRUPTS];	/* per vector entry stubs, see idt.asm */
 
 /*
  * idt_set - set the ith entry in the idt with the given handler function
@@ -60,25 +38,48 @@ void idt_set(int i, void *handler)
 	entry->offset_1 = (uint32_t)handler & 0x0000ffff;
 	entry->selector = KERNEL_CODE_SELECTOR;
 	entry->zero = 0x00;
-	entry->type_attr = 0xEE;
+	entry->type_attr = 0x8E;		// present, ring 0, 32 bit interrupt gate.  User code can't int n into it
 	entry->offset_2 = (uint32_t)handler >> 16;
 }
 
+void idt_set_user(int i, void *handler)
+{
+	idt_set(i, handler);
+	idt[i].type_attr = 0xEE;		// present, ring 3, 32 bit interrupt gate
+}
+
+/*
+ * idt_set_task_gate - make interrupt i switch to the hardware task described by the tss at tss_selector
+ */
+void idt_set_task_gate(int i, uint16_t tss_selector)
+{
+	struct idt_entry *entry = &idt[i];
+	entry->offset_1 = 0;			// unused, the tss says where to go
+	entry->selector = tss_selector;
+	entry->zero = 0x00;
+	entry->type_attr = 0x85;		// present, ring 0, 32 bit task gate
+	entry->offset_2 = 0;
+}
+
 void idt_init()
 {
 	memset(idt, 0, sizeof(idt));	
 	idtr.limit = sizeof(idt) - 1;
 	idtr.base = (uint32_t)idt;
 
-	/* Set interrupt vectors to generic handler */
+	/* Every vector enters through its own stub, which hands off to interrupt_dispatch */
 	for (int i = 0; i < CONIFEROS_TOTAL_INTERRUPTS; i++) {
-		idt_set(i, int_generic_entry);
+		idt_set(i, int_stub_table[i]);
 	}
-	
 
-	idt_set(0, idt_zero);
-	idt_set(0x21, int21h_entry);
+	/* Except double faults, which get a fresh stack through a task switch */
+	idt_set_task_gate(EXCEPTION_DOUBLE_FAULT, GDT_SELECTOR(GDT_DOUBLE_FAULT_TSS, 0));
 
 	/* Load the interrupt descriptor table */
 	idt_load(&idtr);
 }
+
+void idt_init_ap()
+{
+	idt_load(&idtr);
+}
@@ -1,11 +1,10 @@
 #ifndef IDT_H
 #define IDT_H
 
+#include "irq.h"
+#include <stdint.h>
 
-/* 
- * idt_zero - handler for interrupt 0
- */
-void idt_zero();
+#define CONIFEROS_TOTAL_INTERRUPTS 256
 
 /*
  * idt_set - set the ith entry in the idt with the given handler function
@@ -15,11 +14,35 @@ void idt_zero();
  */ 
 void idt_set(int i, void *handler);
 
+/*
+ * idt_set_user - like idt_set, but ring 3 may raise interrupt i with int n.  For system call gates
+ */
+void idt_set_user(int i, void *handler);
+
+/*
+ * idt_set_task_gate - make interrupt i switch to the hardware task described by the tss at tss_selector
+ */
+void idt_set_task_gate(int i, uint16_t tss_selector);
+
+/*
+ * idt_init - point every vector at its entry stub and load the idt
+ *
+ * prereq - called gdt_init() and irq_controller_init()
+ */
 void idt_init();
 
+/* Load the idt idt_init built on an application processor */
+void idt_init_ap();
+
 void enable_interrupts();
 
 void disable_interrupts();
 
+/* Disable interrupts, returning the previous eflags for interrupts_restore.  Nests safely */
+uint32_t interrupts_save_disable();
+
+/* Put the interrupt flag back to what it was when flags was saved */
+void interrupts_restore(uint32_t flags);
+
 
 #endif /* IDT_H */
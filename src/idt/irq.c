@@ -0,0 +1,272 @@
+#include "irq.h"
+#include "idt.h"
+#include "cpu/cpu.h"
+#include "pic/pic.h"
+#include "apic/apic.h"
+#include "softirq/softirq.h"
+#include "exception.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "kernel.h"
+#include "config.h"
+#include "print/print.h"
+#include "status.h"
+#include "smp/percpu.h"
+#include "task/thread.h"
+
+struct irq_desc {
+	irq_handler_t handler;
+	void *ctx;
+};
+
+static struct irq_desc irq_table[CONIFEROS_TOTAL_INTERRUPTS];
+
+static struct irq_percpu *this_irq_cpu()
+{
+	return &this_cpu()->irq;
+}
+
+static int irq_valid_vector(int vector)
+{
+	return vector >= 0 && vector < CONIFEROS_TOTAL_INTERRUPTS;
+}
+
+void irq_controller_init()
+{
+	pic_init();
+
+	if (apic_init() == 0) {
+		print("Interrupts routed through the IO APIC\n");
+	} else {
+		print("Interrupts routed through the 8259 PIC\n");
+	}
+}
+
+void irq_unmask(int irq)
+{
+	if (irq < 0 || irq >= IRQ_LEGACY_COUNT)
+		return;
+
+	if (apic_enabled()) {
+		ioapic_unmask(irq);
+	} else {
+		pic_unmask(irq);
+	}
+}
+
+void irq_mask(int irq)
+{
+	if (irq < 0 || irq >= IRQ_LEGACY_COUNT)
+		return;
+
+	if (apic_enabled()) {
+		ioapic_mask(irq);
+	} else {
+		pic_mask(irq);
+	}
+}
+
+void irq_stack_init(int cpu)
+{
+	uint8_t *stack = kmalloc(IRQ_STACK_SIZE + PAGING_PAGE_SIZE);
+	if (!stack)
+		panic("Failed to allocate the interrupt stack");
+
+	/* Unmap the lowest page.  Overflowing into it faults, and since the fault can't be pushed
+	 * onto the same stack, that escalates to a double fault, which has a stack of its own
+	 */
+	paging_set(paging_current_pgd(), stack, 0);
+	paging_invalidate(stack);
+
+	percpu_area(cpu)->irq.stack_top = (uint32_t)(stack + PAGING_PAGE_SIZE + IRQ_STACK_SIZE);
+}
+
+void irq_stack_free(int cpu)
+{
+	struct percpu *area = percpu_area(cpu);
+	uint8_t *stack;
+
+	if (!area || !area->irq.stack_top)
+		return;
+
+	/* Map the guard page again before it goes back to the heap */
+	stack = (uint8_t *)area->irq.stack_top - IRQ_STACK_SIZE - PAGING_PAGE_SIZE;
+	paging_set(paging_current_pgd(), stack, (uint32_t)stack | PAGING_PRESENT | PAGING_READ_WRITE);
+	paging_invalidate(stack);
+
+	area->irq.stack_top = 0;
+	kfree(stack);
+}
+
+uint32_t irq_stack_enter()
+{
+	struct irq_percpu *c = this_irq_cpu();
+	return ++c->stack_depth == 1 ? c->stack_top : 0;
+}
+
+bool irq_stack_leave()
+{
+	return --this_irq_cpu()->stack_depth == 0;
+}
+
+int irq_register(int vector, irq_handler_t fn, void *ctx)
+{
+	if (!irq_valid_vector(vector) || !fn)
+		return -EINVARG;
+
+	if (irq_table[vector].handler)
+		return -EBUSY;
+
+	irq_table[vector].ctx = ctx;
+	irq_table[vector].handler = fn;
+	return 0;
+}
+
+int irq_unregister(int vector)
+{
+	if (!irq_valid_vector(vector))
+		return -EINVARG;
+
+	irq_table[vector].handler = 0;
+	irq_table[vector].ctx = 0;
+	return 0;
+}
+
+int irq_get_stats(int vector, struct irq_stats *out)
+{
+	if (!irq_valid_vector(vector))
+		return -EINVARG;
+
+	out->calls = 0;
+	out->cycles = 0;
+	for (int i = 0; i < CONFIG_MAX_CPUS; i++) {
+		struct percpu *area = percpu_area(i);
+		if (!area)
+			continue;
+
+		out->calls += area->irq.stats[vector].calls;
+		out->cycles += area->irq.stats[vector].cycles;
+	}
+	return 0;
+}
+
+void irq_print_stats()
+{
+	for (int i = 0; i < CONIFEROS_TOTAL_INTERRUPTS; i++) {
+		struct irq_stats stats;
+		irq_get_stats(i, &stats);
+		if (!stats.calls)
+			continue;
+
+		print("vector ");
+		print_hex(i);
+		print(": calls ");
+		print_dec(stats.calls);
+		print(" cycles ");
+		print_dec(stats.cycles);
+		print("\n");
+	}
+
+	print("max cycles with interrupts off: ");
+	print_dec(irq_off_max_cycles());
+	print("\n");
+}
+
+uint64_t irq_off_max_cycles()
+{
+	uint64_t max = 0;
+
+	for (int i = 0; i < CONFIG_MAX_CPUS; i++) {
+		struct percpu *area = percpu_area(i);
+		if (area && area->irq.off_max > max)
+			max = area->irq.off_max;
+	}
+	return max;
+}
+
+bool in_interrupt()
+{
+	return this_irq_cpu()->nesting != 0;
+}
+
+/* Only hardware interrupts get acknowledged.  Cpu exceptions, software interrupts and spurious
+ * interrupts must not be, an eoi would retire whatever interrupt is really in service
+ */
+static void interrupt_eoi(int vector)
+{
+	if (vector < IRQ_VECTOR_BASE || vector >= IRQ_VECTOR_END)
+		return;
+
+	if (apic_enabled()) {
+		lapic_eoi();			// one uncached store, no port io
+	} else if (vector < IRQ_VECTOR_BASE + IRQ_LEGACY_COUNT) {
+		pic_eoi(vector - IRQ_VECTOR_BASE);
+	}
+}
+
+/* Only ever the calling cpu's counters, so no other cpu races the update */
+static void irq_account(struct irq_percpu *c, int vector, uint64_t cycles)
+{
+	c->stats[vector].calls++;
+	c->stats[vector].cycles += cycles;
+}
+
+static bool interrupt_is_hardware(int vector)
+{
+	return vector >= IRQ_VECTOR_BASE && vector < IRQ_VECTOR_END;
+}
+
+void interrupt_dispatch(struct interrupt_frame *frame)
+{
+	struct irq_desc *desc = &irq_table[frame->vector];
+	struct irq_percpu *c = this_irq_cpu();
+	uint64_t start = read_tsc();
+	uint64_t elapsed;
+
+	/* An exception raised in ring 3 is handled on behalf of the process, like a system call:
+	 * with interrupts on and outside interrupt context, so the handler may sleep, e.g. on the
+	 * disk to page something in
+	 */
+	if (frame->vector < EXCEPTION_COUNT && interrupt_frame_from_user(frame)) {
+		/* Another thread's page fault could overwrite cr2 once we can be preempted */
+		if (frame->vector == EXCEPTION_PAGE_FAULT)
+			thread_current()->fault_address = read_cr2();
+
+		enable_interrupts();
+		if (desc->handler) {
+			desc->handler(frame, desc->ctx);
+		} else {
+			exception_unhandled(frame);
+		}
+		disable_interrupts();
+
+		irq_account(this_irq_cpu(), frame->vector, read_tsc() - start);
+		return;
+	}
+
+	c->nesting++;
+
+	if (desc->handler) {
+		desc->handler(frame, desc->ctx);
+	} else if (frame->vector < EXCEPTION_COUNT) {
+		exception_unhandled(frame);
+	}
+
+	interrupt_eoi(frame->vector);
+
+	elapsed = read_tsc() - start;
+	irq_account(c, frame->vector, elapsed);
+	if (elapsed > c->off_max)
+		c->off_max = elapsed;
+
+	/* Leaving the outermost hardware interrupt: run the work its handler deferred, with
+	 * interrupts enabled so it doesn't hold up anyone else's
+	 */
+	if (c->nesting == 1 && interrupt_is_hardware(frame->vector) && softirq_pending()) {
+		enable_interrupts();
+		softirq_run();
+		disable_interrupts();
+	}
+
+	c->nesting--;
+}
@@ -0,0 +1,144 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Vector layout.  Isa irq n is delivered on IRQ_VECTOR_BASE + n, interrupts raised by the local
+ * apic itself (timer, ipis) live right above them.  Everything in [IRQ_VECTOR_BASE, IRQ_VECTOR_END)
+ * is hardware generated and gets an eoi after its handler runs
+ */
+#define IRQ_VECTOR_BASE		0x20
+#define IRQ_LEGACY_COUNT	16
+#define IRQ_LOCAL_VECTOR_BASE	0x30
+#define IRQ_VECTOR_END		0x40
+#define IRQ_SPURIOUS_VECTOR	0xFF
+#define IRQ_VECTORS		256		// all of the idt, CONIFEROS_TOTAL_INTERRUPTS
+
+/* Layout of the stack built by int_common_entry in idt.asm.  Fields are in the
+ * reverse order of how they were pushed.  Handlers may modify the frame, the interrupted
+ * code resumes with whatever it holds on return
+ */
+struct interrupt_frame {
+	/* pushad */
+	uint32_t edi;
+	uint32_t esi;
+	uint32_t ebp;
+	uint32_t kernel_esp;		// value of esp before pushad, not restored by popad
+	uint32_t ebx;
+	uint32_t edx;
+	uint32_t ecx;
+	uint32_t eax;
+
+	/* pushed by int_common_entry, only the low 16 bits are meaningful */
+	uint32_t gs;
+	uint32_t fs;
+	uint32_t es;
+	uint32_t ds;
+
+	/* pushed by the per vector stub (error_code by the cpu for some exceptions) */
+	uint32_t vector;
+	uint32_t error_code;
+
+	/* pushed by the cpu */
+	uint32_t eip;
+	uint32_t cs;
+	uint32_t eflags;
+
+	/* only pushed by the cpu on a privilege change, i.e. when we interrupted ring 3 */
+	uint32_t user_esp;
+	uint32_t user_ss;
+} __attribute__((packed));
+
+/* True if the frame was pushed on entry from user mode, which means user_esp and user_ss are valid */
+#define interrupt_frame_from_user(frame)	(((frame)->cs & 0x3) != 0)
+
+typedef void (*irq_handler_t)(struct interrupt_frame *frame, void *ctx);
+
+/* Per vector accounting, updated by the dispatcher on every interrupt.  Each cpu counts its own,
+ * irq_get_stats adds them up
+ */
+struct irq_stats {
+	uint32_t calls;
+	uint64_t cycles;		// cumulative tsc cycles spent in the handler and the eoi
+};
+
+/* Interrupt state of one cpu, lives in its struct percpu */
+struct irq_percpu {
+	uint32_t nesting;		// interrupt_dispatch calls in progress
+	uint32_t stack_top;		// 0 until irq_stack_init, then interrupts stay on the thread stack
+	uint32_t stack_depth;		// hardware interrupts in progress, the stack is switched going 0 -> 1
+	uint64_t off_max;		// longest stretch spent in interrupt context with interrupts off
+	struct irq_stats stats[IRQ_VECTORS];
+};
+
+/*
+ * irq_controller_init - set up interrupt routing
+ *
+ * Remaps the 8259 PICs and then hands routing over to the io apic if there is one.  Every
+ * irq line starts masked, use irq_unmask once a handler is registered.
+ *
+ * prereq - paging is set up
+ */
+void irq_controller_init();
+
+/*
+ * irq_stack_init - allocate the guarded stack hardware interrupts run on for cpu
+ *
+ * prereq - paging is set up and percpu_init(cpu)
+ */
+void irq_stack_init(int cpu);
+
+/* Free cpu's interrupt stack, for an application processor that never came up */
+void irq_stack_free(int cpu);
+
+/*
+ * irq_stack_enter/irq_stack_leave - bracket a hardware interrupt, called by int_common_entry
+ *
+ * irq_stack_enter returns the top of this cpu's interrupt stack for the outermost interrupt, or 0
+ * to stay on the current stack.  irq_stack_leave returns true when leaving the outermost one
+ */
+uint32_t irq_stack_enter();
+bool irq_stack_leave();
+
+/* Let isa irq (0-15) through, on whichever controller is routing interrupts */
+void irq_unmask(int irq);
+
+/* Block isa irq (0-15) */
+void irq_mask(int irq);
+
+/*
+ * irq_register - install fn as the handler for vector
+ *
+ * Cpu exceptions (vectors 0-31) without a registered handler are reported by exception_unhandled.
+ * Handlers of exceptions raised in ring 3 run with interrupts enabled and may sleep.
+ * ctx is passed back to fn unchanged on every call.  Returns 0 on success, -EINVARG for
+ * a bad vector or handler and -EBUSY if the vector already has a handler
+ */
+int irq_register(int vector, irq_handler_t fn, void *ctx);
+
+/* Remove the handler for vector.  Later interrupts on vector are only acknowledged and counted */
+int irq_unregister(int vector);
+
+/* Sum the accounting for vector over every cpu into out */
+int irq_get_stats(int vector, struct irq_stats *out);
+
+/* Print the call count and cycles of every vector that has fired at least once, and the
+ * longest time interrupts were kept off
+ */
+void irq_print_stats();
+
+/* Longest time, in tsc cycles, a single interrupt kept interrupts disabled on any cpu.  Measured from
+ * entering the dispatcher until the handler and eoi are done, deferred work doesn't count
+ */
+uint64_t irq_off_max_cycles();
+
+/* True while running an interrupt or exception handler.  Exceptions from user mode don't count, they
+ * run in the context of the process that raised them
+ */
+bool in_interrupt();
+
+/* Called from int_common_entry for every interrupt */
+void interrupt_dispatch(struct interrupt_frame *frame);
+
+#endif /* IRQ_H */
@@ -11,6 +11,6 @@ unsigned short insw(unsigned short port);
 void outb(unsigned short port, unsigned char val);
 
 /* output word val to port */
-void outw(unsigned short port, unsigned char val);
+void outw(unsigned short port, unsigned short val);
 
 #endif
@@ -0,0 +1,406 @@
+#include "ioring.h"
+#include "task/process.h"
+#include "task/thread.h"
+#include "memory/vm/vm.h"
+#include "memory/paging/paging.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "idt/idt.h"
+#include "timer/timer.h"
+#include "lib/atomic.h"
+#include "lib/math.h"
+#include "config.h"
+#include "status.h"
+
+#define IORING_PAGE_ALIGN(x)		(((x) + PAGING_PAGE_SIZE - 1) & ~(PAGING_PAGE_SIZE - 1))
+#define IORING_SQPOLL_IDLE_TICKS	((IORING_SQPOLL_IDLE_MS * TIMER_HZ + 999) / 1000)
+
+LOCK_CLASS(ioring_lock_class, "io ring");
+
+static struct ioring *ioring_current()
+{
+	struct process *process = process_current();
+	return process ? process->ioring : 0;
+}
+
+/* Take an operation slot, or return 0 if there's no room for another completion in the CQ */
+static struct ioring_op *ioring_op_alloc(struct ioring *ring)
+{
+	uint32_t flags = spin_lock_irqsave(&ring->lock);
+	uint32_t unreaped = ring->cq_tail - atomic_load(&ring->shared->cq_head);
+	struct ioring_op *op = ring->free_ops;
+
+	if (!op || ring->inflight + unreaped >= ring->cq_entries) {
+		spin_unlock_irqrestore(&ring->lock, flags);
+		return 0;
+	}
+
+	ring->free_ops = op->next_free;
+	ring->inflight++;
+	spin_unlock_irqrestore(&ring->lock, flags);
+	return op;
+}
+
+/* Post op's completion and give its slot back.  Safe from interrupts */
+static void ioring_complete(struct ioring_op *op, int res)
+{
+	struct ioring *ring = op->ring;
+	uint32_t flags = spin_lock_irqsave(&ring->lock);
+	uint32_t head = atomic_load(&ring->shared->cq_head);
+
+	if (ring->cq_tail - head < ring->cq_entries) {
+		struct ioring_cqe *cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+		cqe->user_data = op->user_data;
+		cqe->res = res;
+		cqe->flags = 0;
+
+		/* Release: the entry is visible before the tail that publishes it */
+		ring->cq_tail++;
+		atomic_store(&ring->shared->cq_tail, ring->cq_tail);
+	} else {
+		/* Only if the process moved cq_head past entries we never posted */
+		ring->shared->cq_overflow++;
+	}
+
+	op->opcode = IORING_OP_NOP;
+	op->next_free = ring->free_ops;
+	ring->free_ops = op;
+	ring->inflight--;
+
+	/* Still under the lock, ioring_destroy frees the ring as soon as it sees inflight drop to 0 */
+	wake_up_all(&ring->cq_wait);
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
+
+static void ioring_disk_complete(struct disk_request *req)
+{
+	ioring_complete(req->data, req->status < 0 ? req->status : req->total * DISK_SECTOR_SIZE);
+}
+
+static void ioring_timeout(void *data)
+{
+	ioring_complete(data, 0);
+}
+
+/* Start the operation sqe describes.  Returns a negative status code if it can't be started,
+ * which becomes its completion
+ */
+static int ioring_issue(struct ioring *ring, struct ioring_op *op, const struct ioring_sqe *sqe)
+{
+	uint64_t ticks;
+	uint32_t bytes;
+
+	if (sqe->flags)
+		return -EINVARG;
+
+	switch (sqe->opcode) {
+	case IORING_OP_NOP:
+		ioring_complete(op, 0);
+		return 0;
+
+	case IORING_OP_READ:
+	case IORING_OP_WRITE:
+		if (!sqe->len || sqe->len > DISK_MAX_SECTORS)
+			return -EINVARG;
+
+		bytes = sqe->len * DISK_SECTOR_SIZE;
+		if (sqe->off > ring->buffers_size || bytes > ring->buffers_size - sqe->off)
+			return -EINVARG;
+
+		/* The boot sector and the kernel are off limits, writes stay in the data area */
+		if (sqe->opcode == IORING_OP_WRITE &&
+		    (sqe->lba < DISK_DATA_LBA || sqe->lba - DISK_DATA_LBA > DISK_DATA_SECTORS - sqe->len))
+			return -EINVARG;
+
+		memset(&op->disk, 0, sizeof(op->disk));
+		op->disk.op = sqe->opcode == IORING_OP_READ ? DISK_READ : DISK_WRITE;
+		op->disk.lba = sqe->lba;
+		op->disk.total = sqe->len;
+		op->disk.buf = ring->buffers + sqe->off;
+		op->disk.complete = ioring_disk_complete;
+		op->disk.data = op;
+		return disk_submit(disk_get(0), &op->disk);
+
+	case IORING_OP_TIMEOUT:
+		/* Round up, a timeout never fires early */
+		ticks = sqe->timeout_ns;
+		div64_32(&ticks, TIMER_NSEC_PER_TICK);
+		if (ticks * TIMER_NSEC_PER_TICK < sqe->timeout_ns)
+			ticks++;
+
+		timer_setup(&op->timer, ioring_timeout, op);
+		timer_add(&op->timer, timer_jiffies() + ticks);
+		return 0;
+
+	default:
+		return -EINVARG;
+	}
+}
+
+/* Consume up to to_submit entries from the SQ.  Returns how many were consumed, including ones
+ * that failed straight away, whose completions are already posted
+ */
+static uint32_t ioring_submit(struct ioring *ring, uint32_t to_submit)
+{
+	uint32_t submitted = 0;
+
+	mutex_lock(&ring->submit_lock);
+
+	while (submitted < to_submit && atomic_load(&ring->shared->sq_tail) != ring->sq_head) {
+		struct ioring_sqe sqe;
+		struct ioring_op *op = ioring_op_alloc(ring);
+		int res;
+
+		if (!op)
+			break;
+
+		/* Copy it first, the process can change the shared one under us */
+		memcpy(&sqe, &ring->sqes[ring->sq_head & (ring->sq_entries - 1)], sizeof(sqe));
+		ring->sq_head++;
+		atomic_store(&ring->shared->sq_head, ring->sq_head);
+
+		op->opcode = sqe.opcode;
+		op->user_data = sqe.user_data;
+		res = ioring_issue(ring, op, &sqe);
+		if (res < 0)
+			ioring_complete(op, res);
+
+		submitted++;
+	}
+
+	mutex_unlock(&ring->submit_lock);
+	return submitted;
+}
+
+static bool ioring_sq_pending(struct ioring *ring)
+{
+	return atomic_load(&ring->shared->sq_tail) != ring->sq_head;
+}
+
+/* IORING_SETUP_SQPOLL: submit whatever the process publishes, without it making system calls.
+ * After IORING_SQPOLL_IDLE_MS without work it sleeps, and says so in sq_flags
+ */
+static void ioring_sq_thread(void *arg)
+{
+	struct ioring *ring = arg;
+	uint64_t idle_since = timer_jiffies();
+
+	while (!atomic_load(&ring->sq_stop)) {
+		if (ioring_submit(ring, ring->sq_entries)) {
+			idle_since = timer_jiffies();
+			continue;
+		}
+
+		if (timer_jiffies() - idle_since < IORING_SQPOLL_IDLE_TICKS) {
+			thread_yield();
+			continue;
+		}
+
+		/* The flag goes up before the last look at sq_tail (atomic_or is a full barrier), so
+		 * either we see the new entries or the process sees the flag and wakes us
+		 */
+		atomic_or(&ring->shared->sq_flags, IORING_SQ_NEED_WAKEUP);
+		wait_event(&ring->sq_wait, atomic_load(&ring->sq_stop) || ioring_sq_pending(ring));
+		atomic_and(&ring->shared->sq_flags, ~IORING_SQ_NEED_WAKEUP);
+		idle_since = timer_jiffies();
+	}
+
+	/* ioring_destroy frees the ring once it sees sq_exited, don't let it run until we're off it */
+	disable_interrupts();
+	ring->sq_exited = true;
+	wake_up_all(&ring->sq_wait);
+	thread_exit();
+}
+
+static void ioring_unmap(struct ioring *ring, uint32_t size)
+{
+	for (uint32_t offset = 0; offset < size; offset += PAGING_PAGE_SIZE) {
+		void *addr = (void *)(IORING_USER_ADDRESS + offset);
+		paging_set(get_pgd(ring->process->paging), addr, 0);
+		paging_invalidate(addr);
+	}
+}
+
+/* Map the ring's memory into its process, reserving the range so nothing else lands on it */
+static int ioring_map(struct ioring *ring)
+{
+	struct process *process = ring->process;
+	int res;
+
+	res = vm_area_add(process, IORING_USER_ADDRESS, IORING_USER_ADDRESS + ring->size, VM_WRITE, 0, 0);
+	if (res < 0)
+		return res == -ENOMEM ? res : -EBUSY;
+
+	for (uint32_t offset = 0; offset < ring->size; offset += PAGING_PAGE_SIZE) {
+		res = paging_map_user(process->paging, (void *)(IORING_USER_ADDRESS + offset), ring->mem + offset,
+				      PAGING_READ_WRITE | PAGING_SHARED);
+		if (res < 0) {
+			ioring_unmap(ring, offset);
+			vm_area_remove(process, IORING_USER_ADDRESS);
+			return res;
+		}
+	}
+
+	return 0;
+}
+
+static void ioring_free(struct ioring *ring)
+{
+	if (ring->ops)
+		kfree(ring->ops);
+	if (ring->mem)
+		kfree(ring->mem);
+	kfree(ring);
+}
+
+int ioring_setup(uint32_t entries, uint32_t flags)
+{
+	struct process *process = process_current();
+	struct ioring *ring;
+	int res;
+	uint32_t sqes_offset = IORING_PAGE_ALIGN(sizeof(struct ioring_shared));
+	uint32_t cqes_offset = sqes_offset + IORING_PAGE_ALIGN(entries * sizeof(struct ioring_sqe));
+	uint32_t buffers_offset = cqes_offset + IORING_PAGE_ALIGN(2 * entries * sizeof(struct ioring_cqe));
+
+	if (!process)
+		return -ENODEV;
+
+	if (!entries || entries > IORING_MAX_ENTRIES || (entries & (entries - 1)) || (flags & ~IORING_SETUP_SQPOLL))
+		return -EINVARG;
+
+	if (process->ioring)
+		return -EBUSY;
+
+	ring = kzalloc(sizeof(struct ioring));
+	if (!ring)
+		return -ENOMEM;
+
+	ring->process = process;
+	ring->sq_entries = entries;
+	ring->cq_entries = 2 * entries;
+	ring->buffers_size = IORING_BUFFER_SIZE;
+	ring->size = buffers_offset + IORING_BUFFER_SIZE;
+	ring->mem = kzalloc(ring->size);
+	ring->ops = kzalloc(ring->cq_entries * sizeof(struct ioring_op));
+	if (!ring->mem || !ring->ops) {
+		ioring_free(ring);
+		return -ENOMEM;
+	}
+
+	ring->shared = (struct ioring_shared *)ring->mem;
+	ring->sqes = (struct ioring_sqe *)(ring->mem + sqes_offset);
+	ring->cqes = (struct ioring_cqe *)(ring->mem + cqes_offset);
+	ring->buffers = ring->mem + buffers_offset;
+
+	ring->shared->sq_entries = ring->sq_entries;
+	ring->shared->cq_entries = ring->cq_entries;
+	ring->shared->sqes_offset = sqes_offset;
+	ring->shared->cqes_offset = cqes_offset;
+	ring->shared->buffers_offset = buffers_offset;
+	ring->shared->buffers_size = ring->buffers_size;
+
+	for (uint32_t i = 0; i < ring->cq_entries; i++) {
+		ring->ops[i].ring = ring;
+		ring->ops[i].next_free = ring->free_ops;
+		ring->free_ops = &ring->ops[i];
+	}
+
+	mutex_init(&ring->submit_lock);
+	spin_lock_init(&ring->lock, &ioring_lock_class);
+	wait_queue_init(&ring->cq_wait);
+	wait_queue_init(&ring->sq_wait);
+
+	res = ioring_map(ring);
+	if (res < 0) {
+		ioring_free(ring);
+		return res;
+	}
+
+	if (flags & IORING_SETUP_SQPOLL) {
+		ring->sq_thread = thread_create("io ring sq", thread_current()->base_priority, ioring_sq_thread, ring);
+		if (!ring->sq_thread) {
+			ioring_unmap(ring, ring->size);
+			vm_area_remove(process, IORING_USER_ADDRESS);
+			ioring_free(ring);
+			return -ENOMEM;
+		}
+	}
+
+	process->ioring = ring;
+	return IORING_USER_ADDRESS;
+}
+
+/* Completions posted and not reaped yet */
+static uint32_t ioring_cq_ready(struct ioring *ring)
+{
+	return ring->cq_tail - atomic_load(&ring->shared->cq_head);
+}
+
+/* Nothing is in flight or waiting to be, so no more completions are coming */
+static bool ioring_idle(struct ioring *ring)
+{
+	return !ring->inflight && !ioring_sq_pending(ring);
+}
+
+int ioring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+	struct ioring *ring = ioring_current();
+	uint32_t submitted = 0;
+
+	if (!ring)
+		return -ENODEV;
+
+	if (ring->sq_thread) {
+		/* The polling thread consumes the SQ, all we can do is make sure it's awake */
+		if ((flags & IORING_ENTER_SQ_WAKEUP) || (atomic_load(&ring->shared->sq_flags) & IORING_SQ_NEED_WAKEUP))
+			wake_up_all(&ring->sq_wait);
+	} else {
+		submitted = ioring_submit(ring, to_submit);
+	}
+
+	if (flags & IORING_ENTER_GETEVENTS)
+		wait_event(&ring->cq_wait, ioring_cq_ready(ring) >= min_complete || ioring_idle(ring));
+
+	return submitted;
+}
+
+void ioring_destroy(struct process *process)
+{
+	struct ioring *ring = process->ioring;
+	uint32_t flags;
+
+	if (!ring)
+		return;
+
+	if (ring->sq_thread) {
+		atomic_store(&ring->sq_stop, true);
+		wake_up_all(&ring->sq_wait);
+		wait_event(&ring->sq_wait, ring->sq_exited);
+	}
+
+	/* Disk requests finish on their own, but a timeout could be far off.  Cancel the ones whose
+	 * timer hasn't been picked up to run yet
+	 */
+	for (uint32_t i = 0; i < ring->cq_entries; i++) {
+		struct ioring_op *op = &ring->ops[i];
+		bool cancel;
+
+		flags = interrupts_save_disable();
+		cancel = op->opcode == IORING_OP_TIMEOUT && timer_pending(&op->timer);
+		if (cancel)
+			timer_del(&op->timer);
+		interrupts_restore(flags);
+
+		if (cancel)
+			ioring_complete(op, -EBUSY);
+	}
+
+	wait_event(&ring->cq_wait, !ring->inflight);
+
+	/* The last ioring_complete may still be on its way out of the lock */
+	flags = spin_lock_irqsave(&ring->lock);
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+	process->ioring = 0;
+	ioring_free(ring);
+}
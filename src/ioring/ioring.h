@@ -0,0 +1,157 @@
+/* ioring.h
+ * batched asynchronous system calls, in the shape of Linux's io_uring
+ *
+ * A process can set up one io ring: a submission queue (SQ) and a completion queue (CQ) in
+ * memory mapped into both its user space and the kernel's, plus a buffer area for the data
+ * operations move.  The process writes submission entries and bumps sq_tail, the kernel consumes
+ * them, runs the operations asynchronously and posts a completion entry for each one with the
+ * caller's user_data.  Any number of operations cost at most one io_ring_enter system call, and
+ * none at all with IORING_SETUP_SQPOLL, where a kernel thread watches sq_tail.
+ *
+ * Each queue has one producer and one consumer, so the indices need no locks: the producer
+ * fills entries and then publishes them with a store to its tail, the consumer reads them and
+ * then frees them with a store to its head.  Indices run freely and wrap at 2^32, entry i lives
+ * at index i & mask.
+ *
+ * The kernel never trusts what's in shared memory.  It keeps its own copies of the sizes and
+ * its own indices, copies each submission entry before looking at it, and only touches
+ * buffers inside the buffer area.
+ */
+
+#ifndef IORING_H
+#define IORING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "disk/disk.h"
+#include "timer/timer_wheel.h"
+#include "lib/spinlock.h"
+#include "task/mutex.h"
+#include "task/wait.h"
+
+/* io_ring_setup flags */
+#define IORING_SETUP_SQPOLL	0x01		// a kernel thread submits, io_ring_enter only waits
+
+/* io_ring_enter flags */
+#define IORING_ENTER_GETEVENTS	0x01		// wait for min_complete completions
+#define IORING_ENTER_SQ_WAKEUP	0x02		// wake the polling thread up
+
+/* sq_flags */
+#define IORING_SQ_NEED_WAKEUP	0x01		// the polling thread went to sleep, io_ring_enter wakes it.
+						// Read it after a full barrier (mfence) behind the sq_tail store
+
+/* Operations */
+#define IORING_OP_NOP		0
+#define IORING_OP_READ		1		// read sectors [lba, lba + len) into the buffer area at off
+#define IORING_OP_WRITE		2		// write sectors [lba, lba + len) from the buffer area at off.
+						// Only inside the disk's data area, see DISK_DATA_LBA in config.h
+#define IORING_OP_TIMEOUT	3		// complete after timeout_ns nanoseconds
+
+/* A submission queue entry, written by the process */
+struct ioring_sqe {
+	uint8_t opcode;
+	uint8_t flags;				// none yet, must be 0
+	uint16_t reserved;
+	uint32_t lba;
+	uint32_t len;				// sectors
+	uint32_t off;				// byte offset into the buffer area
+	uint64_t user_data;			// copied into the completion
+	uint64_t timeout_ns;
+};
+
+/* A completion queue entry, written by the kernel */
+struct ioring_cqe {
+	uint64_t user_data;
+	int32_t res;				// bytes moved, or a negative status code
+	uint32_t flags;
+};
+
+/*
+ * The start of the ring's memory.  The kernel fills in everything but the heads and tails at
+ * setup, offsets are from this header.  Producer and consumer indices live on separate cache
+ * lines so the two sides don't bounce one line back and forth
+ */
+struct ioring_shared {
+	uint32_t sq_entries;			// a power of 2
+	uint32_t cq_entries;			// twice sq_entries
+	uint32_t sqes_offset;
+	uint32_t cqes_offset;
+	uint32_t buffers_offset;
+	uint32_t buffers_size;
+	uint32_t pad0[10];
+
+	uint32_t sq_head;			// kernel: entries consumed
+	uint32_t sq_flags;			// kernel: IORING_SQ_*
+	uint32_t cq_tail;			// kernel: entries posted
+	uint32_t cq_overflow;			// kernel: completions dropped because the CQ was full
+	uint32_t pad1[12];
+
+	uint32_t sq_tail;			// process: entries published
+	uint32_t cq_head;			// process: entries reaped
+	uint32_t pad2[14];
+};
+
+struct ioring;
+
+/* Kernel side state of an operation, from submission until its completion is posted */
+struct ioring_op {
+	struct ioring *ring;
+	uint8_t opcode;
+	uint64_t user_data;
+	struct disk_request disk;		// IORING_OP_READ and IORING_OP_WRITE
+	struct timer timer;			// IORING_OP_TIMEOUT
+	struct ioring_op *next_free;
+};
+
+struct ioring {
+	struct process *process;
+	uint8_t *mem;				// the shared memory, kernel heap so identity mapped
+	uint32_t size;
+	struct ioring_shared *shared;
+	struct ioring_sqe *sqes;
+	struct ioring_cqe *cqes;
+	uint8_t *buffers;
+
+	/* Our own copies, whatever the process does to the shared memory */
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t buffers_size;
+	uint32_t sq_head;
+	uint32_t cq_tail;
+
+	struct mutex submit_lock;		// one consumer of the SQ at a time
+	spinlock_t lock;			// cq_tail, inflight and the free ops, completions come from irqs
+	struct ioring_op *ops;			// cq_entries of them, so completions can't overflow the CQ
+	struct ioring_op *free_ops;
+	uint32_t inflight;			// submitted, not completed yet
+	struct wait_queue cq_wait;		// io_ring_enter waiting for completions, and ioring_destroy
+
+	struct thread *sq_thread;		// IORING_SETUP_SQPOLL only
+	struct wait_queue sq_wait;		// the polling thread, asleep after idling
+	bool sq_stop;
+	bool sq_exited;
+};
+
+/*
+ * ioring_setup - give the calling process an io ring with entries submission entries
+ *
+ * entries is a power of 2 up to IORING_MAX_ENTRIES.  The ring is mapped at IORING_USER_ADDRESS,
+ * which is returned.  Returns -EINVARG for a bad entries or flags, -EBUSY if the process already
+ * has a ring or the address is taken, -ENOMEM if out of memory
+ */
+int ioring_setup(uint32_t entries, uint32_t flags);
+
+/*
+ * ioring_enter - submit up to to_submit entries and, with IORING_ENTER_GETEVENTS, sleep until
+ * at least min_complete completions are waiting in the CQ
+ *
+ * The wait also ends once nothing is in flight, so it can't sleep forever on completions that
+ * will never come.  Returns the number of entries consumed from the SQ, which is fewer than
+ * to_submit when the SQ runs dry or every operation slot is busy, or -ENODEV without a ring
+ */
+int ioring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+/* Tear down process's ring, if it has one, waiting for operations in flight.  Called by process_exit */
+void ioring_destroy(struct process *process);
+
+#endif /* IORING_H */
@@ -0,0 +1,279 @@
+#include "ipc.h"
+#include "task/process.h"
+#include "task/thread.h"
+#include "memory/paging/paging.h"
+#include "memory/vm/frame_ref.h"
+#include "idt/idt.h"
+#include "config.h"
+#include "status.h"
+
+void ipc_endpoint_init(struct ipc_endpoint *ipc)
+{
+	ipc->state = IPC_IDLE;
+	ipc->status = 0;
+	ipc->window = 0;
+	ipc->window_pages = 0;
+	list_init(&ipc->senders);
+	list_init(&ipc->clients);
+	ipc->entry.next = NULL;
+	ipc->entry.prev = NULL;
+}
+
+static bool ipc_range_ok(uint32_t start, uint32_t pages)
+{
+	return paging_is_aligned((void *)start) && start >= PROCESS_USER_START && start < PROCESS_USER_END &&
+	       pages <= (PROCESS_USER_END - start) / PAGING_PAGE_SIZE;
+}
+
+/* Can the pages msg grants move (or share) from from to to?  They must all be mapped, and fit
+ * to's window
+ */
+static int ipc_grant_check(struct process *from, struct process *to, struct ipc_message *msg)
+{
+	uint32_t start = msg->words[0];
+	uint32_t pages = msg->words[1];
+
+	if (!pages || pages > to->ipc.window_pages || !ipc_range_ok(start, pages))
+		return -EINVARG;
+
+	for (uint32_t i = 0; i < pages; i++) {
+		uint32_t entry = paging_get_user(from->paging, (void *)(start + i * PAGING_PAGE_SIZE));
+
+		/* Shared frames belong to a kernel object (the vdso, an io ring), not the process */
+		if (!(entry & PAGING_PRESENT) || (entry & PAGING_SHARED))
+			return -EINVARG;
+
+		/* Only the process's own frames can be shared, and a copy on write page has to be
+		 * written first so there is one frame to share
+		 */
+		if ((msg->flags & IPC_SHARE) && (entry & (PAGING_PAGE_CACHE | PAGING_COW)))
+			return -EINVARG;
+	}
+
+	/* After this, mapping into the window can't fail halfway through */
+	return paging_alloc_user_tables(to->paging, (void *)to->ipc.window, pages * PAGING_PAGE_SIZE);
+}
+
+/* Move the page table entries themselves, so the frames and whatever owns them change hands
+ * without a byte of the data being copied.  Sharing copies the entries instead, with a reference
+ * on each frame for the receiver
+ */
+static void ipc_grant_move(struct process *from, struct process *to, struct ipc_message *msg)
+{
+	uint32_t start = msg->words[0];
+
+	for (uint32_t i = 0; i < msg->words[1]; i++) {
+		void *dest = (void *)(to->ipc.window + i * PAGING_PAGE_SIZE);
+		void *src = (void *)(start + i * PAGING_PAGE_SIZE);
+		uint32_t entry;
+
+		if (msg->flags & IPC_SHARE) {
+			entry = paging_get_user(from->paging, src);
+			frame_get((void *)(entry & PTE_PAGE_FRAME_ADDR));
+		} else {
+			entry = paging_take_user(from->paging, src);
+		}
+
+		paging_unmap_user(to->paging, dest);
+		paging_map_user(to->paging, dest, (void *)(entry & PTE_PAGE_FRAME_ADDR),
+				entry & (PAGING_READ_WRITE | PAGING_PAGE_CACHE | PAGING_COW));
+	}
+
+	msg->words[0] = to->ipc.window;
+}
+
+/* Deliver msg from from to to.  Nothing has moved if it fails.  Interrupts are disabled */
+static int ipc_transfer(struct process *from, struct process *to, struct ipc_message *msg)
+{
+	if (msg->flags & (IPC_GRANT | IPC_SHARE)) {
+		int res = ipc_grant_check(from, to, msg);
+		if (res < 0)
+			return res;
+
+		ipc_grant_move(from, to, msg);
+	}
+
+	to->ipc.msg = *msg;
+	to->ipc.msg.from = from->id;
+	return 0;
+}
+
+/* Sleep, giving the cpu straight to partner if it's blocked waiting for what we just did */
+static void ipc_block(struct thread *partner)
+{
+	if (partner && partner->state == THREAD_BLOCKED) {
+		thread_block_handoff(partner);
+	} else {
+		thread_block();
+	}
+}
+
+int ipc_call(uint32_t server_id, struct ipc_message *msg)
+{
+	struct process *self = process_current();
+	struct process *server;
+	uint32_t flags;
+	int res;
+
+	if (!self)
+		return -ENODEV;
+
+	flags = interrupts_save_disable();
+
+	server = process_find(server_id);
+	if (!server || server == self) {
+		interrupts_restore(flags);
+		return -EINVARG;
+	}
+
+	self->ipc.msg = *msg;
+	self->ipc.status = 0;
+
+	if (server->ipc.state == IPC_RECEIVING) {
+		/* The fast path: the server is waiting for us, switch right over to it */
+		res = ipc_transfer(self, server, &self->ipc.msg);
+		if (res < 0) {
+			interrupts_restore(flags);
+			return res;
+		}
+
+		server->ipc.state = IPC_IDLE;
+		self->ipc.state = IPC_WAITING_REPLY;
+		list_add_tail(&self->ipc.entry, &server->ipc.clients);
+		ipc_block(server->thread);
+	} else {
+		self->ipc.state = IPC_SENDING;
+		list_add_tail(&self->ipc.entry, &server->ipc.senders);
+		thread_block();
+	}
+
+	while (self->ipc.state != IPC_IDLE) {
+		thread_block();
+	}
+
+	*msg = self->ipc.msg;
+	res = self->ipc.status;
+	interrupts_restore(flags);
+	return res;
+}
+
+static struct process *ipc_find_client(struct process *self, uint32_t id)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &self->ipc.clients) {
+		struct process *client = list_entry(pos, struct process, ipc.entry);
+		if (client->id == id)
+			return client;
+	}
+
+	return 0;
+}
+
+/* Take the message of the oldest caller queued on self that can be delivered.  Returns false if
+ * none could.  Callers whose grant doesn't fit are failed instead
+ */
+static bool ipc_receive_queued(struct process *self)
+{
+	while (!list_empty(&self->ipc.senders)) {
+		struct process *sender = list_first_entry(&self->ipc.senders, struct process, ipc.entry);
+		int res;
+
+		list_del(&sender->ipc.entry);
+		res = ipc_transfer(sender, self, &sender->ipc.msg);
+		if (res < 0) {
+			sender->ipc.status = res;
+			sender->ipc.state = IPC_IDLE;
+			thread_wake(sender->thread);
+			continue;
+		}
+
+		sender->ipc.state = IPC_WAITING_REPLY;
+		list_add_tail(&sender->ipc.entry, &self->ipc.clients);
+		return true;
+	}
+
+	return false;
+}
+
+int ipc_reply_wait(uint32_t client_id, struct ipc_message *msg)
+{
+	struct process *self = process_current();
+	struct process *client = 0;
+	uint32_t flags;
+	int res;
+
+	if (!self)
+		return -ENODEV;
+
+	flags = interrupts_save_disable();
+
+	if (client_id) {
+		client = ipc_find_client(self, client_id);
+		if (!client) {
+			interrupts_restore(flags);
+			return -EINVARG;
+		}
+
+		res = ipc_transfer(self, client, msg);
+		if (res < 0) {
+			interrupts_restore(flags);
+			return res;
+		}
+
+		list_del(&client->ipc.entry);
+		client->ipc.status = 0;
+		client->ipc.state = IPC_IDLE;
+	}
+
+	if (ipc_receive_queued(self)) {
+		/* More work already, the client has to wait for the cpu like anyone else */
+		if (client)
+			thread_wake(client->thread);
+	} else {
+		/* Nothing to do until the next call, so the client we just answered runs right away */
+		self->ipc.state = IPC_RECEIVING;
+		ipc_block(client ? client->thread : 0);
+
+		while (self->ipc.state == IPC_RECEIVING) {
+			thread_block();
+		}
+	}
+
+	*msg = self->ipc.msg;
+	interrupts_restore(flags);
+	return 0;
+}
+
+int ipc_set_window(uint32_t address, uint32_t pages)
+{
+	struct process *self = process_current();
+
+	if (!self)
+		return -ENODEV;
+
+	if (pages && !ipc_range_ok(address, pages))
+		return -EINVARG;
+
+	self->ipc.window = address;
+	self->ipc.window_pages = pages;
+	return 0;
+}
+
+static void ipc_fail_all(struct list_head *callers)
+{
+	while (!list_empty(callers)) {
+		struct process *caller = list_first_entry(callers, struct process, ipc.entry);
+
+		list_del(&caller->ipc.entry);
+		caller->ipc.status = -ENODEV;
+		caller->ipc.state = IPC_IDLE;
+		thread_wake(caller->thread);
+	}
+}
+
+void ipc_exit(struct process *process)
+{
+	ipc_fail_all(&process->ipc.senders);
+	ipc_fail_all(&process->ipc.clients);
+}
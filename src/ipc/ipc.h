@@ -0,0 +1,90 @@
+/* ipc.h
+ * synchronous message passing between processes, in the style of L4
+ *
+ * A client calls a server: it sends a short message and sleeps until the server replies.  A
+ * server loops in reply_wait, which answers the last client and waits for the next message in a
+ * single system call.  Messages are IPC_WORDS words passed in registers (esi, edi and ebp), so
+ * the kernel copies nothing through memory.
+ *
+ * If the receiver is already waiting, the kernel switches straight from the sender's thread to
+ * the receiver's without going through the run queue, and the receiver runs on what is left of
+ * the sender's time slice.  Otherwise the sender queues on the receiver and sleeps until the
+ * receiver asks for the next message.
+ *
+ * Longer messages move pages rather than copying them.  With IPC_GRANT, words[0] is the address
+ * and words[1] the number of pages of a range of the sender's mapped memory.  They are unmapped
+ * from the sender and mapped at the receiver's window (ipc_set_window), replacing whatever was
+ * there, and the receiver gets the window's address in words[0].  IPC_SHARE works the same way
+ * but leaves the pages mapped in the sender too, so both write the same frames: shared memory,
+ * e.g. for futexes (futex.h).
+ *
+ * There are no timeouts: two processes that call each other at the same time sleep forever.
+ */
+
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/list.h"
+
+#define IPC_WORDS		3
+#define IPC_GRANT		0x80000000	// or'ed into the process id: the message moves pages
+#define IPC_SHARE		0x40000000	// or'ed into the process id: the message shares pages
+#define IPC_ID_MASK		0x3FFFFFFF
+
+enum ipc_state {
+	IPC_IDLE,
+	IPC_RECEIVING,			// in reply_wait, waiting for a caller
+	IPC_SENDING,			// queued on the server's senders until it receives
+	IPC_WAITING_REPLY,		// the server has the message, on its clients until it replies
+};
+
+struct ipc_message {
+	uint32_t from;			// id of the sender, filled in on delivery
+	uint32_t flags;			// IPC_GRANT or IPC_SHARE
+	uint32_t words[IPC_WORDS];
+};
+
+/* A process's side of ipc, embedded in its struct process */
+struct ipc_endpoint {
+	enum ipc_state state;
+	struct ipc_message msg;		// the message on its way to or from this process
+	int status;			// what a caller woken up by the reply, or the server exiting, returns
+	struct list_head senders;	// callers waiting for us to receive, oldest first
+	struct list_head clients;	// callers whose message we have and who wait for our reply
+	struct list_head entry;		// on the server's senders or clients
+	uint32_t window;		// where pages granted to us get mapped
+	uint32_t window_pages;		// 0 if we don't accept pages
+};
+
+struct process;
+
+void ipc_endpoint_init(struct ipc_endpoint *ipc);
+
+/*
+ * ipc_call - send msg to process server and sleep until it replies
+ *
+ * The reply comes back in msg.  Returns 0, -EINVARG if there is no such process (or it is the
+ * caller) or a grant doesn't fit the server's window or can't be shared, or -ENODEV if the server exits before it
+ * replies
+ */
+int ipc_call(uint32_t server, struct ipc_message *msg);
+
+/*
+ * ipc_reply_wait - reply msg to client, then wait for the next message and return it in msg
+ *
+ * client 0 only waits.  Returns 0, or -EINVARG, without waiting, if client isn't waiting for our
+ * reply or a grant doesn't fit its window or can't be shared
+ */
+int ipc_reply_wait(uint32_t client, struct ipc_message *msg);
+
+/* Map pages granted to the calling process at address, up to pages of them.  Returns -EINVARG
+ * for a range outside user space
+ */
+int ipc_set_window(uint32_t address, uint32_t pages);
+
+/* Fail every ipc waiting on process, which is exiting.  Interrupts are disabled */
+void ipc_exit(struct process *process);
+
+#endif /* IPC_H */
@@ -25,19 +25,13 @@ _start:
 	or al, 2		; in reads from a port and out writes to a port (actually writes to IO address space I believe - specific port is a feature of the chipset)
 	out 0x92, al
 
-	; Remap the master PIC (Assuming that QEMU is emulating a 8259 PIC for us as opposed to a more modern I/O and local APICs)
-	mov al, 00010001b	
-	out 0x20, al		; send 10001b (initialization mode command) to I/O port 0x20 which is Master PIC - Command
+	; The PICs are remapped (and possibly replaced by the APICs) from C, see irq_controller_init
 
-	mov al, 0x20 		; Interrupt 0x20 is where master ISR should start
-	out 0x21, al
-
-	mov al, 00000001b	
-	out 0x21, al		; End initialization mode
-	; End remap of the master PIC
-	
 	call kernel_main
-	jmp $
+.halt:				; kernel_main doesn't return, but if it does, halt instead of spinning a host core
+	cli
+	hlt
+	jmp .halt
 
 
 ; since this assembly file will be in the first section of our final linked executable, we need it to be properly aligned so that the 
@@ -1,28 +1,105 @@
 #include "kernel.h"
 #include "print/print.h"
+#include "lib/spinlock.h"
+#include "task/process.h"
+#include "memory/vm/vm.h"
+#include "pipe/pipe.h"
+#include "loader/elf.h"
+#include "futex/futex.h"
+#include "syscall/syscall.h"
+#include "vdso/vdso.h"
 #include "idt/idt.h"
 #include "io/io.h"
 #include "memory/heap/kernel_heap.h"
 #include "memory/paging/paging.h"
 #include "disk/disk.h"
+#include "timer/clock.h"
+#include "timer/timer.h"
+#include "timer/timer_wheel.h"
+#include "bench/bench.h"
+#include "cpu/idle.h"
+#include "config.h"
+#include "cpu/cpu.h"
+#include "keyboard/keyboard.h"
+#include "gdt/gdt.h"
+#include "task/thread.h"
+#include "acpi/acpi.h"
+#include "smp/smp.h"
+
+void panic(const char *msg)
+{
+	disable_interrupts();
+	terminal_panic();
+	print("Kernel panic: ");
+	print(msg);
+	print("\n");
+
+	while (1) {
+		cpu_halt();
+	}
+}
 
 void kernel_main()
 {
 	terminal_initialize();
 
+	gdt_init();
+
 	kernel_heap_init();
+	thread_init();
 
-	disk_search_and_init();
+	/* Kernel pages are supervisor only, processes get user pages of their own */
+	struct paging_desc *paging = init_page_tables(PAGING_READ_WRITE | PAGING_PRESENT);
+	paging_switch(get_pgd(paging));
+	enable_paging();
+	gdt_set_kernel_pgd(get_pgd(paging));
+	process_init(paging);
+	vm_init();
+	pipe_init();
+	futex_init();
+
+	irq_stack_init(0);
+
+	clock_init();
+	vdso_init();
+
+	acpi_init();
+	irq_controller_init();
 
 	idt_init();
+	syscall_init();
 
-	struct paging_desc *paging = init_page_tables(PAGING_READ_WRITE | PAGING_PRESENT | PAGING_USER_SUPERVISOR);
-	paging_switch(get_pgd(paging));
-	enable_paging();
+	timer_init();
+	timer_wheel_kernel_init();
+
+	keyboard_init();
+	disk_search_and_init();
+
+	smp_init();
 
 	enable_interrupts();
 
-	print("Welcome to ConiferOS");
+	print("Welcome to ConiferOS\n");
+
+	if (CONFIG_BENCHMARKS) {
+		bench_timer_wheel();
+		bench_irq_latency();
+		bench_smp_memset();
+		bench_locks();
+		bench_task_pool();
+		bench_syscall();
+		bench_vdso();
+		bench_ipc();
+		bench_pipe();
+		bench_elf_exec();
+	}
+
+	if (CONFIG_LOCK_STAT)
+		lock_stat_print();
+
+	/* The first user program is whatever executable the disk's data area starts with */
+	if (elf_exec("init", DISK_DATA_LBA, 0) < 0)
+		print("No init program on the disk\n");
 
-	return;
+	cpu_idle_loop();
 }
@@ -3,4 +3,7 @@
 
 void kernel_main();
 
+/* Print msg and stop this cpu for good */
+void panic(const char *msg);
+
 #endif /* KERNEL_H */
@@ -0,0 +1,218 @@
+#include "keyboard.h"
+#include "io/io.h"
+#include "idt/irq.h"
+#include "softirq/softirq.h"
+#include "task/wait.h"
+#include "lib/atomic.h"
+#include "print/print.h"
+
+/* Refer to the OSDev Wiki "8042" PS/2 Controller article */
+#define PS2_DATA_PORT		0x60
+#define PS2_STATUS_PORT		0x64
+#define PS2_STATUS_OUTPUT_FULL	0x01
+#define PS2_MAX_BYTES_PER_IRQ	16		// bounds the time spent in the handler
+
+#define SCANCODE_EXTENDED	0xE0
+#define SCANCODE_RELEASED	0x80
+#define SCANCODE_LSHIFT		0x2A
+#define SCANCODE_RSHIFT		0x36
+#define SCANCODE_CTRL		0x1D
+#define SCANCODE_ALT		0x38
+#define SCANCODE_CAPS_LOCK	0x3A
+
+#define KEYBOARD_IRQ		1
+
+/*
+ * Single producer / single consumer ring.  Only the interrupt handler writes head and only
+ * the consumer writes tail, so neither side needs a lock: each publishes its index with a
+ * release store after touching the slot, and reads the other's index with an acquire load.
+ */
+static struct {
+	uint8_t buf[KEYBOARD_RING_SIZE];
+	uint32_t head;			// next slot to fill, free running
+	uint32_t tail;			// next slot to drain, free running
+	uint32_t dropped;
+} ring;
+
+/* Decoder state, only touched by the consumer */
+static uint8_t modifiers = 0;
+static bool extended = false;
+
+static struct softirq_work keyboard_work;
+static struct wait_queue keyboard_wait;
+static bool keyboard_has_reader = false;		// set by the first keyboard_read, ends the echo
+
+/* Scancode set 1 (US QWERTY) to ascii, built at compile time */
+static const char keymap[128] = {
+	[0x01] = 27, [0x02] = '1', [0x03] = '2', [0x04] = '3', [0x05] = '4', [0x06] = '5',
+	[0x07] = '6', [0x08] = '7', [0x09] = '8', [0x0A] = '9', [0x0B] = '0', [0x0C] = '-',
+	[0x0D] = '=', [0x0E] = '\b', [0x0F] = '\t', [0x10] = 'q', [0x11] = 'w', [0x12] = 'e',
+	[0x13] = 'r', [0x14] = 't', [0x15] = 'y', [0x16] = 'u', [0x17] = 'i', [0x18] = 'o',
+	[0x19] = 'p', [0x1A] = '[', [0x1B] = ']', [0x1C] = '\n', [0x1E] = 'a', [0x1F] = 's',
+	[0x20] = 'd', [0x21] = 'f', [0x22] = 'g', [0x23] = 'h', [0x24] = 'j', [0x25] = 'k',
+	[0x26] = 'l', [0x27] = ';', [0x28] = '\'', [0x29] = '`', [0x2B] = '\\', [0x2C] = 'z',
+	[0x2D] = 'x', [0x2E] = 'c', [0x2F] = 'v', [0x30] = 'b', [0x31] = 'n', [0x32] = 'm',
+	[0x33] = ',', [0x34] = '.', [0x35] = '/', [0x37] = '*', [0x39] = ' ', [0x4A] = '-',
+	[0x4E] = '+',
+};
+
+static const char keymap_shift[128] = {
+	[0x01] = 27, [0x02] = '!', [0x03] = '@', [0x04] = '#', [0x05] = '$', [0x06] = '%',
+	[0x07] = '^', [0x08] = '&', [0x09] = '*', [0x0A] = '(', [0x0B] = ')', [0x0C] = '_',
+	[0x0D] = '+', [0x0E] = '\b', [0x0F] = '\t', [0x10] = 'Q', [0x11] = 'W', [0x12] = 'E',
+	[0x13] = 'R', [0x14] = 'T', [0x15] = 'Y', [0x16] = 'U', [0x17] = 'I', [0x18] = 'O',
+	[0x19] = 'P', [0x1A] = '{', [0x1B] = '}', [0x1C] = '\n', [0x1E] = 'A', [0x1F] = 'S',
+	[0x20] = 'D', [0x21] = 'F', [0x22] = 'G', [0x23] = 'H', [0x24] = 'J', [0x25] = 'K',
+	[0x26] = 'L', [0x27] = ':', [0x28] = '"', [0x29] = '~', [0x2B] = '|', [0x2C] = 'Z',
+	[0x2D] = 'X', [0x2E] = 'C', [0x2F] = 'V', [0x30] = 'B', [0x31] = 'N', [0x32] = 'M',
+	[0x33] = '<', [0x34] = '>', [0x35] = '?', [0x37] = '*', [0x39] = ' ', [0x4A] = '-',
+	[0x4E] = '+',
+};
+
+/* Producer side, interrupt context */
+static void keyboard_ring_push(uint8_t scancode)
+{
+	uint32_t head = ring.head;
+
+	if (head - atomic_load(&ring.tail) == KEYBOARD_RING_SIZE) {
+		ring.dropped++;
+		return;
+	}
+
+	ring.buf[head & (KEYBOARD_RING_SIZE - 1)] = scancode;
+	atomic_store(&ring.head, head + 1);
+}
+
+/* Consumer side */
+static bool keyboard_ring_pop(uint8_t *scancode)
+{
+	uint32_t tail = ring.tail;
+
+	if (tail == atomic_load(&ring.head))
+		return false;
+
+	*scancode = ring.buf[tail & (KEYBOARD_RING_SIZE - 1)];
+	atomic_store(&ring.tail, tail + 1);
+	return true;
+}
+
+static void keyboard_interrupt(struct interrupt_frame *frame, void *ctx)
+{
+	/* Just move the bytes off the controller, decoding happens on the consumer side */
+	for (int i = 0; i < PS2_MAX_BYTES_PER_IRQ; i++) {
+		if (!(insb(PS2_STATUS_PORT) & PS2_STATUS_OUTPUT_FULL))
+			break;
+
+		keyboard_ring_push(insb(PS2_DATA_PORT));
+	}
+
+	if (atomic_load(&keyboard_has_reader)) {
+		wake_up_one(&keyboard_wait);
+	} else {
+		softirq_raise(&keyboard_work);
+	}
+}
+
+static void keyboard_update_modifiers(uint8_t code, bool pressed)
+{
+	uint8_t mod = 0;
+
+	switch (code) {
+	case SCANCODE_LSHIFT:
+	case SCANCODE_RSHIFT:
+		mod = KEY_MOD_SHIFT;
+		break;
+	case SCANCODE_CTRL:
+		mod = KEY_MOD_CTRL;
+		break;
+	case SCANCODE_ALT:
+		mod = KEY_MOD_ALT;
+		break;
+	case SCANCODE_CAPS_LOCK:
+		if (pressed)
+			modifiers ^= KEY_MOD_CAPS_LOCK;
+		return;
+	default:
+		return;
+	}
+
+	if (pressed) {
+		modifiers |= mod;
+	} else {
+		modifiers &= ~mod;
+	}
+}
+
+bool keyboard_pop(struct key_event *event)
+{
+	uint8_t scancode;
+
+	while (keyboard_ring_pop(&scancode)) {
+		if (scancode == SCANCODE_EXTENDED) {
+			extended = true;
+			continue;
+		}
+
+		event->scancode = scancode & ~SCANCODE_RELEASED;
+		event->pressed = !(scancode & SCANCODE_RELEASED);
+		event->extended = extended;
+		extended = false;
+
+		keyboard_update_modifiers(event->scancode, event->pressed);
+		event->modifiers = modifiers;
+
+		event->ascii = 0;
+		if (!event->extended) {
+			bool shift = (modifiers & KEY_MOD_SHIFT) != 0;
+			char c = keymap[event->scancode];
+
+			/* Caps lock only affects letters */
+			if (c >= 'a' && c <= 'z' && (modifiers & KEY_MOD_CAPS_LOCK))
+				shift = !shift;
+
+			event->ascii = shift ? keymap_shift[event->scancode] : c;
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void keyboard_read(struct key_event *event)
+{
+	atomic_store(&keyboard_has_reader, true);
+	wait_event(&keyboard_wait, keyboard_pop(event));
+}
+
+uint32_t keyboard_dropped()
+{
+	return ring.dropped;
+}
+
+/* Until something reads the keyboard, echo what's typed */
+static void keyboard_echo(void *data)
+{
+	struct key_event event;
+
+	if (atomic_load(&keyboard_has_reader))
+		return;
+
+	while (keyboard_pop(&event)) {
+		if (event.pressed && event.ascii && event.ascii != '\b' && event.ascii != 27)
+			terminal_write_char(event.ascii, 15);
+	}
+}
+
+void keyboard_init()
+{
+	/* Throw away anything the controller buffered before we were listening */
+	while (insb(PS2_STATUS_PORT) & PS2_STATUS_OUTPUT_FULL) {
+		insb(PS2_DATA_PORT);
+	}
+
+	softirq_work_init(&keyboard_work, keyboard_echo, 0);
+	wait_queue_init(&keyboard_wait);
+	irq_register(IRQ_VECTOR_BASE + KEYBOARD_IRQ, keyboard_interrupt, 0);
+	irq_unmask(KEYBOARD_IRQ);
+}
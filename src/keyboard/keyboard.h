@@ -0,0 +1,49 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Must be a power of 2, ring indices wrap with a mask */
+#define KEYBOARD_RING_SIZE	256
+
+#define KEY_MOD_SHIFT		0x01
+#define KEY_MOD_CTRL		0x02
+#define KEY_MOD_ALT		0x04
+#define KEY_MOD_CAPS_LOCK	0x08
+
+struct key_event {
+	uint8_t scancode;		// set 1 make code, without the release bit
+	bool extended;			// scancode was prefixed with 0xE0
+	bool pressed;			// false for a key release
+	uint8_t modifiers;		// KEY_MOD_* held when the event happened
+	char ascii;			// 0 if the key has no character
+};
+
+/*
+ * keyboard_init - take over isa irq 1
+ *
+ * prereq - called irq_controller_init() and idt_init()
+ */
+void keyboard_init();
+
+/*
+ * keyboard_pop - take the oldest key event
+ *
+ * Returns false if no key event is waiting.  There must only be one consumer, but it never has
+ * to disable interrupts: the interrupt handler is the ring's only producer
+ */
+bool keyboard_pop(struct key_event *event);
+
+/*
+ * keyboard_read - take the oldest key event, sleeping until there is one
+ *
+ * Until the first call, key presses are echoed to the terminal.  After it they are left for
+ * the reader, the same single consumer keyboard_pop requires
+ */
+void keyboard_read(struct key_event *event);
+
+/* Number of scancodes thrown away because the ring was full */
+uint32_t keyboard_dropped();
+
+#endif /* KEYBOARD_H */
@@ -0,0 +1,40 @@
+/* atomic.h
+ * atomic operations and memory barriers
+ *
+ * Thin wrappers around gcc's __atomic builtins, which compile down to lock prefixed
+ * instructions (or plain movs where x86 ordering already suffices).  They're type generic,
+ * so they work on any naturally aligned integer or pointer up to 64 bits.
+ */
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdbool.h>
+
+#define atomic_load(ptr)		__atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define atomic_store(ptr, val)		__atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define atomic_xchg(ptr, val)		__atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define atomic_fetch_add(ptr, val)	__atomic_fetch_add((ptr), (val), __ATOMIC_SEQ_CST)
+#define atomic_fetch_sub(ptr, val)	__atomic_fetch_sub((ptr), (val), __ATOMIC_SEQ_CST)
+#define atomic_add_return(ptr, val)	__atomic_add_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+#define atomic_sub_return(ptr, val)	__atomic_sub_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+#define atomic_or(ptr, val)		__atomic_fetch_or((ptr), (val), __ATOMIC_SEQ_CST)
+#define atomic_and(ptr, val)		__atomic_fetch_and((ptr), (val), __ATOMIC_SEQ_CST)
+
+/*
+ * atomic_cmpxchg - if *ptr equals *expected, store desired in *ptr and return true.
+ * Otherwise copy the current value of *ptr into *expected and return false
+ */
+#define atomic_cmpxchg(ptr, expected, desired) \
+	__atomic_compare_exchange_n((ptr), (expected), (desired), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+/* Full memory barrier */
+#define smp_mb()			__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* Stop the compiler from caching or reordering memory accesses across this point */
+#define barrier()			__asm__ __volatile__("" ::: "memory")
+
+/* Spin loop hint.  Saves power and avoids a memory order mis-speculation when the loop exits */
+#define cpu_relax()			__asm__ __volatile__("pause" ::: "memory")
+
+#endif /* ATOMIC_H */
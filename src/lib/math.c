@@ -0,0 +1,51 @@
+#include "math.h"
+
+/* Shift and subtract long division.  Only uses 64 bit shifts, compares and subtractions,
+ * all of which gcc can do inline on i686
+ */
+uint32_t div64_32(uint64_t *n, uint32_t base)
+{
+	uint64_t rem = *n;
+	uint64_t b = base;
+	uint64_t res = 0;
+	uint64_t d = 1;
+	uint32_t high = rem >> 32;
+
+	/* Reduce the upper 32 bits first so the loop below has less work to do */
+	if (high >= base) {
+		high /= base;
+		res = (uint64_t)high << 32;
+		rem -= (uint64_t)(high * base) << 32;
+	}
+
+	while ((int64_t)b > 0 && b < rem) {
+		b = b + b;
+		d = d + d;
+	}
+
+	do {
+		if (rem >= b) {
+			rem -= b;
+			res += d;
+		}
+		b >>= 1;
+		d >>= 1;
+	} while (d);
+
+	*n = res;
+	return rem;
+}
+
+uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, unsigned int shift)
+{
+	uint32_t ah = a >> 32;
+	uint32_t al = a;
+	uint64_t ret;
+
+	/* Two 32x32->64 bit multiplies, which the cpu does natively */
+	ret = ((uint64_t)al * mul) >> shift;
+	if (ah)
+		ret += ((uint64_t)ah * mul) << (32 - shift);
+
+	return ret;
+}
@@ -0,0 +1,23 @@
+#ifndef MATH_H
+#define MATH_H
+
+#include <stdint.h>
+
+/*
+ * div64_32 - divide a 64 bit value by a 32 bit value
+ *
+ * We link with -nostdlib so libgcc's __udivdi3 isn't available to us, which means
+ * the compiler can't emit a 64 bit division.  Stores the quotient back into n
+ * and returns the remainder.
+ */
+uint32_t div64_32(uint64_t *n, uint32_t base);
+
+/*
+ * mul_u64_u32_shr - compute (a * mul) >> shift without overflowing 64 bits
+ *
+ * This is the fixed point scaling used to turn tsc cycles into nanoseconds (and back)
+ * with multiplies instead of divisions.  shift must be <= 32
+ */
+uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, unsigned int shift);
+
+#endif /* MATH_H */
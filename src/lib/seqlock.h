@@ -0,0 +1,61 @@
+/* seqlock.h
+ * sequence counters
+ *
+ * For data that is read far more often than it's written, by readers that must never block the
+ * writer, or can't take a lock at all (user mode reading a page the kernel shares with it).
+ * The writer makes the count odd while it updates the data and even again once it's done.  A
+ * reader samples the count, copies the data and checks the count again: if it was odd or moved,
+ * the copy may be torn and it tries again.
+ *
+ * There is no lock for the writers, they must already be serialized.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "atomic.h"
+
+typedef struct {
+	uint32_t sequence;
+} seqcount_t;
+
+static inline void seqcount_init(seqcount_t *s)
+{
+	s->sequence = 0;
+}
+
+/* x86 keeps stores in order, and loads in order, so only the compiler needs holding back */
+static inline void write_seqcount_begin(seqcount_t *s)
+{
+	s->sequence++;
+	barrier();
+}
+
+static inline void write_seqcount_end(seqcount_t *s)
+{
+	barrier();
+	s->sequence++;
+}
+
+/* Wait out a writer in progress and return the count to hand to read_seqcount_retry */
+static inline uint32_t read_seqcount_begin(const seqcount_t *s)
+{
+	uint32_t seq;
+
+	while ((seq = atomic_load(&s->sequence)) & 1) {
+		cpu_relax();
+	}
+
+	return seq;
+}
+
+/* True if a writer got in since read_seqcount_begin returned seq, and the read must be redone */
+static inline bool read_seqcount_retry(const seqcount_t *s, uint32_t seq)
+{
+	barrier();
+	return atomic_load(&s->sequence) != seq;
+}
+
+#endif /* SEQLOCK_H */
@@ -0,0 +1,267 @@
+#include "spinlock.h"
+#include "atomic.h"
+#include "idt/idt.h"
+#include "cpu/cpu.h"
+#include "task/sched.h"
+#include "print/print.h"
+#include "config.h"
+
+static struct lock_class *lock_classes = 0;
+
+static void lock_class_register(struct lock_class *class)
+{
+	struct lock_class *head;
+	bool registered = false;
+
+	if (!class || !atomic_cmpxchg(&class->registered, &registered, true))
+		return;
+
+	head = atomic_load(&lock_classes);
+	do {
+		class->next = head;
+	} while (!atomic_cmpxchg(&lock_classes, &head, class));
+}
+
+/*
+ * Lock stat hooks.  spin_start is 0 if the lock was free on the first try.  Called by the new
+ * holder, which is what makes updating the class without atomics good enough
+ */
+static void lock_stat_acquired(struct lock_class *class, uint64_t *acquired_at, uint64_t spin_start)
+{
+	uint64_t now;
+
+	if (!CONFIG_LOCK_STAT || !class)
+		return;
+
+	now = read_tsc();
+	class->acquires++;
+	if (spin_start) {
+		class->contended++;
+		class->spin_cycles += now - spin_start;
+	}
+	*acquired_at = now;
+}
+
+static void lock_stat_release(struct lock_class *class, uint64_t acquired_at)
+{
+	uint64_t held;
+
+	if (!CONFIG_LOCK_STAT || !class)
+		return;
+
+	held = read_tsc() - acquired_at;
+	if (held > class->max_hold_cycles)
+		class->max_hold_cycles = held;
+}
+
+/* Only read the tsc when we actually have to wait */
+static uint64_t lock_stat_spin_start()
+{
+	return CONFIG_LOCK_STAT ? read_tsc() : 1;
+}
+
+void spin_lock_init(spinlock_t *lock, struct lock_class *class)
+{
+	lock->locked = 0;
+	lock->class = class;
+	lock->acquired_at = 0;
+	lock_class_register(class);
+}
+
+bool spin_trylock(spinlock_t *lock)
+{
+	preempt_disable();
+	if (atomic_xchg(&lock->locked, 1) == 0) {
+		lock_stat_acquired(lock->class, &lock->acquired_at, 0);
+		return true;
+	}
+
+	preempt_enable();
+	return false;
+}
+
+void spin_lock(spinlock_t *lock)
+{
+	uint64_t spin_start = 0;
+
+	preempt_disable();
+	while (atomic_xchg(&lock->locked, 1) != 0) {
+		if (!spin_start)
+			spin_start = lock_stat_spin_start();
+
+		/* Wait with plain loads, so waiters don't keep stealing the cache line from the holder */
+		while (atomic_load(&lock->locked)) {
+			cpu_relax();
+		}
+	}
+	lock_stat_acquired(lock->class, &lock->acquired_at, spin_start);
+}
+
+void spin_unlock(spinlock_t *lock)
+{
+	lock_stat_release(lock->class, lock->acquired_at);
+	atomic_store(&lock->locked, 0);
+	preempt_enable();
+}
+
+uint32_t spin_lock_irqsave(spinlock_t *lock)
+{
+	uint32_t flags = interrupts_save_disable();
+	spin_lock(lock);
+	return flags;
+}
+
+void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags)
+{
+	lock_stat_release(lock->class, lock->acquired_at);
+	atomic_store(&lock->locked, 0);
+	interrupts_restore(flags);
+	preempt_enable();
+}
+
+void ticket_lock_init(ticket_lock_t *lock, struct lock_class *class)
+{
+	lock->owner = 0;
+	lock->next = 0;
+	lock->class = class;
+	lock->acquired_at = 0;
+	lock_class_register(class);
+}
+
+void ticket_lock(ticket_lock_t *lock)
+{
+	uint64_t spin_start = 0;
+	uint16_t ticket;
+
+	preempt_disable();
+	ticket = atomic_fetch_add(&lock->next, 1);
+	if (atomic_load(&lock->owner) != ticket) {
+		spin_start = lock_stat_spin_start();
+		while (atomic_load(&lock->owner) != ticket) {
+			cpu_relax();
+		}
+	}
+	lock_stat_acquired(lock->class, &lock->acquired_at, spin_start);
+}
+
+static void ticket_release(ticket_lock_t *lock)
+{
+	lock_stat_release(lock->class, lock->acquired_at);
+
+	/* Only the holder writes owner, so a plain increment published by a release store is enough */
+	atomic_store(&lock->owner, (uint16_t)(lock->owner + 1));
+}
+
+void ticket_unlock(ticket_lock_t *lock)
+{
+	ticket_release(lock);
+	preempt_enable();
+}
+
+uint32_t ticket_lock_irqsave(ticket_lock_t *lock)
+{
+	uint32_t flags = interrupts_save_disable();
+	ticket_lock(lock);
+	return flags;
+}
+
+void ticket_unlock_irqrestore(ticket_lock_t *lock, uint32_t flags)
+{
+	ticket_release(lock);
+	interrupts_restore(flags);
+	preempt_enable();
+}
+
+void mcs_lock_init(mcs_lock_t *lock, struct lock_class *class)
+{
+	lock->tail = 0;
+	lock->class = class;
+	lock->acquired_at = 0;
+	lock_class_register(class);
+}
+
+void mcs_lock(mcs_lock_t *lock, struct mcs_node *node)
+{
+	struct mcs_node *prev;
+	uint64_t spin_start = 0;
+
+	node->next = 0;
+	node->locked = 0;
+
+	preempt_disable();
+	prev = atomic_xchg(&lock->tail, node);
+	if (prev) {
+		/* Queue up behind prev and spin on our own node until it hands the lock over */
+		spin_start = lock_stat_spin_start();
+		atomic_store(&prev->next, node);
+		while (!atomic_load(&node->locked)) {
+			cpu_relax();
+		}
+	}
+	lock_stat_acquired(lock->class, &lock->acquired_at, spin_start);
+}
+
+static void mcs_release(mcs_lock_t *lock, struct mcs_node *node)
+{
+	struct mcs_node *next = atomic_load(&node->next);
+
+	lock_stat_release(lock->class, lock->acquired_at);
+
+	if (!next) {
+		/* No known successor.  If we're still the tail the lock is simply free */
+		struct mcs_node *expected = node;
+		if (atomic_cmpxchg(&lock->tail, &expected, 0))
+			return;
+
+		/* Someone swapped themselves in as tail but hasn't linked to us yet */
+		while (!(next = atomic_load(&node->next))) {
+			cpu_relax();
+		}
+	}
+
+	atomic_store(&next->locked, 1);
+}
+
+void mcs_unlock(mcs_lock_t *lock, struct mcs_node *node)
+{
+	mcs_release(lock, node);
+	preempt_enable();
+}
+
+uint32_t mcs_lock_irqsave(mcs_lock_t *lock, struct mcs_node *node)
+{
+	uint32_t flags = interrupts_save_disable();
+	mcs_lock(lock, node);
+	return flags;
+}
+
+void mcs_unlock_irqrestore(mcs_lock_t *lock, struct mcs_node *node, uint32_t flags)
+{
+	mcs_release(lock, node);
+	interrupts_restore(flags);
+	preempt_enable();
+}
+
+void lock_stat_print()
+{
+	if (!CONFIG_LOCK_STAT) {
+		print("lock stat: disabled, set CONFIG_LOCK_STAT\n");
+		return;
+	}
+
+	for (struct lock_class *class = atomic_load(&lock_classes); class; class = class->next) {
+		if (!class->acquires)
+			continue;
+
+		print(class->name);
+		print(": acquires ");
+		print_dec(class->acquires);
+		print(" contended ");
+		print_dec(class->contended);
+		print(" spin cycles ");
+		print_dec(class->spin_cycles);
+		print(" max hold cycles ");
+		print_dec(class->max_hold_cycles);
+		print("\n");
+	}
+}
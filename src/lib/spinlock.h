@@ -0,0 +1,88 @@
+/* spinlock.h
+ * busy waiting locks
+ *
+ * Three flavours, all with the same shape of api:
+ *  - spinlock_t: test and test-and-set.  Smallest and fastest uncontended, but unfair, a cpu
+ *    can lose the race for the lock over and over
+ *  - ticket_lock_t: first come first served.  Waiters still all spin on the same cache line
+ *  - mcs_lock_t: queue lock.  First come first served and every waiter spins on its own node,
+ *    so a handover touches one other cpu's cache line.  For heavily contended structures
+ *
+ * Locking disables preemption until the unlock.  The _irqsave variants also disable interrupts,
+ * use them for anything an interrupt handler or softirq can take too.
+ *
+ * Every lock belongs to a struct lock_class.  With CONFIG_LOCK_STAT on, each class counts its
+ * acquires and contended acquires, the cycles spent spinning and the longest hold, see
+ * lock_stat_print.
+ */
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct lock_class {
+	const char *name;
+	struct lock_class *next;	// on the list lock_stat_print walks
+	bool registered;
+	uint32_t acquires;
+	uint32_t contended;		// acquires that had to wait
+	uint64_t spin_cycles;
+	uint64_t max_hold_cycles;
+};
+
+/* Define a lock class.  Statistics are only updated by the holder of a lock, so counts of a
+ * class shared by several locks are approximate
+ */
+#define LOCK_CLASS(var, class_name)	static struct lock_class var = { .name = class_name }
+
+typedef struct {
+	uint32_t locked;
+	struct lock_class *class;
+	uint64_t acquired_at;		// tsc, for the hold time with CONFIG_LOCK_STAT
+} spinlock_t;
+
+typedef struct {
+	uint16_t owner;			// ticket being served
+	uint16_t next;			// next ticket to hand out
+	struct lock_class *class;
+	uint64_t acquired_at;
+} ticket_lock_t;
+
+/* A waiter's place in an MCS queue.  Lives on the waiter's stack for as long as it holds the lock */
+struct mcs_node {
+	struct mcs_node *next;
+	uint32_t locked;		// set by our predecessor when it hands the lock over
+};
+
+typedef struct {
+	struct mcs_node *tail;		// last waiter, 0 when the lock is free
+	struct lock_class *class;
+	uint64_t acquired_at;
+} mcs_lock_t;
+
+void spin_lock_init(spinlock_t *lock, struct lock_class *class);
+void spin_lock(spinlock_t *lock);
+bool spin_trylock(spinlock_t *lock);
+void spin_unlock(spinlock_t *lock);
+uint32_t spin_lock_irqsave(spinlock_t *lock);
+void spin_unlock_irqrestore(spinlock_t *lock, uint32_t flags);
+
+void ticket_lock_init(ticket_lock_t *lock, struct lock_class *class);
+void ticket_lock(ticket_lock_t *lock);
+void ticket_unlock(ticket_lock_t *lock);
+uint32_t ticket_lock_irqsave(ticket_lock_t *lock);
+void ticket_unlock_irqrestore(ticket_lock_t *lock, uint32_t flags);
+
+/* node must stay valid, and be passed to the unlock, until the lock is released */
+void mcs_lock_init(mcs_lock_t *lock, struct lock_class *class);
+void mcs_lock(mcs_lock_t *lock, struct mcs_node *node);
+void mcs_unlock(mcs_lock_t *lock, struct mcs_node *node);
+uint32_t mcs_lock_irqsave(mcs_lock_t *lock, struct mcs_node *node);
+void mcs_unlock_irqrestore(mcs_lock_t *lock, struct mcs_node *node, uint32_t flags);
+
+/* Print the statistics of every lock class that has been taken.  Needs CONFIG_LOCK_STAT */
+void lock_stat_print();
+
+#endif /* SPINLOCK_H */
@@ -0,0 +1,111 @@
+#include "elf.h"
+#include "task/process.h"
+#include "memory/vm/vm.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "disk/disk.h"
+#include "config.h"
+#include "status.h"
+
+#define ELF_HEADER_SECTORS	(PAGING_PAGE_SIZE / DISK_SECTOR_SIZE)	// headers must fit in the first page
+
+static int elf_check_header(struct elf_header *header)
+{
+	if (header->magic != ELF_MAGIC || header->class != ELF_CLASS_32 || header->data != ELF_DATA_LSB ||
+	    header->type != ELF_TYPE_EXEC || header->machine != ELF_MACHINE_386)
+		return -EINVARG;
+
+	if (header->phentsize != sizeof(struct elf_program_header) || header->phoff > PAGING_PAGE_SIZE ||
+	    header->phoff + header->phnum * sizeof(struct elf_program_header) > PAGING_PAGE_SIZE)
+		return -EINVARG;
+
+	return 0;
+}
+
+/*
+ * Turn a PT_LOAD segment into a vm area.  The file data and the addresses have the same offset
+ * within a page (the linker makes sure of that), so page n of the area comes from the page of
+ * the file at the segment's offset rounded down, plus n
+ */
+static int elf_map_segment(struct process *process, struct elf_program_header *ph, uint32_t lba)
+{
+	uint32_t page_offset = ph->vaddr & (PAGING_PAGE_SIZE - 1);
+	uint32_t start = ph->vaddr - page_offset;
+	uint32_t end = (ph->vaddr + ph->memsz + PAGING_PAGE_SIZE - 1) & ~(PAGING_PAGE_SIZE - 1);
+	uint32_t flags = VM_FILE;
+
+	if (ph->filesz > ph->memsz || (ph->offset & (PAGING_PAGE_SIZE - 1)) != page_offset ||
+	    ph->vaddr + ph->memsz < ph->vaddr)
+		return -EINVARG;
+
+	if (ph->flags & ELF_PF_W)
+		flags |= VM_WRITE;
+
+	return vm_area_add(process, start, end, flags, lba + (ph->offset - page_offset) / DISK_SECTOR_SIZE,
+			   ph->vaddr + ph->filesz);
+}
+
+/* The entry point has to be in an executable segment, mapping them checked that they are in user space */
+static bool elf_entry_ok(struct elf_header *header, struct elf_program_header *ph)
+{
+	for (int i = 0; i < header->phnum; i++) {
+		if (ph[i].type == ELF_PT_LOAD && (ph[i].flags & ELF_PF_X) &&
+		    header->entry >= ph[i].vaddr && header->entry - ph[i].vaddr < ph[i].memsz)
+			return true;
+	}
+
+	return false;
+}
+
+/* Build a process from the headers in buf, the first page of the file at lba */
+static int elf_load(const char *name, uint8_t *buf, uint32_t lba, int priority)
+{
+	struct elf_header *header = (struct elf_header *)buf;
+	struct elf_program_header *ph = (struct elf_program_header *)(buf + header->phoff);
+	struct process *process;
+	int res;
+
+	res = elf_check_header(header);
+	if (res < 0)
+		return res;
+	if (!elf_entry_ok(header, ph))
+		return -EINVARG;
+
+	process = process_alloc(name);
+	if (!process)
+		return -ENOMEM;
+
+	for (int i = 0; i < header->phnum && res == 0; i++) {
+		if (ph[i].type == ELF_PT_LOAD && ph[i].memsz)
+			res = elf_map_segment(process, &ph[i], lba);
+	}
+
+	/* The stack is demand paged too, as zero pages */
+	if (res == 0)
+		res = vm_area_add(process, PROCESS_USER_END - PROCESS_STACK_SIZE, PROCESS_USER_END, VM_WRITE, 0, 0);
+
+	if (res < 0) {
+		process_free(process);
+		return res;
+	}
+
+	process->entry = header->entry;
+	process->user_stack = PROCESS_USER_END;
+	return process_launch(process, priority);
+}
+
+int elf_exec(const char *name, uint32_t lba, int priority)
+{
+	uint8_t *buf = kmalloc(PAGING_PAGE_SIZE);
+	int res;
+
+	if (!buf)
+		return -ENOMEM;
+
+	res = disk_read_block(disk_get(0), lba, ELF_HEADER_SECTORS, buf);
+	if (res == 0)
+		res = elf_load(name, buf, lba, priority);
+
+	kfree(buf);
+	return res;
+}
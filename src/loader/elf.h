@@ -0,0 +1,73 @@
+/* elf.h
+ * loading ELF32 executables
+ *
+ * Refer to the System V ABI and its Intel386 supplement.  Only static, non relocatable
+ * executables (ET_EXEC) linked to run inside [PROCESS_USER_START, PROCESS_USER_END) are supported.
+ *
+ * There is no filesystem yet, so an executable is a run of sectors on the disk, starting at the
+ * ELF header.
+ */
+
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdint.h>
+
+#define ELF_MAGIC		0x464C457F	// "\x7fELF", little endian
+#define ELF_CLASS_32		1
+#define ELF_DATA_LSB		1
+#define ELF_TYPE_EXEC		2
+#define ELF_MACHINE_386		3
+
+#define ELF_PT_LOAD		1
+
+#define ELF_PF_X		0x1
+#define ELF_PF_W		0x2
+#define ELF_PF_R		0x4
+
+struct elf_header {
+	uint32_t magic;
+	uint8_t class;
+	uint8_t data;
+	uint8_t ident_version;
+	uint8_t ident_pad[9];
+	uint16_t type;
+	uint16_t machine;
+	uint32_t version;
+	uint32_t entry;
+	uint32_t phoff;			// file offset of the program headers
+	uint32_t shoff;
+	uint32_t flags;
+	uint16_t ehsize;
+	uint16_t phentsize;
+	uint16_t phnum;
+	uint16_t shentsize;
+	uint16_t shnum;
+	uint16_t shstrndx;
+} __attribute__((packed));
+
+struct elf_program_header {
+	uint32_t type;
+	uint32_t offset;		// file offset of the segment's first byte
+	uint32_t vaddr;
+	uint32_t paddr;
+	uint32_t filesz;
+	uint32_t memsz;			// bytes past filesz are zero (bss)
+	uint32_t flags;			// ELF_PF_*
+	uint32_t align;
+} __attribute__((packed));
+
+/*
+ * elf_exec - start a process running the ELF executable at sector lba
+ *
+ * Only the headers are read here.  The PT_LOAD segments and a PROCESS_STACK_SIZE stack are set up
+ * as demand paged vm areas, so pages are read from the disk when the process first touches them
+ * and start up costs the same however big the file is.  Read only segments are shared with other
+ * processes running the same file through the page cache.
+ *
+ * Returns the process id, -EIO if the headers can't be read, -EINVARG if they aren't a supported
+ * executable and -ENOMEM if out of memory.  Sleeps on the disk
+ */
+int elf_exec(const char *name, uint32_t lba, int priority);
+
+#endif /* ELF_H */
@@ -201,4 +201,17 @@ int heap_free(struct heap_desc *heap, void *ptr)
 {
 	heap_mark_blocks_free(heap, heap_address_to_block(heap, ptr));
 	return 0;
-}
\ No newline at end of file
+}
+
+bool heap_is_single_block(struct heap_desc *heap, void *ptr)
+{
+	hbte_t entry;
+
+	if (ptr < heap->start_addr || !heap_valid_alignment(ptr))
+		return false;
+	if (heap_address_to_block(heap, ptr) >= (int)heap->table->total_entries)
+		return false;
+
+	entry = heap->table->entries[heap_address_to_block(heap, ptr)];
+	return (entry & HEAP_BLOCK_IS_FIRST) && !(entry & HEAP_BLOCK_HAS_NEXT);
+}
@@ -8,6 +8,7 @@
 #include "config.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #define HEAP_BLOCK_TABLE_ENTRY_FREE 	0x00
 #define HEAP_BLOCK_TABLE_ENTRY_TAKEN 	0x01
@@ -44,4 +45,7 @@ void* heap_malloc(struct heap_desc *heap, size_t size);
 
 int heap_free(struct heap_desc *heap, void *ptr);
 
+/* Returns true if ptr is the start of an allocation that is exactly one block long */
+bool heap_is_single_block(struct heap_desc *heap, void *ptr);
+
 #endif
@@ -3,10 +3,19 @@
 #include "config.h"
 #include "print/print.h"
 #include "memory/memory.h"
+#include "idt/idt.h"
+#include "smp/percpu.h"
+#include "lib/spinlock.h"
 
 struct heap_desc kernel_heap;			
 struct heap_entry_table kernel_heap_table;
 
+/* heap_malloc/heap_free walk and rewrite the shared block table.  Every cpu's cache misses end up
+ * here, so it's a queue lock to keep the handover fair and off the other waiters' cache lines
+ */
+static mcs_lock_t kernel_heap_lock;
+LOCK_CLASS(kernel_heap_lock_class, "kernel heap");
+
 void kernel_heap_init()
 {
 	/* Initialize kernel heap table 
@@ -21,6 +30,7 @@ void kernel_heap_init()
 	kernel_heap_table.total_entries = KERNEL_HEAP_SIZE / HEAP_BLOCK_SIZE;
 	
 	end_addr = (void*)KERNEL_HEAP_ADDRESS + KERNEL_HEAP_SIZE;
+	mcs_lock_init(&kernel_heap_lock, &kernel_heap_lock_class);
 	
 	rc = heap_create(&kernel_heap, (void*)KERNEL_HEAP_ADDRESS, end_addr, &kernel_heap_table);
 	if (rc < 0) {
@@ -29,14 +39,67 @@ void kernel_heap_init()
 	
 }
 
+/* Blocks in the cache stay marked taken in the block table, so they are only ever seen by this cpu */
+static void* heap_cache_pop()
+{
+	uint32_t flags = interrupts_save_disable();
+	struct heap_cache *cache = &this_cpu()->heap_cache;
+	void *ptr = 0;
+
+	if (cache->count)
+		ptr = cache->blocks[--cache->count];
+
+	interrupts_restore(flags);
+	return ptr;
+}
+
+static bool heap_cache_push(void *ptr)
+{
+	uint32_t flags = interrupts_save_disable();
+	struct heap_cache *cache = &this_cpu()->heap_cache;
+	bool cached = false;
+
+	if (cache->count < HEAP_CACHE_BLOCKS) {
+		cache->blocks[cache->count++] = ptr;
+		cached = true;
+	}
+
+	interrupts_restore(flags);
+	return cached;
+}
+
 void* kmalloc(size_t size)
 {
-	return heap_malloc(&kernel_heap, size);
+	void *ptr;
+
+	if (size && size <= HEAP_BLOCK_SIZE) {
+		ptr = heap_cache_pop();
+		if (ptr)
+			return ptr;
+	}
+
+	struct mcs_node node;
+	uint32_t flags = mcs_lock_irqsave(&kernel_heap_lock, &node);
+	ptr = heap_malloc(&kernel_heap, size);
+	mcs_unlock_irqrestore(&kernel_heap_lock, &node, flags);
+
+	return ptr;
 }
 
 int kfree(void *ptr)
 {
-	return heap_free(&kernel_heap, ptr);
+	if (heap_is_single_block(&kernel_heap, ptr) && heap_cache_push(ptr))
+		return 0;
+
+	struct mcs_node node;
+	uint32_t flags;
+	int rc;
+
+	flags = mcs_lock_irqsave(&kernel_heap_lock, &node);
+	rc = heap_free(&kernel_heap, ptr);
+	mcs_unlock_irqrestore(&kernel_heap_lock, &node, flags);
+
+	return rc;
 }
 
 void* kzalloc(size_t size)
@@ -7,6 +7,16 @@
 #define KERNEL_HEAP_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+/* Per cpu stack of free single block allocations.  Most allocations are a block or less, and
+ * popping one here skips the scan of the block table
+ */
+struct heap_cache {
+	uint32_t count;
+	void *blocks[HEAP_CACHE_BLOCKS];
+};
 
 /* Initialize the kernel heap */
 void kernel_heap_init();
@@ -9,3 +9,13 @@ void *memset(void *s, int c, size_t n)
 	return s;
 }
 
+
+void *memcpy(void *dest, const void *src, size_t n)
+{
+	char *d = (char *)dest;
+	const char *s = (const char *)src;
+	for (size_t i = 0; i < n; i++) {
+		d[i] = s[i];
+	}
+	return dest;
+}
@@ -11,5 +11,12 @@
  */
 void *memset(void *s, int c, size_t n);
 
+/*
+ * memcpy - copy n bytes from src to dest
+ *
+ * the areas must not overlap
+ */
+void *memcpy(void *dest, const void *src, size_t n);
+
 #endif /* MEMORY_H */
 
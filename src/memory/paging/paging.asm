@@ -4,6 +4,7 @@ section .asm
 
 global paging_load_pgd
 global enable_paging
+global paging_invalidate
 
 paging_load_pgd:
         push ebp                        ; save the caller's base pointer
@@ -24,4 +25,14 @@ enable_paging:
         mov cr0, eax
 
         pop ebp			        ; set ebp to caller's frame pointer value
-	ret			        ; return control to caller
\ No newline at end of file
+	ret			        ; return control to caller
+
+paging_invalidate:
+        push ebp                        ; save the caller's base pointer
+        mov ebp, esp
+
+        mov eax, [ebp+8]                ; virtual address whose translation we want dropped from the tlb
+        invlpg [eax]
+
+        pop ebp			        ; set ebp to caller's frame pointer value
+	ret			        ; return control to caller
@@ -1,6 +1,10 @@
 #include "memory/paging/paging.h"
 #include "memory/heap/kernel_heap.h"
 #include "status.h"
+#include "config.h"
+#include "task/task_pool.h"
+#include "memory/vm/page_cache.h"
+#include "memory/vm/frame_ref.h"
 
 // instead of paging_new_4gb it seems much cleaner to just have an initialize paging function 
 // paging_4gb_chunk seems like a weird way of doing it
@@ -13,32 +17,240 @@ static uint32_t* current_pgd = 0;
 
 void paging_load_pgd(uint32_t* pgd);
 
-struct paging_desc* init_page_tables(uint8_t flags)
+struct paging_fill {
+        uint32_t *pgd;
+        uint8_t flags;
+};
+
+#define PAGING_FILL_GRAIN       32                      // page tables per task, 128 KB of entries
+
+/* Allocate and fill the page tables behind pgd entries [start, end).  Runs on any cpu */
+static void paging_fill_tables(uint32_t start, uint32_t end, void *arg)
 {
-        /* allocate the page global directory */
-        uint32_t* pgd = kzalloc(sizeof(uint32_t) * PAGING_DIR_ENTRIES);
+        struct paging_fill *fill = arg;
 
-        int offset = 0;
-        for (int i = 0; i < PAGING_DIR_ENTRIES; i++) {
+        for (uint32_t i = start; i < end; i++) {
 
-                /* allocate a page table*/
-                uint32_t* pte = kzalloc(sizeof(uint32_t) * PAGING_TABLE_ENTRIES);
+                /* allocate a page table.  Every entry gets written below, so no need to zero it */
+                uint32_t* pte = kmalloc(sizeof(uint32_t) * PAGING_TABLE_ENTRIES);
+                if (!pte)
+                        continue;                       // leaves the directory entry not present
 
                 /* Fill each entry in the page table with an address to somewhere in our 4 gb space */
+                uint32_t offset = i * PAGING_TABLE_ENTRIES * PAGING_PAGE_SIZE;
                 for (int b = 0; b < PAGING_TABLE_ENTRIES; b++) {
-                        pte[b] = (offset + (b * PAGING_PAGE_SIZE)) | flags;
+                        pte[b] = (offset + (b * PAGING_PAGE_SIZE)) | fill->flags;
                 }
-                offset += PAGING_TABLE_ENTRIES * PAGING_PAGE_SIZE;
 
                 /* Fill in the pgd entry corresponding with the page table */
-                pgd[i] = (uint32_t)pte | flags | PAGING_READ_WRITE;
+                fill->pgd[i] = (uint32_t)pte | fill->flags | PAGING_READ_WRITE;
         }
+}
+
+struct paging_desc* init_page_tables(uint8_t flags)
+{
+        /* allocate the page global directory */
+        uint32_t* pgd = kzalloc(sizeof(uint32_t) * PAGING_DIR_ENTRIES);
+        struct paging_fill fill = { .pgd = pgd, .flags = flags };
+
+        /* The 1024 page tables are independent, so split them across every online cpu */
+        parallel_for(0, PAGING_DIR_ENTRIES, PAGING_FILL_GRAIN, paging_fill_tables, &fill);
 
         struct paging_desc* paging = kzalloc(sizeof(struct paging_desc));
         paging->pgd = pgd;
         return paging;
 }
 
+void paging_free(struct paging_desc* paging)
+{
+        uint32_t* pgd = paging->pgd;
+
+        for (int i = 0; i < PAGING_DIR_ENTRIES; i++) {
+                if (pgd[i] & PAGING_PRESENT)
+                        kfree((void*)(pgd[i] & PGD_ENTRY_TABLE_ADDR));
+        }
+
+        kfree(pgd);
+        kfree(paging);
+}
+
+struct paging_desc* paging_new_process(struct paging_desc* kernel)
+{
+        struct paging_desc* paging = kzalloc(sizeof(struct paging_desc));
+        if (!paging)
+                return 0;
+
+        paging->pgd = kzalloc(sizeof(uint32_t) * PAGING_DIR_ENTRIES);
+        if (!paging->pgd) {
+                kfree(paging);
+                return 0;
+        }
+
+        /* Share the kernel's page tables, except in the user range, which starts out empty */
+        for (int i = 0; i < PAGING_DIR_ENTRIES; i++) {
+                uint32_t addr = i * PAGING_TABLE_ENTRIES * PAGING_PAGE_SIZE;
+                if (addr < PROCESS_USER_START || addr >= PROCESS_USER_END)
+                        paging->pgd[i] = kernel->pgd[i];
+        }
+
+        return paging;
+}
+
+static bool paging_is_user(uint32_t addr)
+{
+        return addr >= PROCESS_USER_START && addr < PROCESS_USER_END;
+}
+
+/* The page table entry mapping virtual_address, a user address.  If its page table doesn't
+ * exist yet it is allocated when alloc is set, otherwise the result is 0
+ */
+static uint32_t* paging_user_entry(struct paging_desc* paging, void *virtual_address, bool alloc)
+{
+        uint32_t pgd_index = 0;
+        uint32_t table_index = 0;
+        uint32_t *table;
+
+        if (paging_get_indexes(virtual_address, &pgd_index, &table_index) < 0)
+                return 0;
+
+        /* The directory entry is as permissive as anything under it can be, the page table
+         * entries say what each page actually allows
+         */
+        if (!(paging->pgd[pgd_index] & PAGING_PRESENT)) {
+                if (!alloc)
+                        return 0;
+
+                table = kzalloc(sizeof(uint32_t) * PAGING_TABLE_ENTRIES);
+                if (!table)
+                        return 0;
+                paging->pgd[pgd_index] = (uint32_t)table | PAGING_PRESENT | PAGING_READ_WRITE | PAGING_USER_SUPERVISOR;
+        }
+
+        table = (uint32_t*)(paging->pgd[pgd_index] & PGD_ENTRY_TABLE_ADDR);
+        return &table[table_index];
+}
+
+/* Let go of the frame a user page table entry maps, however it is owned */
+static void paging_put_frame(uint32_t entry)
+{
+        void *frame = (void*)(entry & PTE_PAGE_FRAME_ADDR);
+
+        if (entry & PAGING_PAGE_CACHE) {
+                page_cache_put(frame);
+        } else if (!(entry & PAGING_SHARED)) {
+                frame_put(frame);
+        }
+}
+
+int paging_map_user(struct paging_desc* paging, void *virtual_address, void *frame, uint32_t flags)
+{
+        uint32_t *entry;
+
+        if (!paging_is_user((uint32_t)virtual_address) || !paging_is_aligned(virtual_address) || !paging_is_aligned(frame))
+                return -EINVARG;
+
+        entry = paging_user_entry(paging, virtual_address, true);
+        if (!entry)
+                return -ENOMEM;
+
+        *entry = (uint32_t)frame | flags | PAGING_PRESENT | PAGING_USER_SUPERVISOR;
+        return 0;
+}
+
+int paging_alloc_user_tables(struct paging_desc* paging, void *virtual_address, uint32_t size)
+{
+        uint32_t start = (uint32_t)virtual_address;
+
+        if (!paging_is_user(start) || !paging_is_aligned(virtual_address) || size > PROCESS_USER_END - start)
+                return -EINVARG;
+
+        /* One entry per page table is enough to make it exist */
+        for (uint32_t addr = start; addr - start < size; addr += PAGING_PAGE_SIZE) {
+                if (!paging_user_entry(paging, (void*)addr, true))
+                        return -ENOMEM;
+        }
+
+        return 0;
+}
+
+uint32_t paging_get_user(struct paging_desc* paging, void *virtual_address)
+{
+        uint32_t *entry;
+
+        if (!paging_is_user((uint32_t)virtual_address))
+                return 0;
+
+        entry = paging_user_entry(paging, virtual_address, false);
+        return entry ? *entry : 0;
+}
+
+uint32_t paging_take_user(struct paging_desc* paging, void *virtual_address)
+{
+        uint32_t *entry;
+        uint32_t val;
+
+        if (!paging_is_user((uint32_t)virtual_address))
+                return 0;
+
+        entry = paging_user_entry(paging, virtual_address, false);
+        if (!entry || !(*entry & PAGING_PRESENT))
+                return 0;
+
+        val = *entry;
+        *entry = 0;
+        if (current_pgd == paging->pgd)
+                paging_invalidate(virtual_address);
+
+        return val;
+}
+
+uint32_t paging_update_user(struct paging_desc* paging, void *virtual_address, uint32_t clear, uint32_t set)
+{
+        uint32_t *entry;
+
+        if (!paging_is_user((uint32_t)virtual_address))
+                return 0;
+
+        entry = paging_user_entry(paging, virtual_address, false);
+        if (!entry || !(*entry & PAGING_PRESENT))
+                return 0;
+
+        *entry = (*entry & ~clear) | set;
+        if (current_pgd == paging->pgd)
+                paging_invalidate(virtual_address);
+
+        return *entry;
+}
+
+void paging_unmap_user(struct paging_desc* paging, void *virtual_address)
+{
+        uint32_t val = paging_take_user(paging, virtual_address);
+
+        if (val)
+                paging_put_frame(val);
+}
+
+void paging_free_process(struct paging_desc* paging)
+{
+        uint32_t first = PROCESS_USER_START / (PAGING_TABLE_ENTRIES * PAGING_PAGE_SIZE);
+        uint32_t last = PROCESS_USER_END / (PAGING_TABLE_ENTRIES * PAGING_PAGE_SIZE);
+
+        for (uint32_t i = first; i < last; i++) {
+                if (!(paging->pgd[i] & PAGING_PRESENT))
+                        continue;
+
+                uint32_t *table = (uint32_t*)(paging->pgd[i] & PGD_ENTRY_TABLE_ADDR);
+                for (int b = 0; b < PAGING_TABLE_ENTRIES; b++) {
+                        if (table[b] & PAGING_PRESENT)
+                                paging_put_frame(table[b]);
+                }
+                kfree(table);
+        }
+
+        kfree(paging->pgd);
+        kfree(paging);
+}
+
 uint32_t* get_pgd(struct paging_desc* paging)
 {
         return paging->pgd;
@@ -50,6 +262,11 @@ void paging_switch(uint32_t* pgd)
         current_pgd = pgd;
 }
 
+uint32_t* paging_current_pgd()
+{
+        return current_pgd;
+}
+
 bool paging_is_aligned(void *addr)
 {
         return (uint32_t)addr % PAGING_PAGE_SIZE == 0;
@@ -11,6 +11,9 @@
 #define PAGING_USER_SUPERVISOR  0b00000100
 #define PAGING_READ_WRITE       0b00000010
 #define PAGING_PRESENT          0b00000001
+#define PAGING_PAGE_CACHE       0x200                   // available to software: the frame belongs to the page cache
+#define PAGING_SHARED           0x400                   // available to software: the frame belongs to a kernel object, unmapping leaves it alone
+#define PAGING_COW              0x800                   // available to software: writable, but mapped read only until a write fault copies the frame
 #define PGD_ENTRY_TABLE_ADDR    0xfffff000              
 #define PTE_PAGE_FRAME_ADDR     0xfffff000
 
@@ -31,15 +34,84 @@ struct paging_desc {
 /* Initializes a page global directory and the corresponding page tables.
  * The page tables are initialized so that there is a linear, 1:1 correlation between
  * virtual addresses and physical addresses.
+ * Once the application processors are up the page tables are built in parallel on all of them.
  */
 struct paging_desc* init_page_tables(uint8_t flags);
 
+/* Free a paging descriptor from init_page_tables along with its directory and page tables.
+ * It must not be loaded on any cpu
+ */
+void paging_free(struct paging_desc* paging);
+
+/*
+ * paging_new_process - page directory for a user process
+ *
+ * Maps everything the kernel's does, through the kernel's own page tables, except
+ * [PROCESS_USER_START, PROCESS_USER_END), which is left empty for paging_map_user.  The kernel
+ * mappings don't have PAGING_USER_SUPERVISOR set, so ring 3 can't touch them.  Returns 0 if out
+ * of memory
+ */
+struct paging_desc* paging_new_process(struct paging_desc* kernel);
+
+/*
+ * paging_map_user - map the page at virtual_address, inside the user range, to frame
+ *
+ * frame is a page aligned kernel heap block, whose reference (frame_ref.h) paging_free_process
+ * drops along with the mapping, a page cache frame (flags has PAGING_PAGE_CACHE), whose reference it drops, or memory
+ * some kernel object owns and frees itself (PAGING_SHARED).  Add
+ * PAGING_READ_WRITE to flags for a writable page, or PAGING_COW for one that is writable once
+ * the fault handler has copied it.  It is always present and user accessible.
+ * Returns -EINVARG for an address outside the user range and -ENOMEM if a page table can't be
+ * allocated
+ */
+int paging_map_user(struct paging_desc* paging, void *virtual_address, void *frame, uint32_t flags);
+
+/* Make sure the page tables covering [virtual_address, virtual_address + size) in the user range
+ * exist, so paging_map_user can't run out of memory there.  Returns -EINVARG or -ENOMEM
+ */
+int paging_alloc_user_tables(struct paging_desc* paging, void *virtual_address, uint32_t size);
+
+/* The page table entry of the user page at virtual_address, 0 if it has none */
+uint32_t paging_get_user(struct paging_desc* paging, void *virtual_address);
+
+/*
+ * paging_take_user - unmap the user page at virtual_address without letting go of its frame
+ *
+ * Returns the entry it had, and with it whatever ownership of the frame its flags stand for, so
+ * the caller can map it somewhere else with paging_map_user.  Returns 0 if nothing was mapped
+ */
+uint32_t paging_take_user(struct paging_desc* paging, void *virtual_address);
+
+/* Clear the bits clear and set the bits set in the entry of the mapped user page at virtual_address.
+ * Returns the new entry, or 0 if nothing was mapped
+ */
+uint32_t paging_update_user(struct paging_desc* paging, void *virtual_address, uint32_t clear, uint32_t set);
+
+/* Unmap the user page at virtual_address, freeing or releasing its frame the way
+ * paging_free_process would.  Does nothing if it isn't mapped
+ */
+void paging_unmap_user(struct paging_desc* paging, void *virtual_address);
+
+/* Free a paging_new_process directory, its user page tables and every frame mapped in them.
+ * Page cache and copy on write frames are only released, other processes may still map them, and PAGING_SHARED
+ * frames are left to their owner.  It must not be loaded on any cpu
+ */
+void paging_free_process(struct paging_desc* paging);
+
 /* Returns the page global directory associated with the paging descriptor */
 uint32_t* get_pgd(struct paging_desc* paging);
 
 /* Load the cr3 register with the address of the page global directory to use */
 void paging_switch(uint32_t* pgd);
 
+/* Returns the page global directory that was last loaded with paging_switch */
+uint32_t* paging_current_pgd();
+
+/* Drop any cached translation for the page containing virtual_address from the TLB.
+ * Needed after changing a live page table entry
+ */
+void paging_invalidate(void *virtual_address);
+
 /* Set the paging bit in the cr0 register 
  * 
  * Prereqs: called init_paging and paging_switch
@@ -0,0 +1,62 @@
+#include "frame_ref.h"
+#include "lib/spinlock.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "kernel.h"
+#include "config.h"
+
+#define FRAME_REF_COUNT		(KERNEL_HEAP_SIZE / HEAP_BLOCK_SIZE)
+
+static uint16_t *extra_refs = 0;		// per heap block, references beyond the first
+static spinlock_t frame_ref_lock;
+LOCK_CLASS(frame_ref_lock_class, "frame refs");
+
+static uint32_t frame_index(void *frame)
+{
+	uint32_t addr = (uint32_t)frame;
+
+	if (addr < KERNEL_HEAP_ADDRESS || addr - KERNEL_HEAP_ADDRESS >= KERNEL_HEAP_SIZE || !paging_is_aligned(frame))
+		panic("frame_ref: not a heap frame");
+
+	return (addr - KERNEL_HEAP_ADDRESS) / HEAP_BLOCK_SIZE;
+}
+
+void frame_get(void *frame)
+{
+	uint32_t i = frame_index(frame);
+
+	spin_lock(&frame_ref_lock);
+	if (extra_refs[i] == 0xFFFF)
+		panic("frame_ref: too many references");
+	extra_refs[i]++;
+	spin_unlock(&frame_ref_lock);
+}
+
+void frame_put(void *frame)
+{
+	uint32_t i = frame_index(frame);
+	bool last;
+
+	spin_lock(&frame_ref_lock);
+	last = extra_refs[i] == 0;
+	if (!last)
+		extra_refs[i]--;
+	spin_unlock(&frame_ref_lock);
+
+	if (last)
+		kfree(frame);
+}
+
+bool frame_shared(void *frame)
+{
+	return extra_refs[frame_index(frame)] != 0;
+}
+
+void frame_ref_init()
+{
+	extra_refs = kzalloc(FRAME_REF_COUNT * sizeof(uint16_t));
+	if (!extra_refs)
+		panic("frame_ref: out of memory");
+
+	spin_lock_init(&frame_ref_lock, &frame_ref_lock_class);
+}
@@ -0,0 +1,30 @@
+/* frame_ref.h
+ * reference counts for frames mapped into more than one address space
+ *
+ * A process's private pages are kernel heap blocks that normally have exactly one owner, the
+ * page table entry that maps them.  Copy on write sharing (pipes, see pipe.h) gives a frame
+ * more owners: every page table entry or kernel object holding it has a reference, and the last
+ * one to let go frees it.  Only the references beyond the first are counted, so a frame fresh
+ * out of kmalloc needs no setup.
+ *
+ * Page cache frames (page_cache.h) and PAGING_SHARED frames are counted by their owners instead.
+ */
+
+#ifndef FRAME_REF_H
+#define FRAME_REF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Take another reference on frame, a page sized kernel heap block */
+void frame_get(void *frame);
+
+/* Drop a reference on frame, freeing it with the last one */
+void frame_put(void *frame);
+
+/* True if frame has more than one reference, so it must not be written in place */
+bool frame_shared(void *frame);
+
+void frame_ref_init();
+
+#endif /* FRAME_REF_H */
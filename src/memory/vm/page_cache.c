@@ -0,0 +1,162 @@
+#include "page_cache.h"
+#include "disk/disk.h"
+#include "lib/list.h"
+#include "lib/spinlock.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+
+#define PAGE_CACHE_MASK		(PAGE_CACHE_BUCKETS - 1)
+#define SECTORS_PER_PAGE	(PAGING_PAGE_SIZE / DISK_SECTOR_SIZE)
+
+struct page_cache_entry {
+	uint32_t lba;
+	void *frame;
+	uint32_t refcount;
+	struct list_head lba_entry;		// in by_lba, for lookups on a fault.  Unlinked once invalidated
+	struct list_head frame_entry;		// in by_frame, for page_cache_put
+};
+
+static struct list_head by_lba[PAGE_CACHE_BUCKETS];
+static struct list_head by_frame[PAGE_CACHE_BUCKETS];
+static spinlock_t page_cache_lock;		// taken with irqsave, disk_submit can invalidate from an irq
+static uint32_t page_cache_generation;		// bumped by every invalidation
+LOCK_CLASS(page_cache_lock_class, "page cache");
+
+static uint32_t frame_hash(void *frame)
+{
+	return ((uint32_t)frame / PAGING_PAGE_SIZE) & PAGE_CACHE_MASK;
+}
+
+static uint32_t lba_hash(uint32_t lba)
+{
+	return (lba / SECTORS_PER_PAGE) & PAGE_CACHE_MASK;
+}
+
+void page_cache_init()
+{
+	for (int i = 0; i < PAGE_CACHE_BUCKETS; i++) {
+		list_init(&by_lba[i]);
+		list_init(&by_frame[i]);
+	}
+	spin_lock_init(&page_cache_lock, &page_cache_lock_class);
+}
+
+/* Take a reference on the cached page at lba.  page_cache_lock is held */
+static void *page_cache_lookup(uint32_t lba)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &by_lba[lba_hash(lba)]) {
+		struct page_cache_entry *entry = list_entry(pos, struct page_cache_entry, lba_entry);
+		if (entry->lba == lba) {
+			entry->refcount++;
+			return entry->frame;
+		}
+	}
+
+	return 0;
+}
+
+void *page_cache_get(uint32_t lba)
+{
+	struct page_cache_entry *entry;
+	uint32_t generation;
+	uint32_t flags;
+	void *frame;
+
+	flags = spin_lock_irqsave(&page_cache_lock);
+	frame = page_cache_lookup(lba);
+	generation = page_cache_generation;
+	spin_unlock_irqrestore(&page_cache_lock, flags);
+	if (frame)
+		return frame;
+
+	/* Miss.  Read it without the lock held, the read sleeps */
+	entry = kmalloc(sizeof(struct page_cache_entry));
+	frame = kmalloc(PAGING_PAGE_SIZE);
+	if (!entry || !frame || disk_read_block(disk_get(0), lba, SECTORS_PER_PAGE, frame) < 0) {
+		if (entry)
+			kfree(entry);
+		if (frame)
+			kfree(frame);
+		return 0;
+	}
+
+	flags = spin_lock_irqsave(&page_cache_lock);
+
+	/* Someone else may have faulted the same page in while we were reading */
+	void *cached = page_cache_lookup(lba);
+	if (cached) {
+		spin_unlock_irqrestore(&page_cache_lock, flags);
+		kfree(entry);
+		kfree(frame);
+		return cached;
+	}
+
+	entry->lba = lba;
+	entry->frame = frame;
+	entry->refcount = 1;
+	entry->lba_entry.next = 0;
+
+	/* A write submitted while we were reading may have made what we read stale.  Then it's
+	 * still ours, but nobody else finds it
+	 */
+	if (page_cache_generation == generation)
+		list_add(&entry->lba_entry, &by_lba[lba_hash(lba)]);
+	list_add(&entry->frame_entry, &by_frame[frame_hash(frame)]);
+
+	spin_unlock_irqrestore(&page_cache_lock, flags);
+	return frame;
+}
+
+void page_cache_put(void *frame)
+{
+	struct page_cache_entry *found = 0;
+	struct list_head *pos;
+	uint32_t flags = spin_lock_irqsave(&page_cache_lock);
+
+	list_for_each(pos, &by_frame[frame_hash(frame)]) {
+		struct page_cache_entry *entry = list_entry(pos, struct page_cache_entry, frame_entry);
+		if (entry->frame == frame) {
+			found = entry;
+			break;
+		}
+	}
+
+	if (found && --found->refcount == 0) {
+		if (list_is_linked(&found->lba_entry))
+			list_del(&found->lba_entry);
+		list_del(&found->frame_entry);
+	} else {
+		found = 0;
+	}
+
+	spin_unlock_irqrestore(&page_cache_lock, flags);
+
+	if (found) {
+		kfree(found->frame);
+		kfree(found);
+	}
+}
+
+/* Writes are rare next to faults, so walk every bucket rather than index by range: a cached page
+ * can start at any sector, not just a multiple of SECTORS_PER_PAGE
+ */
+void page_cache_invalidate(uint32_t lba, uint32_t total)
+{
+	uint32_t flags = spin_lock_irqsave(&page_cache_lock);
+
+	page_cache_generation++;
+
+	for (int i = 0; i < PAGE_CACHE_BUCKETS; i++) {
+		struct list_head *pos, *n;
+
+		list_for_each_safe(pos, n, &by_lba[i]) {
+			struct page_cache_entry *entry = list_entry(pos, struct page_cache_entry, lba_entry);
+			if (entry->lba < lba + total && lba < entry->lba + SECTORS_PER_PAGE)
+				list_del(&entry->lba_entry);
+		}
+	}
+
+	spin_unlock_irqrestore(&page_cache_lock, flags);
+}
@@ -0,0 +1,37 @@
+/* page_cache.h
+ * shared read only pages of files on disk
+ *
+ * Processes running the same binary map the same frame for each page of its text, instead of
+ * reading and keeping a copy each.  A page is identified by the disk sector it starts at and
+ * stays cached as long as some process maps it.
+ *
+ * Every write to the disk invalidates the cached pages it overlaps.  Processes that already map
+ * one keep the old contents, the next fault reads the new ones.
+ */
+
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <stdint.h>
+
+#define PAGE_CACHE_BUCKETS	64		// power of 2
+
+/*
+ * page_cache_get - the frame holding the page that starts at sector lba, with a reference taken
+ *
+ * Reads it from the disk, sleeping, if it isn't cached yet.  Returns 0 if it can't be allocated
+ * or read.  The frame must not be written
+ */
+void *page_cache_get(uint32_t lba);
+
+/* Drop a reference page_cache_get took.  The frame is freed with the last one */
+void page_cache_put(void *frame);
+
+/* Forget the cached pages overlapping sectors [lba, lba + total), they are about to be written.
+ * Called by disk_submit for every write, safe from interrupts
+ */
+void page_cache_invalidate(uint32_t lba, uint32_t total);
+
+void page_cache_init();
+
+#endif /* PAGE_CACHE_H */
@@ -0,0 +1,332 @@
+#include "vm.h"
+#include "page_cache.h"
+#include "frame_ref.h"
+#include "task/process.h"
+#include "disk/disk.h"
+#include "idt/irq.h"
+#include "idt/exception.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "config.h"
+#include "status.h"
+
+#define SECTORS_PER_PAGE	(PAGING_PAGE_SIZE / DISK_SECTOR_SIZE)
+
+int vm_area_add(struct process *process, uint32_t start, uint32_t end, uint32_t flags, uint32_t lba, uint32_t file_end)
+{
+	struct vm_area *area;
+	struct list_head *pos;
+
+	if (!paging_is_aligned((void *)start) || start >= end || start < PROCESS_USER_START || end > PROCESS_USER_END)
+		return -EINVARG;
+
+	list_for_each(pos, &process->vm_areas) {
+		struct vm_area *other = list_entry(pos, struct vm_area, entry);
+		if (start < other->end && other->start < end)
+			return -EINVARG;
+	}
+
+	area = kzalloc(sizeof(struct vm_area));
+	if (!area)
+		return -ENOMEM;
+
+	area->start = start;
+	area->end = end;
+	area->flags = flags;
+	area->lba = lba;
+	area->file_end = file_end;
+	list_add_tail(&area->entry, &process->vm_areas);
+	return 0;
+}
+
+void vm_area_remove(struct process *process, uint32_t start)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &process->vm_areas) {
+		struct vm_area *area = list_entry(pos, struct vm_area, entry);
+		if (area->start == start) {
+			list_del(&area->entry);
+			kfree(area);
+			return;
+		}
+	}
+}
+
+void vm_area_free_all(struct process *process)
+{
+	while (!list_empty(&process->vm_areas)) {
+		struct vm_area *area = list_first_entry(&process->vm_areas, struct vm_area, entry);
+		list_del(&area->entry);
+		kfree(area);
+	}
+}
+
+static struct vm_area *vm_area_find(struct process *process, uint32_t addr)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &process->vm_areas) {
+		struct vm_area *area = list_entry(pos, struct vm_area, entry);
+		if (addr >= area->start && addr < area->end)
+			return area;
+	}
+
+	return 0;
+}
+
+/* A page of its own for the process: file data up to file_end, zeros after */
+static void *vm_private_page(struct vm_area *area, uint32_t page)
+{
+	uint8_t *frame = kzalloc(PAGING_PAGE_SIZE);
+
+	if (!frame)
+		return 0;
+
+	if ((area->flags & VM_FILE) && page < area->file_end) {
+		uint32_t lba = area->lba + (page - area->start) / DISK_SECTOR_SIZE;
+		uint32_t valid = area->file_end - page;
+
+		if (disk_read_block(disk_get(0), lba, SECTORS_PER_PAGE, frame) < 0) {
+			kfree(frame);
+			return 0;
+		}
+
+		/* Whatever follows the segment's data in the file isn't part of it */
+		if (valid < PAGING_PAGE_SIZE)
+			memset(frame + valid, 0, PAGING_PAGE_SIZE - valid);
+	}
+
+	return frame;
+}
+
+/* Map the page containing addr.  Runs in the faulting process's context and may sleep */
+static int vm_fault(struct process *process, uint32_t addr, bool write)
+{
+	struct vm_area *area = vm_area_find(process, addr);
+	uint32_t page = addr & ~(PAGING_PAGE_SIZE - 1);
+	void *frame;
+	int res;
+
+	if (!area || (write && !(area->flags & VM_WRITE)))
+		return -EINVARG;
+
+	/* Read only and nothing but file data: everyone running this file can share the page */
+	if (!(area->flags & VM_WRITE) && (area->flags & VM_FILE) && page + PAGING_PAGE_SIZE <= area->file_end) {
+		frame = page_cache_get(area->lba + (page - area->start) / DISK_SECTOR_SIZE);
+		if (!frame)
+			return -EIO;
+
+		res = paging_map_user(process->paging, (void *)page, frame, PAGING_PAGE_CACHE);
+		if (res < 0)
+			page_cache_put(frame);
+		return res;
+	}
+
+	frame = vm_private_page(area, page);
+	if (!frame)
+		return -ENOMEM;
+
+	res = paging_map_user(process->paging, (void *)page, frame, (area->flags & VM_WRITE) ? PAGING_READ_WRITE : 0);
+	if (res < 0)
+		kfree(frame);
+	return res;
+}
+
+/* Give process a frame of its own for the copy on write page at page, or just make the page
+ * writable if nobody else holds the frame any more
+ */
+static int vm_cow_break(struct process *process, uint32_t page, uint32_t entry)
+{
+	void *frame = (void *)(entry & PTE_PAGE_FRAME_ADDR);
+	void *copy;
+
+	if (!frame_shared(frame)) {
+		paging_update_user(process->paging, (void *)page, PAGING_COW, PAGING_READ_WRITE);
+		return 0;
+	}
+
+	copy = kmalloc(PAGING_PAGE_SIZE);
+	if (!copy)
+		return -ENOMEM;
+
+	/* The page table exists, so mapping over the old entry can't fail */
+	memcpy(copy, frame, PAGING_PAGE_SIZE);
+	paging_take_user(process->paging, (void *)page);
+	paging_map_user(process->paging, (void *)page, copy, PAGING_READ_WRITE);
+	frame_put(frame);
+	return 0;
+}
+
+/* Make sure page is mapped, and writable in place if write is set, paging it in or copying it
+ * as needed.  Its entry is returned in entry_out.  May sleep
+ */
+static int vm_page_present(struct process *process, uint32_t page, bool write, uint32_t *entry_out)
+{
+	uint32_t entry = paging_get_user(process->paging, (void *)page);
+	int res;
+
+	if (!(entry & PAGING_PRESENT)) {
+		res = vm_fault(process, page, write);
+		if (res < 0)
+			return res;
+		entry = paging_get_user(process->paging, (void *)page);
+	}
+
+	if (write && !(entry & PAGING_READ_WRITE)) {
+		if (!(entry & PAGING_COW))
+			return -EINVARG;
+
+		res = vm_cow_break(process, page, entry);
+		if (res < 0)
+			return res;
+		entry = paging_get_user(process->paging, (void *)page);
+	}
+
+	*entry_out = entry;
+	return 0;
+}
+
+/* Copy len bytes between kernel memory and user address user, through the frames */
+static int vm_copy_user(struct process *process, uint32_t user, uint8_t *kernel, uint32_t len, bool to_user)
+{
+	if (user < PROCESS_USER_START || user > PROCESS_USER_END || len > PROCESS_USER_END - user)
+		return -EINVARG;
+
+	while (len) {
+		uint32_t page = user & ~(PAGING_PAGE_SIZE - 1);
+		uint32_t offset = user - page;
+		uint32_t n = PAGING_PAGE_SIZE - offset < len ? PAGING_PAGE_SIZE - offset : len;
+		uint32_t entry;
+		uint8_t *data;
+		int res = vm_page_present(process, page, to_user, &entry);
+
+		if (res < 0)
+			return res;
+
+		/* Frames are identity mapped, no need to go through the process's page tables */
+		data = (uint8_t *)(entry & PTE_PAGE_FRAME_ADDR) + offset;
+		if (to_user) {
+			memcpy(data, kernel, n);
+		} else {
+			memcpy(kernel, data, n);
+		}
+
+		user += n;
+		kernel += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+int vm_copy_from_user(struct process *process, void *dest, uint32_t src, uint32_t len)
+{
+	return vm_copy_user(process, src, dest, len, false);
+}
+
+int vm_copy_to_user(struct process *process, uint32_t dest, const void *src, uint32_t len)
+{
+	return vm_copy_user(process, dest, (uint8_t *)src, len, true);
+}
+
+int vm_user_phys(struct process *process, uint32_t addr, bool write, uint32_t *phys_out)
+{
+	uint32_t page = addr & ~(PAGING_PAGE_SIZE - 1);
+	uint32_t entry;
+	int res = vm_page_present(process, page, write, &entry);
+
+	if (res < 0)
+		return res;
+
+	*phys_out = (entry & PTE_PAGE_FRAME_ADDR) | (addr - page);
+	return 0;
+}
+
+int vm_page_share(struct process *process, uint32_t page, bool move, void **frame_out)
+{
+	uint32_t entry;
+	void *frame;
+	int res;
+
+	if (!paging_is_aligned((void *)page))
+		return -EINVARG;
+
+	res = vm_page_present(process, page, false, &entry);
+	if (res < 0)
+		return res;
+
+	/* Page cache and kernel object frames aren't the process's to hand out */
+	if (entry & (PAGING_PAGE_CACHE | PAGING_SHARED))
+		return -EINVARG;
+
+	/* A writable frame someone else holds is shared memory (IPC_SHARE), which copy on write
+	 * would quietly unshare
+	 */
+	frame = (void *)(entry & PTE_PAGE_FRAME_ADDR);
+	if ((entry & PAGING_READ_WRITE) && frame_shared(frame))
+		return -EINVARG;
+
+	if (move) {
+		paging_take_user(process->paging, (void *)page);
+	} else {
+		frame_get(frame);
+		if (entry & PAGING_READ_WRITE)
+			paging_update_user(process->paging, (void *)page, PAGING_READ_WRITE, PAGING_COW);
+	}
+
+	*frame_out = frame;
+	return 0;
+}
+
+int vm_page_install(struct process *process, uint32_t page, void *frame)
+{
+	struct vm_area *area = vm_area_find(process, page);
+	uint32_t entry = paging_get_user(process->paging, (void *)page);
+	bool writable;
+	int res;
+
+	if (entry & PAGING_PRESENT) {
+		writable = (entry & (PAGING_READ_WRITE | PAGING_COW)) && !(entry & (PAGING_PAGE_CACHE | PAGING_SHARED));
+	} else {
+		writable = area && (area->flags & VM_WRITE);
+	}
+
+	if (!paging_is_aligned((void *)page) || !writable)
+		return -EINVARG;
+
+	res = paging_alloc_user_tables(process->paging, (void *)page, PAGING_PAGE_SIZE);
+	if (res < 0)
+		return res;
+
+	/* Unmap first: if the old page was this frame, its reference goes and the frame may no
+	 * longer be shared
+	 */
+	paging_unmap_user(process->paging, (void *)page);
+	paging_map_user(process->paging, (void *)page, frame, frame_shared(frame) ? PAGING_COW : PAGING_READ_WRITE);
+	return 0;
+}
+
+static void page_fault_handler(struct interrupt_frame *frame, void *ctx)
+{
+	struct process *process = process_current();
+	uint32_t addr = thread_current()->fault_address;
+	bool write = frame->error_code & PAGE_FAULT_WRITE;
+	uint32_t entry;
+
+	/* Not present pages in user space get paged in and writes to copy on write pages copy
+	 * them, other protection faults are real ones
+	 */
+	if (!interrupt_frame_from_user(frame) || !process || ((frame->error_code & PAGE_FAULT_PRESENT) && !write) ||
+	    vm_page_present(process, addr & ~(PAGING_PAGE_SIZE - 1), write, &entry) < 0) {
+		exception_unhandled(frame);
+	}
+}
+
+void vm_init()
+{
+	frame_ref_init();
+	page_cache_init();
+	irq_register(EXCEPTION_PAGE_FAULT, page_fault_handler, 0);
+}
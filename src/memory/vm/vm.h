@@ -0,0 +1,94 @@
+/* vm.h
+ * demand paged user memory
+ *
+ * A process's user space is described by vm areas instead of being mapped up front.  The first
+ * touch of a page raises a page fault, and the fault handler fills it in: from the file the area
+ * maps, zeroed past the end of the file's data, or straight from the page cache for read only
+ * pages that are all file data, so processes running the same binary share them.
+ *
+ * Private frames can also be shared copy on write (frame_ref.h): both sides map them read only
+ * with PAGING_COW, and the first write to one copies it, or just makes it writable again if
+ * nobody else holds the frame by then.
+ */
+
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/list.h"
+
+#define VM_WRITE		0x01
+#define VM_FILE			0x02		// backed by sectors on the disk, otherwise zero filled
+
+struct vm_area {
+	uint32_t start;			// page aligned
+	uint32_t end;			// page aligned, exclusive
+	uint32_t flags;			// VM_*
+	uint32_t lba;			// VM_FILE: sector that start's page is read from
+	uint32_t file_end;		// VM_FILE: address the file data ends at, the rest reads as zeros
+	struct list_head entry;		// on the process's vm_areas
+};
+
+struct process;
+
+/*
+ * vm_area_add - describe [start, end) of process's user space, without mapping anything
+ *
+ * start must be page aligned.  For VM_FILE areas, page start is read from sector lba onwards and
+ * bytes from file_end on are zero.  Returns -EINVARG if the range is outside the user range or
+ * overlaps an area, -ENOMEM if out of memory
+ */
+int vm_area_add(struct process *process, uint32_t start, uint32_t end, uint32_t flags, uint32_t lba, uint32_t file_end);
+
+/* Forget the area that starts at start, if there is one.  Doesn't touch its mappings */
+void vm_area_remove(struct process *process, uint32_t start);
+
+/* Free process's vm areas.  Doesn't touch the mappings, paging_free_process does those */
+void vm_area_free_all(struct process *process);
+
+/*
+ * vm_copy_from_user - copy len bytes at user address src of process, the current one, to dest
+ *
+ * Pages are faulted in as needed, so it may sleep.  Returns -EINVARG if part of the range isn't
+ * user memory the process could read, -ENOMEM or -EIO if a page can't be brought in
+ */
+int vm_copy_from_user(struct process *process, void *dest, uint32_t src, uint32_t len);
+
+/* Copy len bytes from src to user address dest of process, the current one.  Copy on write
+ * pages are copied first.  Returns like vm_copy_from_user
+ */
+int vm_copy_to_user(struct process *process, uint32_t dest, const void *src, uint32_t len);
+
+/*
+ * vm_user_phys - the physical address behind user address addr of process, the current one
+ *
+ * The page is faulted in, and with write made writable in place, so the address stays valid
+ * until the process unmaps the page.  Returns -EINVARG if addr isn't memory the process could
+ * access that way, -ENOMEM or -EIO if the page can't be brought in
+ */
+int vm_user_phys(struct process *process, uint32_t addr, bool write, uint32_t *phys_out);
+
+/*
+ * vm_page_share - a reference on the frame of process's private page at page, for another owner
+ *
+ * With move the page is unmapped from process, which reads back a fresh page of its area the
+ * next time it touches it.  Otherwise process keeps it, copy on write.  Returns the frame in
+ * frame_out, or -EINVARG if page isn't mapped memory of the process's own (page cache,
+ * PAGING_SHARED and IPC_SHARE frames aren't), in which case the caller should copy instead
+ */
+int vm_page_share(struct process *process, uint32_t page, bool move, void **frame_out);
+
+/*
+ * vm_page_install - map frame at page of process, the current one, in place of what was there
+ *
+ * The caller's reference on frame goes to the mapping, which is copy on write if the frame is
+ * still shared.  Returns -EINVARG, and keeps the reference, if page isn't writable memory of the
+ * process, or -ENOMEM
+ */
+int vm_page_install(struct process *process, uint32_t page, void *frame);
+
+/* Install the page fault handler */
+void vm_init();
+
+#endif /* VM_H */
@@ -0,0 +1,81 @@
+#include "pic.h"
+#include "io/io.h"
+#include "idt/irq.h"
+
+#define PIC_MASTER_COMMAND	0x20
+#define PIC_MASTER_DATA		0x21
+#define PIC_SLAVE_COMMAND	0xA0
+#define PIC_SLAVE_DATA		0xA1
+
+#define PIC_ICW1_INIT		0x11		// initialization mode, cascaded, expect icw4
+#define PIC_ICW3_SLAVE_AT_IRQ2	0x04		// master: bitmask of the line the slave hangs off
+#define PIC_ICW3_SLAVE_ID	0x02		// slave: its cascade identity
+#define PIC_ICW4_8086		0x01
+#define PIC_EOI			0x20
+#define PIC_CASCADE_IRQ		2
+
+/* Mirrors of the interrupt mask registers so masking doesn't need a port read */
+static unsigned char master_mask = 0xff;
+static unsigned char slave_mask = 0xff;
+
+void pic_init()
+{
+	/* Refer to the OSDev Wiki 8259 PIC article.  Each PIC expects ICW1 on its command port
+	 * followed by ICW2-ICW4 on its data port
+	 */
+	outb(PIC_MASTER_COMMAND, PIC_ICW1_INIT);
+	outb(PIC_SLAVE_COMMAND, PIC_ICW1_INIT);
+
+	outb(PIC_MASTER_DATA, IRQ_VECTOR_BASE);		// ICW2: vector offsets
+	outb(PIC_SLAVE_DATA, IRQ_VECTOR_BASE + 8);
+
+	outb(PIC_MASTER_DATA, PIC_ICW3_SLAVE_AT_IRQ2);	// ICW3: cascade wiring
+	outb(PIC_SLAVE_DATA, PIC_ICW3_SLAVE_ID);
+
+	outb(PIC_MASTER_DATA, PIC_ICW4_8086);		// ICW4: 8086 mode, end initialization
+	outb(PIC_SLAVE_DATA, PIC_ICW4_8086);
+
+	/* The slave is only reachable through the cascade line, so that one stays open */
+	master_mask = 0xff & ~(1 << PIC_CASCADE_IRQ);
+	slave_mask = 0xff;
+	outb(PIC_MASTER_DATA, master_mask);
+	outb(PIC_SLAVE_DATA, slave_mask);
+}
+
+void pic_disable()
+{
+	master_mask = 0xff;
+	slave_mask = 0xff;
+	outb(PIC_MASTER_DATA, master_mask);
+	outb(PIC_SLAVE_DATA, slave_mask);
+}
+
+void pic_unmask(int irq)
+{
+	if (irq < 8) {
+		master_mask &= ~(1 << irq);
+		outb(PIC_MASTER_DATA, master_mask);
+	} else {
+		slave_mask &= ~(1 << (irq - 8));
+		outb(PIC_SLAVE_DATA, slave_mask);
+	}
+}
+
+void pic_mask(int irq)
+{
+	if (irq < 8) {
+		master_mask |= 1 << irq;
+		outb(PIC_MASTER_DATA, master_mask);
+	} else {
+		slave_mask |= 1 << (irq - 8);
+		outb(PIC_SLAVE_DATA, slave_mask);
+	}
+}
+
+void pic_eoi(int irq)
+{
+	if (irq >= 8)
+		outb(PIC_SLAVE_COMMAND, PIC_EOI);
+
+	outb(PIC_MASTER_COMMAND, PIC_EOI);
+}
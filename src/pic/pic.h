@@ -0,0 +1,24 @@
+#ifndef PIC_H
+#define PIC_H
+
+/*
+ * pic_init - remap both 8259 PICs
+ *
+ * The master's irqs 0-7 are delivered on vectors IRQ_VECTOR_BASE to IRQ_VECTOR_BASE + 7 and
+ * the slave's irqs 8-15 on the next 8 vectors.  Every line starts masked.
+ */
+void pic_init();
+
+/* Mask every line on both PICs.  Used when the io apic takes over interrupt routing */
+void pic_disable();
+
+/* Allow irq (0-15) to be delivered */
+void pic_unmask(int irq);
+
+/* Stop irq (0-15) from being delivered */
+void pic_mask(int irq);
+
+/* Acknowledge irq.  Irqs on the slave need both PICs acknowledged */
+void pic_eoi(int irq);
+
+#endif /* PIC_H */
@@ -0,0 +1,380 @@
+#include "pipe.h"
+#include "task/process.h"
+#include "memory/vm/vm.h"
+#include "memory/vm/frame_ref.h"
+#include "memory/paging/paging.h"
+#include "memory/heap/kernel_heap.h"
+#include "idt/idt.h"
+#include "status.h"
+
+static struct list_head pipes;
+static uint32_t next_pipe_id = 1;
+
+void pipe_init()
+{
+	list_init(&pipes);
+}
+
+/* Interrupts are disabled */
+static struct pipe *pipe_find(uint32_t id)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &pipes) {
+		struct pipe *pipe = list_entry(pos, struct pipe, entry);
+		if (pipe->id == id)
+			return pipe;
+	}
+
+	return 0;
+}
+
+/* Pipe id if the calling process holds its end end.  It can't be freed while we hold an end */
+static struct pipe *pipe_get(uint32_t id, uint32_t end)
+{
+	struct process *self = process_current();
+	uint32_t flags = interrupts_save_disable();
+	struct pipe *pipe = pipe_find(id);
+
+	if (pipe && (!self || pipe->ends[end].owner != self))
+		pipe = 0;
+
+	interrupts_restore(flags);
+	return pipe;
+}
+
+int pipe_create()
+{
+	struct pipe *pipe = kzalloc(sizeof(struct pipe));
+	uint32_t flags;
+
+	if (!pipe)
+		return -ENOMEM;
+
+	mutex_init(&pipe->lock);
+	wait_queue_init(&pipe->read_wait);
+	wait_queue_init(&pipe->write_wait);
+
+	flags = interrupts_save_disable();
+	pipe->id = next_pipe_id++;
+	pipe->creator = process_current();
+	list_add_tail(&pipe->entry, &pipes);
+	interrupts_restore(flags);
+
+	return pipe->id;
+}
+
+int pipe_open(uint32_t id, uint32_t end)
+{
+	struct process *self = process_current();
+	struct pipe *pipe;
+	uint32_t flags;
+	int res = 0;
+
+	if (!self)
+		return -ENODEV;
+	if (end != PIPE_READ && end != PIPE_WRITE)
+		return -EINVARG;
+
+	flags = interrupts_save_disable();
+	pipe = pipe_find(id);
+	if (!pipe) {
+		res = -EINVARG;
+	} else if (pipe->ends[end].owner || pipe->ends[end].closed) {
+		res = -EBUSY;
+	} else {
+		pipe->ends[end].owner = self;
+	}
+	interrupts_restore(flags);
+
+	return res;
+}
+
+/* The newest buffer if more can be appended to it.  Only pages the pipe allocated are ever
+ * partly filled at the end, pages taken from a writer always hold data up to the end
+ */
+static struct pipe_buf *pipe_tail_room(struct pipe *pipe)
+{
+	struct pipe_buf *tail;
+
+	if (!pipe->count)
+		return 0;
+
+	tail = &pipe->bufs[(pipe->head + pipe->count - 1) % PIPE_BUFFERS];
+	return tail->offset + tail->len < PAGING_PAGE_SIZE ? tail : 0;
+}
+
+static struct pipe_buf *pipe_push(struct pipe *pipe, void *frame, uint32_t len)
+{
+	struct pipe_buf *buf = &pipe->bufs[(pipe->head + pipe->count) % PIPE_BUFFERS];
+
+	buf->frame = frame;
+	buf->offset = 0;
+	buf->len = len;
+	pipe->count++;
+	return buf;
+}
+
+/* Drop the oldest buffer, and the pipe's reference on its frame unless put is false because it
+ * was handed on
+ */
+static void pipe_pop(struct pipe *pipe, bool put)
+{
+	if (put)
+		frame_put(pipe->bufs[pipe->head].frame);
+
+	pipe->head = (pipe->head + 1) % PIPE_BUFFERS;
+	pipe->count--;
+}
+
+int pipe_read(uint32_t id, uint32_t buf, uint32_t len)
+{
+	struct process *self = process_current();
+	struct pipe *pipe = pipe_get(id, PIPE_READ);
+	uint32_t done = 0;
+	int res = 0;
+
+	if (!pipe)
+		return -EINVARG;
+	if (!len)
+		return 0;
+
+	mutex_lock(&pipe->lock);
+
+	while (!pipe->count && !pipe->ends[PIPE_WRITE].closed) {
+		mutex_unlock(&pipe->lock);
+		wait_event(&pipe->read_wait, pipe->count || pipe->ends[PIPE_WRITE].closed);
+		mutex_lock(&pipe->lock);
+	}
+
+	while (done < len && pipe->count) {
+		struct pipe_buf *head = &pipe->bufs[pipe->head];
+		uint32_t dest = buf + done;
+		uint32_t left = len - done;
+		uint32_t n;
+
+		/* A whole page takes the place of the reader's page, no copy */
+		if (head->offset == 0 && head->len == PAGING_PAGE_SIZE && paging_is_aligned((void *)dest) &&
+		    left >= PAGING_PAGE_SIZE && vm_page_install(self, dest, head->frame) == 0) {
+			pipe_pop(pipe, false);
+			done += PAGING_PAGE_SIZE;
+			continue;
+		}
+
+		n = head->len < left ? head->len : left;
+		res = vm_copy_to_user(self, dest, (uint8_t *)head->frame + head->offset, n);
+		if (res < 0)
+			break;
+
+		head->offset += n;
+		head->len -= n;
+		done += n;
+		if (!head->len)
+			pipe_pop(pipe, true);
+	}
+
+	mutex_unlock(&pipe->lock);
+	wake_up_all(&pipe->write_wait);
+
+	return done ? (int)done : res;
+}
+
+int pipe_write(uint32_t id, uint32_t buf, uint32_t len, uint32_t flags)
+{
+	struct process *self = process_current();
+	struct pipe *pipe = pipe_get(id, PIPE_WRITE);
+	uint32_t done = 0;
+	int res = 0;
+
+	if (!pipe || (flags & ~PIPE_GIFT))
+		return -EINVARG;
+
+	mutex_lock(&pipe->lock);
+
+	while (done < len) {
+		uint32_t src = buf + done;
+		uint32_t left = len - done;
+		struct pipe_buf *tail;
+		void *frame;
+		uint32_t n;
+
+		if (pipe->ends[PIPE_READ].closed) {
+			res = -EIO;
+			break;
+		}
+
+		/* Whole pages go in by reference */
+		if (pipe->count < PIPE_BUFFERS && paging_is_aligned((void *)src) && left >= PAGING_PAGE_SIZE &&
+		    vm_page_share(self, src, flags & PIPE_GIFT, &frame) == 0) {
+			pipe_push(pipe, frame, PAGING_PAGE_SIZE);
+			done += PAGING_PAGE_SIZE;
+			continue;
+		}
+
+		/* Everything else is copied into pages of the pipe's own */
+		tail = pipe_tail_room(pipe);
+		if (!tail && pipe->count == PIPE_BUFFERS) {
+			mutex_unlock(&pipe->lock);
+			wake_up_all(&pipe->read_wait);
+			wait_event(&pipe->write_wait, pipe->count < PIPE_BUFFERS || pipe->ends[PIPE_READ].closed);
+			mutex_lock(&pipe->lock);
+			continue;
+		}
+
+		if (!tail) {
+			frame = kmalloc(PAGING_PAGE_SIZE);
+			if (!frame) {
+				res = -ENOMEM;
+				break;
+			}
+			tail = pipe_push(pipe, frame, 0);
+		}
+
+		n = PAGING_PAGE_SIZE - (tail->offset + tail->len);
+		if (n > left)
+			n = left;
+
+		res = vm_copy_from_user(self, (uint8_t *)tail->frame + tail->offset + tail->len, src, n);
+		if (res < 0) {
+			/* Don't leave an empty buffer behind, a reader would take it for the end */
+			if (!tail->len) {
+				frame_put(tail->frame);
+				pipe->count--;
+			}
+			break;
+		}
+
+		tail->len += n;
+		done += n;
+	}
+
+	mutex_unlock(&pipe->lock);
+	wake_up_all(&pipe->read_wait);
+
+	return done ? (int)done : res;
+}
+
+static void pipe_free(struct pipe *pipe)
+{
+	while (pipe->count)
+		pipe_pop(pipe, true);
+
+	kfree(pipe);
+}
+
+/* Nobody holds an end, and nobody can open one that still matters.  Interrupts are disabled */
+static bool pipe_dead(struct pipe *pipe)
+{
+	if (pipe->ends[PIPE_READ].owner || pipe->ends[PIPE_WRITE].owner)
+		return false;
+
+	return pipe->orphaned || (pipe->ends[PIPE_READ].closed && pipe->ends[PIPE_WRITE].closed);
+}
+
+static void pipe_close_end(struct pipe *pipe, uint32_t end)
+{
+	uint32_t flags = interrupts_save_disable();
+	bool dead;
+
+	pipe->ends[end].owner = 0;
+	pipe->ends[end].closed = true;
+
+	dead = pipe_dead(pipe);
+	if (dead)
+		list_del(&pipe->entry);
+
+	interrupts_restore(flags);
+
+	if (dead) {
+		pipe_free(pipe);
+		return;
+	}
+
+	/* The other end may be asleep waiting on this one */
+	wake_up_all(&pipe->read_wait);
+	wake_up_all(&pipe->write_wait);
+}
+
+int pipe_close(uint32_t id)
+{
+	int res = -EINVARG;
+
+	for (uint32_t end = PIPE_READ; end <= PIPE_WRITE; end++) {
+		struct pipe *pipe = pipe_get(id, end);
+		if (pipe) {
+			pipe_close_end(pipe, end);
+			res = 0;
+		}
+	}
+
+	return res;
+}
+
+void pipe_abandon(uint32_t id, uint32_t end)
+{
+	uint32_t flags = interrupts_save_disable();
+	struct pipe *pipe = pipe_find(id);
+	bool unopened = pipe && !pipe->ends[end].owner && !pipe->ends[end].closed;
+
+	interrupts_restore(flags);
+
+	if (unopened)
+		pipe_close_end(pipe, end);
+}
+
+void pipe_exit(struct process *process)
+{
+	while (1) {
+		struct pipe *found = 0;
+		uint32_t end = 0;
+		struct list_head *pos;
+		uint32_t flags = interrupts_save_disable();
+
+		list_for_each(pos, &pipes) {
+			struct pipe *pipe = list_entry(pos, struct pipe, entry);
+			for (end = PIPE_READ; end <= PIPE_WRITE; end++) {
+				if (pipe->ends[end].owner == process) {
+					found = pipe;
+					break;
+				}
+			}
+			if (found)
+				break;
+		}
+
+		interrupts_restore(flags);
+
+		if (!found)
+			break;
+
+		pipe_close_end(found, end);
+	}
+
+	/* Its pipes outlive it while someone has an end open, the last close frees them */
+	while (1) {
+		struct pipe *dead = 0;
+		struct list_head *pos;
+		uint32_t flags = interrupts_save_disable();
+
+		list_for_each(pos, &pipes) {
+			struct pipe *pipe = list_entry(pos, struct pipe, entry);
+			if (pipe->creator != process)
+				continue;
+
+			pipe->creator = 0;
+			pipe->orphaned = true;
+			if (pipe_dead(pipe)) {
+				dead = pipe;
+				list_del(&pipe->entry);
+				break;
+			}
+		}
+
+		interrupts_restore(flags);
+
+		if (!dead)
+			return;
+
+		pipe_free(dead);
+	}
+}
@@ -0,0 +1,106 @@
+/* pipe.h
+ * pipes between processes that move pages instead of copying bytes
+ *
+ * A pipe holds up to PIPE_BUFFERS pages of data in a ring, each with the offset and length of
+ * the data still in it.  A write of a whole, page aligned user page doesn't copy it: the pipe
+ * takes a reference on the writer's frame, which stays mapped in the writer copy on write (or
+ * leaves the writer with PIPE_GIFT).  A read of a whole page into a page aligned buffer maps the
+ * frame in place of the reader's page, copy on write again if the writer still has it.  So a
+ * page can go from producer to consumer without its bytes being touched, and nothing is copied
+ * unless one side writes to it afterwards.
+ *
+ * Small or unaligned writes fall back to copying into pages the pipe allocates, appending to the
+ * last one while it has room, which makes the ring an ordinary byte ring buffer.  Reads of those
+ * copy out, or take the whole page when it's full and the reader's buffer is aligned.
+ *
+ * There are no file descriptors, a pipe is known by its id.  A process claims one end with
+ * pipe_open and only it may use that end until it closes it or exits.  Once both ends have been
+ * opened and closed the pipe is freed.  So is a pipe with neither end open once the process that
+ * created it has exited, as nobody is left to hand its id on.
+ */
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/list.h"
+#include "task/mutex.h"
+#include "task/wait.h"
+#include "config.h"
+
+#define PIPE_READ		0		// ends
+#define PIPE_WRITE		1
+
+#define PIPE_GIFT		0x01		// pipe_write: whole pages leave the writer instead of being shared
+
+struct pipe_buf {
+	void *frame;			// a page the pipe holds a reference on
+	uint32_t offset;		// data not read yet
+	uint32_t len;
+};
+
+struct pipe_end {
+	struct process *owner;		// 0 until opened, and again once closed
+	bool closed;
+};
+
+struct pipe {
+	uint32_t id;
+	struct pipe_end ends[2];
+	struct mutex lock;		// the ring, readers and writers may sleep on page faults
+	struct pipe_buf bufs[PIPE_BUFFERS];
+	uint32_t head;			// oldest data
+	uint32_t count;
+	struct wait_queue read_wait;	// the reader, for data or the writer closing
+	struct wait_queue write_wait;	// the writer, for room or the reader closing
+	struct list_head entry;		// on the list of pipes
+	struct process *creator;	// 0 once it exits, and for pipes the kernel created
+	bool orphaned;			// created by a process that has exited
+};
+
+struct process;
+
+void pipe_init();
+
+/* A new pipe, with neither end open.  Returns its id, or -ENOMEM */
+int pipe_create();
+
+/* Claim end (PIPE_READ or PIPE_WRITE) of pipe id for the calling process.  Returns -EINVARG if
+ * there is no such pipe or end, -EBUSY if the end has been opened already
+ */
+int pipe_open(uint32_t id, uint32_t end);
+
+/*
+ * pipe_read - read up to len bytes from pipe id into user buffer buf
+ *
+ * Sleeps until there is data, then returns what fits without waiting for more.  Returns 0 once
+ * the write end is closed and the pipe is empty, -EINVARG if the caller doesn't hold the read
+ * end or buf isn't writable memory of its own
+ */
+int pipe_read(uint32_t id, uint32_t buf, uint32_t len);
+
+/*
+ * pipe_write - write len bytes from user buffer buf into pipe id
+ *
+ * Sleeps while the pipe is full until everything has been written.  flags can be PIPE_GIFT.
+ * Returns len, or what was written before the read end was closed (-EIO if nothing) or a fault
+ * in buf (-EINVARG if nothing).  Returns -EINVARG if the caller doesn't hold the write end
+ */
+int pipe_write(uint32_t id, uint32_t buf, uint32_t len, uint32_t flags);
+
+/* Close the ends of pipe id the calling process holds.  Returns -EINVARG if it holds neither */
+int pipe_close(uint32_t id);
+
+/* Close end of pipe id if nobody has opened it, for the kernel when the process that was going to
+ * open it couldn't be started.  The other side sees the end closed, and the pipe is freed once
+ * both ends are
+ */
+void pipe_abandon(uint32_t id, uint32_t end);
+
+/* Close every pipe end process holds, which is exiting, and free the pipes it created that
+ * nobody has open.  Called by process_exit
+ */
+void pipe_exit(struct process *process);
+
+#endif /* PIPE_H */
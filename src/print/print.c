@@ -1,4 +1,7 @@
 #include "print.h"
+#include "lib/math.h"
+#include "lib/spinlock.h"
+#include <stdbool.h>
 
 /* The QEMU PC emulator simulates a Cirrus CLGD 5446 PCI VGA card */
 #define VGA_WIDTH 80
@@ -12,6 +15,13 @@
  */
 static uint16_t* video_mem = (uint16_t*)(0xB8000);
 
+/* Guards the cursor, held across a whole string so lines from different cpus don't interleave */
+static spinlock_t terminal_lock;
+LOCK_CLASS(terminal_lock_class, "terminal");
+
+/* Set by panic: print goes around terminal_lock, its holder may be the code that died */
+static volatile bool terminal_panicking = false;
+
 uint16_t terminal_make_char(char c, char color)
 {
 	/* Since CPU is little endian, the value we're writing 
@@ -49,6 +59,8 @@ void terminal_write_char(char c, char color)
 
 void terminal_initialize() 
 {
+	spin_lock_init(&terminal_lock, &terminal_lock_class);
+
 	for (int row = 0; row < VGA_HEIGHT; row++) {
 		for (int col = 0; col < VGA_WIDTH; col++) {
 			terminal_put_char(row, col, ' ', 0);
@@ -68,12 +80,57 @@ size_t strlen(const char* str)
 	return len;
 }
 
+void terminal_panic()
+{
+	terminal_panicking = true;
+}
+
 void print(const char* str)
 {
 	size_t len = strlen(str);
+	uint32_t flags;
+
+	if (terminal_panicking) {
+		for (int i = 0; i < len; i++) {
+			terminal_write_char(str[i], 15);
+		}
+		return;
+	}
+
+	flags = spin_lock_irqsave(&terminal_lock);
+
 	for (int i = 0; i < len; i++) {
 		terminal_write_char(str[i], 15);
 	}
+
+	spin_unlock_irqrestore(&terminal_lock, flags);
+}
+
+void print_dec(uint64_t val)
+{
+	char buf[21];				/* 2^64 - 1 is 20 digits long */
+	int i = sizeof(buf) - 1;
+
+	buf[i] = 0;
+	do {
+		buf[--i] = '0' + div64_32(&val, 10);
+	} while (val);
+
+	print(&buf[i]);
 }
 
+void print_hex(uint32_t val)
+{
+	const char *digits = "0123456789abcdef";
+	char buf[11];
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (int i = 0; i < 8; i++) {
+		buf[9 - i] = digits[val & 0xf];
+		val >>= 4;
+	}
+	buf[10] = 0;
 
+	print(buf);
+}
@@ -12,8 +12,19 @@ void terminal_write_char(char c, char color);
 
 void terminal_initialize();
 
+/* Print without terminal_lock from now on, so a panic shows even if the lock's holder is stuck
+ * (a fault in print, or a double fault).  Lines from different cpus may interleave
+ */
+void terminal_panic();
+
 size_t strlen(const char* str);
 
 void print(const char* str);
 
+/* Print val in base 10 */
+void print_dec(uint64_t val);
+
+/* Print val as 8 hex digits prefixed with 0x */
+void print_hex(uint32_t val);
+
 #endif /* PRINT_H_ */
@@ -0,0 +1,46 @@
+#include "percpu.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "config.h"
+
+static struct percpu boot_percpu;
+static struct percpu *percpu_areas[CONFIG_MAX_CPUS];
+
+struct percpu *percpu_init(int cpu)
+{
+	struct percpu *area;
+
+	if (cpu < 0 || cpu >= CONFIG_MAX_CPUS)
+		return 0;
+
+	if (cpu == 0) {
+		area = &boot_percpu;
+		memset(area, 0, sizeof(*area));
+	} else {
+		area = kzalloc(sizeof(struct percpu));
+		if (!area)
+			return 0;
+	}
+
+	area->self = area;
+	area->cpu = cpu;
+	percpu_areas[cpu] = area;
+	return area;
+}
+
+void percpu_free(int cpu)
+{
+	if (cpu <= 0 || cpu >= CONFIG_MAX_CPUS || !percpu_areas[cpu])
+		return;
+
+	kfree(percpu_areas[cpu]);
+	percpu_areas[cpu] = 0;
+}
+
+struct percpu *percpu_area(int cpu)
+{
+	if (cpu < 0 || cpu >= CONFIG_MAX_CPUS)
+		return 0;
+
+	return percpu_areas[cpu];
+}
@@ -0,0 +1,78 @@
+/* percpu.h
+ * per cpu data, addressed through the gs segment
+ *
+ * Every cpu's gdt has a GDT_PERCPU data segment whose base is that cpu's struct percpu, and the
+ * kernel always runs with gs loaded with it.  A %gs relative load therefore reaches the calling
+ * cpu's copy of a field in one instruction, without knowing which cpu we're on and without
+ * locks, since nobody else writes it.
+ *
+ * Each subsystem keeps its per cpu state in a struct of its own, embedded here.
+ */
+
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "idt/irq.h"
+#include "softirq/softirq.h"
+#include "task/sched.h"
+#include "task/task_pool.h"
+#include "memory/heap/kernel_heap.h"
+#include "cpu/idle.h"
+
+struct percpu {
+	struct percpu *self;		// must stay first, this_cpu() turns gs into a pointer by loading it
+	int cpu;			// index of this cpu, 0 for the boot cpu
+	uint32_t ticks;			// timer ticks taken while the boot cpu keeps time
+	struct irq_percpu irq;
+	struct softirq_queue softirq;
+	struct sched_percpu sched;
+	struct task_deque tasks;
+	struct heap_cache heap_cache;
+	struct idle_stats idle;
+	uint64_t idle_start_tsc;
+};
+
+/* The calling cpu's per cpu area */
+static inline struct percpu *this_cpu()
+{
+	struct percpu *self;
+	__asm__ __volatile__("movl %%gs:0, %0" : "=r"(self));
+	return self;
+}
+
+/*
+ * this_cpu_read/this_cpu_write - access a 32 bit field of the calling cpu's area with a single
+ * gs relative mov, e.g. this_cpu_read(sched.current)
+ */
+#define this_cpu_read(field) ({								\
+	__typeof__(((struct percpu *)0)->field) __val;					\
+	_Static_assert(sizeof(__val) == 4, "this_cpu_read only handles 32 bit fields");\
+	__asm__ __volatile__("movl %%gs:%c1, %0"					\
+			     : "=r"(__val) : "i"(offsetof(struct percpu, field)));	\
+	__val;										\
+})
+
+#define this_cpu_write(field, val) do {							\
+	__typeof__(((struct percpu *)0)->field) __val = (val);				\
+	_Static_assert(sizeof(__val) == 4, "this_cpu_write only handles 32 bit fields");\
+	__asm__ __volatile__("movl %0, %%gs:%c1"					\
+			     : : "r"(__val), "i"(offsetof(struct percpu, field)) : "memory");\
+} while (0)
+
+/*
+ * percpu_init - set up the per cpu area of cpu and return it
+ *
+ * The boot cpu's area is static so it can exist before the heap.  Other cpus' areas are
+ * allocated, returns 0 if that fails
+ */
+struct percpu *percpu_init(int cpu);
+
+/* Free the area of cpu, an application processor that never came up */
+void percpu_free(int cpu);
+
+/* The per cpu area of cpu, for looking at another cpu's state.  0 if it isn't set up */
+struct percpu *percpu_area(int cpu);
+
+#endif /* PERCPU_H */
@@ -0,0 +1,242 @@
+#include "smp.h"
+#include "acpi/acpi.h"
+#include "apic/apic.h"
+#include "gdt/gdt.h"
+#include "idt/idt.h"
+#include "idt/irq.h"
+#include "cpu/cpu.h"
+#include "timer/timer.h"
+#include "timer/clock.h"
+#include "timer/lapic_timer.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "memory/paging/paging.h"
+#include "lib/atomic.h"
+#include "smp/percpu.h"
+#include "syscall/syscall.h"
+#include "print/print.h"
+#include "config.h"
+#include "status.h"
+#include <stdbool.h>
+
+#define SMP_INIT_DELAY_US	10000		// INIT to first startup ipi, per the Intel MP spec
+#define SMP_SIPI_DELAY_US	200		// between the two startup ipis
+#define SMP_BOOT_TIMEOUT_US	100000		// how long an AP gets to check in
+
+
+struct smp_cpu {
+	uint8_t apic_id;
+	bool online;
+	smp_fn_t fn;				// work from smp_call, cleared once it has run, or SMP_FN_CLAIMED
+	void *arg;
+	void *stack;
+};
+
+/* fn while an smp_call that won the slot is still storing arg */
+#define SMP_FN_CLAIMED		((smp_fn_t)1)
+
+static struct smp_cpu cpus[CONFIG_MAX_CPUS];
+static int cpus_online = 1;
+static int booting_cpu = 0;			// the AP that is currently using the trampoline
+
+extern uint8_t trampoline_start[];
+extern uint8_t trampoline_end[];
+extern uint32_t trampoline_cr3;
+extern uint32_t trampoline_stack;
+extern uint32_t trampoline_entry;
+
+/* Where a trampoline variable ends up once the trampoline is copied into low memory */
+static uint32_t *trampoline_var(uint32_t *var)
+{
+	return (uint32_t *)(SMP_TRAMPOLINE_ADDR + ((uint8_t *)var - trampoline_start));
+}
+
+int smp_processor_id()
+{
+	return this_cpu_read(cpu);
+}
+
+int smp_cpu_count()
+{
+	return cpus_online;
+}
+
+/* Idle loop of the application processors: run whatever smp_call hands us, otherwise halt */
+static void smp_ap_loop(struct smp_cpu *cpu)
+{
+	smp_fn_t fn;
+
+	while (1) {
+		disable_interrupts();
+		fn = atomic_load(&cpu->fn);
+		if (!fn || fn == SMP_FN_CLAIMED) {
+			/* sti;hlt, so an ipi sent after the check still wakes us */
+			cpu_wait_for_interrupt();
+			continue;
+		}
+		enable_interrupts();
+
+		fn(cpu->arg);
+		atomic_store(&cpu->fn, 0);
+	}
+}
+
+/* First C code an application processor runs, on the stack smp_boot_cpu gave it */
+static void smp_ap_main()
+{
+	int index = atomic_load(&booting_cpu);
+	struct smp_cpu *cpu = &cpus[index];
+
+	gdt_load_cpu(index);
+	idt_init_ap();
+	syscall_init_cpu();
+	lapic_init_cpu();
+
+	if (timer_clock_event() == &lapic_clock_event)
+		lapic_clock_event.set_periodic(TIMER_HZ);
+
+	atomic_store(&cpu->online, true);
+	smp_ap_loop(cpu);
+}
+
+/* Free what smp_boot_cpu allocated for an AP that didn't come up */
+static void smp_free_cpu(int index)
+{
+	struct smp_cpu *cpu = &cpus[index];
+
+	irq_stack_free(index);
+	gdt_free_cpu(index);
+	percpu_free(index);
+	if (cpu->stack) {
+		kfree(cpu->stack);
+		cpu->stack = 0;
+	}
+}
+
+/* Everything an AP needs is allocated here, on the boot cpu, so it never touches the heap itself.
+ * If it fails, nothing is left allocated and the AP is held in reset
+ */
+static int smp_boot_cpu(int index)
+{
+	struct smp_cpu *cpu = &cpus[index];
+	uint64_t deadline;
+	int res;
+
+	cpu->stack = kmalloc(THREAD_STACK_SIZE);
+	if (!cpu->stack || !percpu_init(index)) {
+		smp_free_cpu(index);
+		return -ENOMEM;
+	}
+
+	res = gdt_init_cpu(index);
+	if (res < 0) {
+		smp_free_cpu(index);
+		return res;
+	}
+	irq_stack_init(index);
+
+	atomic_store(&booting_cpu, index);
+	*trampoline_var(&trampoline_stack) = (uint32_t)cpu->stack + THREAD_STACK_SIZE;
+	smp_mb();
+
+	lapic_send_init(cpu->apic_id);
+	udelay(SMP_INIT_DELAY_US);
+	lapic_send_startup(cpu->apic_id, SMP_TRAMPOLINE_ADDR);
+	udelay(SMP_SIPI_DELAY_US);
+	if (!atomic_load(&cpu->online))
+		lapic_send_startup(cpu->apic_id, SMP_TRAMPOLINE_ADDR);
+
+	deadline = ktime_ns() + (uint64_t)SMP_BOOT_TIMEOUT_US * NSEC_PER_USEC;
+	while (!atomic_load(&cpu->online)) {
+		if (ktime_ns() > deadline) {
+			/* INIT parks it waiting for a startup ipi, so it can't turn up later on a stack
+			 * and gdt that are gone, or that belong to another cpu by then
+			 */
+			lapic_send_init(cpu->apic_id);
+			udelay(SMP_INIT_DELAY_US);
+			smp_free_cpu(index);
+			return -EIO;
+		}
+		cpu_relax();
+	}
+	return 0;
+}
+
+int smp_init()
+{
+	uint32_t self;
+	int count = acpi_cpu_count();
+
+	if (!apic_enabled() || count < 2)
+		return cpus_online;
+
+	self = lapic_id();
+	cpus[0].apic_id = self;
+	cpus[0].online = true;
+
+	for (uint8_t *src = trampoline_start, *dst = (uint8_t *)SMP_TRAMPOLINE_ADDR; src < trampoline_end; src++, dst++) {
+		*dst = *src;
+	}
+	*trampoline_var(&trampoline_cr3) = (uint32_t)paging_current_pgd();
+	*trampoline_var(&trampoline_entry) = (uint32_t)smp_ap_main;
+
+	for (int i = 0; i < count && cpus_online < CONFIG_MAX_CPUS; i++) {
+		int index = cpus_online;
+		uint8_t apic_id = acpi_cpu_apic_id(i);
+		if (apic_id == self)
+			continue;
+
+		cpus[index].apic_id = apic_id;
+
+		/* Stop at the first one that fails rather than hand its slot to the next */
+		if (smp_boot_cpu(index) < 0) {
+			print("SMP: cpu with apic id ");
+			print_dec(apic_id);
+			print(" didn't start, not starting any more\n");
+			break;
+		}
+		cpus_online++;
+	}
+
+	print("SMP: ");
+	print_dec(cpus_online);
+	print(" cpus online\n");
+	return cpus_online;
+}
+
+int smp_call(int cpu, smp_fn_t fn, void *arg)
+{
+	smp_fn_t idle = 0;
+
+	if (cpu <= 0 || cpu >= cpus_online)
+		return -EINVARG;
+
+	/* Callers on several cpus can race for the slot, only one claims it */
+	if (!atomic_cmpxchg(&cpus[cpu].fn, &idle, SMP_FN_CLAIMED))
+		return -EBUSY;
+
+	/* Storing fn publishes arg, the AP reads fn first */
+	cpus[cpu].arg = arg;
+	atomic_store(&cpus[cpu].fn, fn);
+
+	lapic_send_ipi(cpus[cpu].apic_id, IPI_WAKEUP_VECTOR);
+	return 0;
+}
+
+void smp_wait(int cpu)
+{
+	while (atomic_load(&cpus[cpu].fn)) {
+		cpu_relax();
+	}
+}
+
+uint32_t smp_cpu_ticks(int cpu)
+{
+	struct percpu *area = percpu_area(cpu);
+	return area ? atomic_load(&area->ticks) : 0;
+}
+
+void smp_ap_tick()
+{
+	this_cpu_write(ticks, this_cpu_read(ticks) + 1);
+}
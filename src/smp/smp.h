@@ -0,0 +1,57 @@
+/* smp.h
+ * bringing up the application processors
+ *
+ * The boot cpu finds the other processors in the ACPI MADT and starts each with an
+ * INIT-SIPI-SIPI sequence.  They begin in real mode at SMP_TRAMPOLINE_ADDR, switch to protected
+ * mode with paging, load their own gdt, tss and interrupt stack, start their local apic timer
+ * and wait in a halt loop for work handed to them with smp_call.
+ *
+ * Kernel threads and the timer wheel still only run on the boot cpu (cpu 0).
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+
+/* Where the real mode trampoline is copied to.  Page aligned, below 1 MiB and clear of the heap
+ * table at KERNEL_HEAP_TABLE_ADDR.  Keep in sync with trampoline.asm
+ */
+#define SMP_TRAMPOLINE_ADDR	0x10000
+
+typedef void (*smp_fn_t)(void *arg);
+
+/*
+ * smp_init - start every processor the MADT lists
+ *
+ * Returns the number of cpus online, including the boot cpu.  Without an apic or ACPI tables
+ * that is just the boot cpu.
+ *
+ * prereq - called acpi_init(), irq_controller_init(), idt_init() and timer_init()
+ */
+int smp_init();
+
+/* Number of cpus online */
+int smp_cpu_count();
+
+/* Index of the calling cpu, 0 for the boot cpu up to smp_cpu_count() - 1.  One gs relative load */
+int smp_processor_id();
+
+/*
+ * smp_call - have cpu run fn(arg) from its idle loop
+ *
+ * Returns right away.  -EINVARG if cpu isn't an online application processor, -EBUSY if it is
+ * still running the previous call or another caller got it first.  Safe from any cpu
+ */
+int smp_call(int cpu, smp_fn_t fn, void *arg);
+
+/* Spin until cpu has finished the last function smp_call gave it */
+void smp_wait(int cpu);
+
+/* Timer ticks cpu has taken since it came online */
+uint32_t smp_cpu_ticks(int cpu);
+
+/* Account a timer tick on an application processor.  Called from the timer interrupt */
+void smp_ap_tick();
+
+#endif /* SMP_H */
@@ -0,0 +1,79 @@
+; Real mode entry point for the application processors.
+;
+; This code is copied to TRAMPOLINE_ADDR and a startup ipi starts the processor there, with
+; cs = TRAMPOLINE_ADDR >> 4 and ip = 0.  It can't use absolute addresses of its own labels, they
+; are all computed relative to trampoline_start.  smp.c fills in the data at the end before
+; starting each processor.
+
+section .asm
+
+TRAMPOLINE_ADDR equ 0x10000		; SMP_TRAMPOLINE_ADDR in smp.h
+CODE_SEG equ 0x08
+DATA_SEG equ 0x10
+
+%define TRAMPOLINE_REL(label) ((label) - trampoline_start)
+%define TRAMPOLINE_ABS(label) (TRAMPOLINE_ADDR + TRAMPOLINE_REL(label))
+
+global trampoline_start
+global trampoline_end
+global trampoline_cr3
+global trampoline_stack
+global trampoline_entry
+
+[BITS 16]
+trampoline_start:
+	cli
+	cld
+	mov ax, cs			; data is addressed relative to the trampoline, like the code
+	mov ds, ax
+
+	o32 lgdt [TRAMPOLINE_REL(trampoline_gdtr)]
+
+	mov eax, cr0
+	or eax, 0x1			; set PE (Protection Enable)
+	mov cr0, eax
+
+	jmp dword CODE_SEG:TRAMPOLINE_ABS(trampoline_protected)
+
+[BITS 32]
+trampoline_protected:
+	mov ax, DATA_SEG
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+
+	mov eax, [TRAMPOLINE_ABS(trampoline_cr3)]	; the boot cpu's page directory, which identity maps us
+	mov cr3, eax
+	mov eax, cr0
+	or eax, 0x80000000		; set the paging bit
+	mov cr0, eax
+
+	mov esp, [TRAMPOLINE_ABS(trampoline_stack)]
+	mov eax, [TRAMPOLINE_ABS(trampoline_entry)]
+	call eax			; smp_ap_main, never returns
+.halt:
+	cli
+	hlt
+	jmp .halt
+
+align 8
+trampoline_gdt:				; just enough of a gdt to get to the kernel, which loads the cpu's own
+	dq 0
+	dw 0xffff, 0x0000		; code: base 0, limit 4 GiB, ring 0, 32 bit
+	db 0x00, 0x9a, 0xcf, 0x00
+	dw 0xffff, 0x0000		; data: base 0, limit 4 GiB, ring 0, writable
+	db 0x00, 0x92, 0xcf, 0x00
+trampoline_gdtr:
+	dw trampoline_gdtr - trampoline_gdt - 1
+	dd TRAMPOLINE_ABS(trampoline_gdt)
+
+align 4
+trampoline_cr3:
+	dd 0
+trampoline_stack:
+	dd 0
+trampoline_entry:
+	dd 0
+trampoline_end:
@@ -0,0 +1,99 @@
+#include "softirq.h"
+#include "idt/idt.h"
+#include "lib/atomic.h"
+#include "task/sched.h"
+#include "smp/percpu.h"
+#include "config.h"
+
+/*
+ * Raised work is pushed onto a lock free stack: producers (interrupt handlers, possibly
+ * nesting on top of each other) cmpxchg themselves onto head, and the single consumer takes
+ * the whole stack at once with an xchg.  Nothing ever blocks or disables interrupts to queue.
+ */
+static struct softirq_queue *this_queue()
+{
+	return &this_cpu()->softirq;
+}
+
+void softirq_work_init(struct softirq_work *work, softirq_fn_t fn, void *data)
+{
+	work->next = 0;
+	work->fn = fn;
+	work->data = data;
+	work->pending = 0;
+}
+
+bool softirq_raise(struct softirq_work *work)
+{
+	struct softirq_queue *queue = this_queue();
+	struct softirq_work *head;
+	uint32_t idle = 0;
+
+	if (!atomic_cmpxchg(&work->pending, &idle, 1))
+		return false;
+
+	head = atomic_load(&queue->head);
+	do {
+		work->next = head;
+	} while (!atomic_cmpxchg(&queue->head, &head, work));
+
+	return true;
+}
+
+bool softirq_pending()
+{
+	return atomic_load(&this_queue()->head) != 0;
+}
+
+/* The stack hands us work newest first, flip it so work runs in the order it was raised */
+static struct softirq_work *softirq_reverse(struct softirq_work *work)
+{
+	struct softirq_work *prev = 0;
+
+	while (work) {
+		struct softirq_work *next = work->next;
+		work->next = prev;
+		prev = work;
+		work = next;
+	}
+
+	return prev;
+}
+
+void softirq_run()
+{
+	struct softirq_queue *queue = this_queue();
+	struct softirq_work *work;
+	uint32_t flags;
+
+	do {
+		flags = interrupts_save_disable();
+		if (queue->running) {
+			interrupts_restore(flags);
+			return;
+		}
+		queue->running = true;
+		interrupts_restore(flags);
+
+		/* While we hold running nobody else can run softirqs, so don't get switched out */
+		preempt_disable();
+
+		while ((work = atomic_xchg(&queue->head, 0))) {
+			work = softirq_reverse(work);
+			while (work) {
+				struct softirq_work *next = work->next;
+
+				/* Clear pending first, so the work may be raised again while it runs */
+				atomic_store(&work->pending, 0);
+				work->fn(work->data);
+				work = next;
+			}
+		}
+
+		/* Work raised after our last xchg but before running is cleared saw us as running
+		 * and left it to us, so look again
+		 */
+		atomic_store(&queue->running, false);
+		preempt_enable();
+	} while (softirq_pending());
+}
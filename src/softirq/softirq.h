@@ -0,0 +1,52 @@
+/* softirq.h
+ * deferred interrupt work (bottom halves)
+ *
+ * An interrupt handler should only acknowledge its device and grab whatever data it must,
+ * then hand the slow part to softirq_raise.  Raised work runs with interrupts enabled on the
+ * way out of the outermost interrupt, or from the idle loop.
+ */
+
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*softirq_fn_t)(void *data);
+
+struct softirq_work {
+	struct softirq_work *next;
+	softirq_fn_t fn;
+	void *data;
+	uint32_t pending;		// set while queued, so raising it again is a no-op
+};
+
+/* Each cpu's queue of raised work, lives in its struct percpu */
+struct softirq_queue {
+	struct softirq_work *head;
+	bool running;
+};
+
+/* Prepare work to call fn(data) */
+void softirq_work_init(struct softirq_work *work, softirq_fn_t fn, void *data);
+
+/*
+ * softirq_raise - queue work on this cpu
+ *
+ * Lock free and safe from any context, including nested interrupts.  Returns false if work
+ * was already queued and hasn't started running yet
+ */
+bool softirq_raise(struct softirq_work *work);
+
+/* Returns true if this cpu has queued work */
+bool softirq_pending();
+
+/*
+ * softirq_run - run this cpu's queued work, in the order it was raised
+ *
+ * Work runs with the caller's interrupt state, which should be enabled.  Does nothing if
+ * this cpu is already running its softirqs further down the stack
+ */
+void softirq_run();
+
+#endif /* SOFTIRQ_H */
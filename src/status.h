@@ -5,6 +5,10 @@
 #define EIO		1
 #define EINVARG		2
 #define ENOMEM		3
+#define EBUSY		4
+#define ENODEV		5
+#define ENOSYS		6
+#define EAGAIN		7
 
 #define FALSE		0
 #define TRUE		1
@@ -0,0 +1,85 @@
+section .asm
+
+KERNEL_DATA_SEG equ 0x10
+PERCPU_SEG equ 0x38			; GDT_PERCPU in gdt.h
+USER_CODE_SEG equ 0x1B			; USER_CODE_SELECTOR in config.h
+USER_DATA_SEG equ 0x23			; USER_DATA_SELECTOR in config.h
+SYSCALL_VECTOR equ 0x80			; in syscall.h
+EFLAGS_IF equ 0x200
+
+extern syscall_handler
+extern process_return_to_user
+
+global syscall_int_entry
+global syscall_sysenter_entry
+
+; Both entry paths lay out a struct interrupt_frame, the same as int_common_entry, so the C side
+; doesn't care which one was used.  Unlike int_common_entry they don't count as being in an
+; interrupt and run the system call with interrupts enabled, so it can block and be preempted.
+
+; Save the registers and switch to the kernel's segments, once the cpu part of the frame is pushed
+%macro syscall_save 0
+	push dword 0			; error code
+	push dword SYSCALL_VECTOR	; vector
+	push ds
+	push es
+	push fs
+	push gs
+	pushad
+
+	mov ax, KERNEL_DATA_SEG
+	mov ds, ax
+	mov es, ax
+	mov ax, PERCPU_SEG
+	mov gs, ax
+	cld
+
+	mov ebx, esp			; struct interrupt_frame *, callee saved
+%endmacro
+
+; Run the system call, then check for a kill on the way out.  Leaves interrupts disabled
+%macro syscall_call 0
+	sti
+	push ebx
+	call syscall_handler
+	cli
+	call process_return_to_user	; same argument, still on the stack
+	add esp, 4
+
+	popad
+	pop gs
+	pop fs
+	pop es
+	pop ds
+	add esp, 8			; vector and error code
+%endmacro
+
+; int 0x80 through a ring 3 interrupt gate.  The cpu has switched to the tss esp0 stack and
+; pushed ss, esp, eflags, cs and eip
+syscall_int_entry:
+	syscall_save
+	syscall_call
+	iret
+
+; sysenter.  The cpu loaded cs, ss, eip and esp from the msrs and pushed nothing.  esp is the
+; address of the tss esp0 field, the user's esp is in ecx and its return address in edx
+syscall_sysenter_entry:
+	mov esp, [esp]			; this thread's kernel stack
+
+	; Fake the frame an int from ring 3 would have pushed.  sysenter cleared IF, the user had it set
+	push dword USER_DATA_SEG	; ss
+	push ecx			; esp
+	pushfd
+	or dword [esp], EFLAGS_IF
+	push dword USER_CODE_SEG	; cs
+	push edx			; eip
+
+	syscall_save
+	syscall_call
+
+	; sysexit resumes at edx with esp = ecx, still in user segments since ds/es/fs/gs were popped.
+	; sti only takes effect after the next instruction, so no interrupt can land in between
+	mov edx, [esp]			; eip, may have been changed by the system call
+	mov ecx, [esp+12]		; user esp
+	sti
+	sysexit
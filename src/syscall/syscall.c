@@ -0,0 +1,183 @@
+#include "syscall.h"
+#include "idt/idt.h"
+#include "cpu/cpu.h"
+#include "gdt/gdt.h"
+#include "task/process.h"
+#include "ioring/ioring.h"
+#include "ipc/ipc.h"
+#include "pipe/pipe.h"
+#include "futex/futex.h"
+#include "print/print.h"
+#include "status.h"
+
+extern void syscall_int_entry();
+extern void syscall_sysenter_entry();
+
+static bool sysenter_supported = false;
+
+static int sys_null(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return 0;
+}
+
+static int sys_exit(uint32_t code, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	process_exit((int)code);
+	return 0;
+}
+
+static int sys_ioring_setup(uint32_t entries, uint32_t flags, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return ioring_setup(entries, flags);
+}
+
+static int sys_ioring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return ioring_enter(to_submit, min_complete, flags);
+}
+
+static void ipc_message_from_frame(struct ipc_message *msg, struct interrupt_frame *frame)
+{
+	msg->flags = frame->ebx & (IPC_GRANT | IPC_SHARE);
+	msg->words[0] = frame->esi;
+	msg->words[1] = frame->edi;
+	msg->words[2] = frame->ebp;
+}
+
+static void ipc_message_to_frame(struct ipc_message *msg, struct interrupt_frame *frame)
+{
+	frame->ebx = msg->from | msg->flags;
+	frame->esi = msg->words[0];
+	frame->edi = msg->words[1];
+	frame->ebp = msg->words[2];
+}
+
+static int sys_ipc_call(uint32_t server, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	struct ipc_message msg;
+	int res;
+
+	ipc_message_from_frame(&msg, frame);
+	res = ipc_call(server & IPC_ID_MASK, &msg);
+	if (res == 0)
+		ipc_message_to_frame(&msg, frame);
+
+	return res;
+}
+
+static int sys_ipc_reply_wait(uint32_t client, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	struct ipc_message msg;
+	int res;
+
+	ipc_message_from_frame(&msg, frame);
+	res = ipc_reply_wait(client & IPC_ID_MASK, &msg);
+	if (res == 0)
+		ipc_message_to_frame(&msg, frame);
+
+	return res;
+}
+
+static int sys_ipc_window(uint32_t address, uint32_t pages, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return ipc_set_window(address, pages);
+}
+
+static int sys_pipe_create(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return pipe_create();
+}
+
+static int sys_pipe_open(uint32_t id, uint32_t end, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return pipe_open(id, end);
+}
+
+static int sys_pipe_read(uint32_t id, uint32_t buf, uint32_t len, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return pipe_read(id, buf, len);
+}
+
+static int sys_pipe_write(uint32_t id, uint32_t buf, uint32_t len, uint32_t flags, struct interrupt_frame *frame)
+{
+	return pipe_write(id, buf, len, flags);
+}
+
+static int sys_pipe_close(uint32_t id, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame)
+{
+	return pipe_close(id);
+}
+
+static int sys_futex(uint32_t addr, uint32_t op, uint32_t val, uint32_t arg4, struct interrupt_frame *frame)
+{
+	switch (op) {
+	case FUTEX_WAIT:
+		return futex_wait(addr, val);
+	case FUTEX_WAKE:
+		return futex_wake(addr, val);
+	default:
+		return -EINVARG;
+	}
+}
+
+static const syscall_fn_t syscall_table[SYSCALL_COUNT] = {
+	[SYS_NULL] = sys_null,
+	[SYS_EXIT] = sys_exit,
+	[SYS_IORING_SETUP] = sys_ioring_setup,
+	[SYS_IORING_ENTER] = sys_ioring_enter,
+	[SYS_IPC_CALL] = sys_ipc_call,
+	[SYS_IPC_REPLY_WAIT] = sys_ipc_reply_wait,
+	[SYS_IPC_WINDOW] = sys_ipc_window,
+	[SYS_PIPE_CREATE] = sys_pipe_create,
+	[SYS_PIPE_OPEN] = sys_pipe_open,
+	[SYS_PIPE_READ] = sys_pipe_read,
+	[SYS_PIPE_WRITE] = sys_pipe_write,
+	[SYS_PIPE_CLOSE] = sys_pipe_close,
+	[SYS_FUTEX] = sys_futex,
+};
+
+void syscall_handler(struct interrupt_frame *frame)
+{
+	uint32_t nr = frame->eax;
+
+	if (nr >= SYSCALL_COUNT || !syscall_table[nr]) {
+		frame->eax = -ENOSYS;
+		return;
+	}
+
+	frame->eax = syscall_table[nr](frame->ebx, frame->esi, frame->edi, frame->ebp, frame);
+}
+
+void syscall_init_cpu()
+{
+	if (!sysenter_supported)
+		return;
+
+	/* sysenter loads esp with the address of this cpu's tss esp0 field, and the entry code's
+	 * first instruction loads the current thread's kernel stack from there
+	 */
+	write_msr(MSR_IA32_SYSENTER_CS, GDT_SELECTOR(GDT_KERNEL_CODE, 0));
+	write_msr(MSR_IA32_SYSENTER_ESP, (uint32_t)&gdt_tss()->esp0);
+	write_msr(MSR_IA32_SYSENTER_EIP, (uint32_t)syscall_sysenter_entry);
+}
+
+void syscall_init()
+{
+	struct cpuid_regs regs;
+
+	idt_set_user(SYSCALL_VECTOR, syscall_int_entry);
+
+	cpuid_read(CPUID_FEATURES, &regs);
+	sysenter_supported = (regs.edx & CPUID_FEAT_EDX_SEP) && (regs.edx & CPUID_FEAT_EDX_MSR);
+	syscall_init_cpu();
+
+	print("System calls: int 0x80");
+	if (sysenter_supported)
+		print(", sysenter");
+	print("\n");
+}
+
+bool syscall_sysenter_supported()
+{
+	return sysenter_supported;
+}
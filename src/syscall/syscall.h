@@ -0,0 +1,71 @@
+/* syscall.h
+ * system calls
+ *
+ * User mode enters the kernel one of two ways, with the same register convention:
+ *  - int SYSCALL_VECTOR, which works on every cpu
+ *  - sysenter, when cpuid advertises it.  Much cheaper: no gate or tss lookup on the way in
+ *    and no iret on the way out.  The caller must also put its esp in ecx and the address to
+ *    resume at in edx, since sysenter doesn't save them
+ *
+ * eax holds the system call number and ebx, esi, edi and ebp the arguments.  The result comes
+ * back in eax, negative status.h codes for errors (-ENOSYS for an unknown number).  Through
+ * sysenter, ecx and edx are clobbered (sysexit reloads them with the return esp and eip).  Through
+ * int SYSCALL_VECTOR every register but eax is preserved.
+ */
+
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt/irq.h"
+
+#define SYSCALL_VECTOR		0x80
+
+#define SYS_NULL		0		// does nothing, for measuring the entry and exit cost
+#define SYS_EXIT		1		// exit(code)
+#define SYS_IORING_SETUP	2		// io_ring_setup(entries, flags), see ioring.h
+#define SYS_IORING_ENTER	3		// io_ring_enter(to_submit, min_complete, flags)
+#define SYS_IPC_CALL		4		// ipc_call, see below
+#define SYS_IPC_REPLY_WAIT	5		// ipc_reply_wait, see below
+#define SYS_IPC_WINDOW		6		// ipc_set_window(address, pages)
+#define SYS_PIPE_CREATE		7		// pipe_create(), see pipe.h
+#define SYS_PIPE_OPEN		8		// pipe_open(id, end)
+#define SYS_PIPE_READ		9		// pipe_read(id, buf, len)
+#define SYS_PIPE_WRITE		10		// pipe_write(id, buf, len, flags)
+#define SYS_PIPE_CLOSE		11		// pipe_close(id)
+#define SYS_FUTEX		12		// futex(addr, op, val): FUTEX_WAIT or FUTEX_WAKE val threads, see futex.h
+#define SYSCALL_COUNT		13
+
+/*
+ * The ipc calls (ipc.h) pass the message in registers both ways.  ebx holds the other process's
+ * id, or'ed with IPC_GRANT or IPC_SHARE when the message moves or shares pages, and esi, edi and
+ * ebp the message words.
+ *  - SYS_IPC_CALL: ebx is the server.  On return ebx, esi, edi and ebp hold the reply
+ *  - SYS_IPC_REPLY_WAIT: ebx is the client to reply to, or 0.  On return ebx is the caller and
+ *    esi, edi and ebp its message
+ * Unlike other system calls these overwrite ebx, esi, edi and ebp, on success only
+ */
+
+/* frame is for the few system calls that hand back more than eax */
+typedef int (*syscall_fn_t)(uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, struct interrupt_frame *frame);
+
+/*
+ * syscall_init - install the int SYSCALL_VECTOR gate and, if the cpu has it, set up sysenter
+ *
+ * prereq - called idt_init()
+ */
+void syscall_init();
+
+/* Point the calling application processor's sysenter msrs at the kernel */
+void syscall_init_cpu();
+
+/* True if user mode can use sysenter */
+bool syscall_sysenter_supported();
+
+/* Run the system call described by frame's registers and put its result in frame->eax.  Called
+ * by both entry paths, with interrupts enabled
+ */
+void syscall_handler(struct interrupt_frame *frame);
+
+#endif /* SYSCALL_H */
@@ -0,0 +1,32 @@
+#include "mutex.h"
+#include "lib/atomic.h"
+
+void mutex_init(struct mutex *mutex)
+{
+	mutex->locked = 0;
+	mutex->owner = 0;
+	wait_queue_init(&mutex->waiters);
+}
+
+bool mutex_trylock(struct mutex *mutex)
+{
+	if (atomic_xchg(&mutex->locked, 1))
+		return false;
+
+	mutex->owner = thread_current();
+	return true;
+}
+
+void mutex_lock(struct mutex *mutex)
+{
+	wait_event(&mutex->waiters, mutex_trylock(mutex));
+}
+
+void mutex_unlock(struct mutex *mutex)
+{
+	mutex->owner = 0;
+	atomic_store(&mutex->locked, 0);
+
+	/* Unconditionally: a check of the queue without its lock could miss a waiter going to sleep */
+	wake_up_one(&mutex->waiters);
+}
@@ -0,0 +1,33 @@
+/* mutex.h
+ * sleeping locks
+ *
+ * Unlike a spinlock, a thread that finds a mutex taken sleeps on its wait queue, so the holder
+ * may block (e.g. on the disk) while it holds it.  Not for interrupt handlers.
+ */
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wait.h"
+#include "thread.h"
+
+struct mutex {
+	uint32_t locked;
+	struct thread *owner;		// for debugging, 0 when taken from outside a thread
+	struct wait_queue waiters;
+};
+
+void mutex_init(struct mutex *mutex);
+
+/* Take mutex, sleeping until it's free */
+void mutex_lock(struct mutex *mutex);
+
+/* Take mutex if it's free right now.  Returns false if it isn't */
+bool mutex_trylock(struct mutex *mutex);
+
+/* Release mutex and wake the longest waiting thread, if there is one */
+void mutex_unlock(struct mutex *mutex);
+
+#endif /* MUTEX_H */
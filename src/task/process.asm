@@ -0,0 +1,37 @@
+section .asm
+
+USER_CODE_SEG equ 0x1B			; USER_CODE_SELECTOR in config.h
+USER_DATA_SEG equ 0x23			; USER_DATA_SELECTOR in config.h
+EFLAGS_USER equ 0x202			; interrupts on, iopl 0 so ring 3 gets no port access
+
+global process_enter_user
+
+; void process_enter_user(uint32_t eip, uint32_t esp)
+;
+; Build the frame an interrupt from ring 3 would have pushed and iret through it.  The cpu sees
+; the rpl 3 code selector, switches to ring 3 and loads ss:esp from the frame as well.  No
+; registers leak kernel values into user mode.
+process_enter_user:
+	mov ecx, [esp+4]		; eip
+	mov edx, [esp+8]		; esp
+
+	mov ax, USER_DATA_SEG		; gs stops pointing at the per cpu area here, no more C from now on
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+
+	push dword USER_DATA_SEG	; ss
+	push edx			; esp
+	push dword EFLAGS_USER
+	push dword USER_CODE_SEG	; cs
+	push ecx			; eip
+
+	xor eax, eax
+	xor ebx, ebx
+	xor ecx, ecx
+	xor edx, edx
+	xor esi, esi
+	xor edi, edi
+	xor ebp, ebp
+	iret
@@ -0,0 +1,271 @@
+#include "process.h"
+#include "sched.h"
+#include "wait.h"
+#include "memory/vm/vm.h"
+#include "ioring/ioring.h"
+#include "pipe/pipe.h"
+#include "vdso/vdso.h"
+#include "gdt/gdt.h"
+#include "idt/idt.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "print/print.h"
+#include "kernel.h"
+#include "config.h"
+#include "status.h"
+
+static struct paging_desc *kernel_paging = 0;
+static uint32_t next_pid = 1;
+static struct list_head processes;		// launched and not exited yet
+static struct list_head zombies;		// exited processes nobody has waited for yet
+static struct wait_queue exit_wait;
+
+void process_init(struct paging_desc *paging)
+{
+	kernel_paging = paging;
+	list_init(&processes);
+	list_init(&zombies);
+	wait_queue_init(&exit_wait);
+}
+
+struct process *process_find(uint32_t id)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &processes) {
+		struct process *process = list_entry(pos, struct process, state_entry);
+		if (process->id == id)
+			return process;
+	}
+
+	return 0;
+}
+
+struct process *process_current()
+{
+	struct thread *self = thread_current();
+	return self ? self->process : 0;
+}
+
+/* Back pages [start, start + size) of the user range with fresh zeroed frames, copying data
+ * (len bytes of it, may be 0) to the start
+ */
+static int process_map_range(struct process *process, uint32_t start, uint32_t size, const void *data, uint32_t len)
+{
+	for (uint32_t offset = 0; offset < size; offset += PAGING_PAGE_SIZE) {
+		uint8_t *frame = kzalloc(PAGING_PAGE_SIZE);
+		int res;
+
+		if (!frame)
+			return -ENOMEM;
+
+		/* Frames are identity mapped in the kernel half, so this is also where we fill it */
+		if (offset < len)
+			memcpy(frame, (const uint8_t *)data + offset, len - offset < PAGING_PAGE_SIZE ? len - offset : PAGING_PAGE_SIZE);
+
+		res = paging_map_user(process->paging, (void *)(start + offset), frame, PAGING_READ_WRITE);
+		if (res < 0) {
+			kfree(frame);
+			return res;
+		}
+	}
+
+	return 0;
+}
+
+static uint32_t kernel_stack_top(struct thread *thread)
+{
+	return (uint32_t)thread->stack + THREAD_STACK_SIZE;
+}
+
+/* First thing the process's thread runs, still in ring 0 */
+static void process_start(void *arg)
+{
+	struct process *process = arg;
+	struct thread *self = thread_current();
+	uint32_t flags = interrupts_save_disable();
+
+	self->process = process;
+	process->thread = self;
+	process_switch(self);
+
+	interrupts_restore(flags);
+	process_enter_user(process->entry, process->user_stack);
+}
+
+struct process *process_alloc(const char *name)
+{
+	struct process *process;
+	uint32_t flags;
+
+	if (!kernel_paging)
+		return 0;
+
+	process = kzalloc(sizeof(struct process));
+	if (!process)
+		return 0;
+
+	process->paging = paging_new_process(kernel_paging);
+	if (!process->paging) {
+		kfree(process);
+		return 0;
+	}
+
+	flags = interrupts_save_disable();
+	process->id = next_pid++;
+	interrupts_restore(flags);
+
+	process->name = name;
+	list_init(&process->vm_areas);
+	ipc_endpoint_init(&process->ipc);
+
+	if (vdso_map(process) < 0) {
+		process_free(process);
+		return 0;
+	}
+
+	return process;
+}
+
+void process_free(struct process *process)
+{
+	vm_area_free_all(process);
+	paging_free_process(process->paging);
+	kfree(process);
+}
+
+int process_launch(struct process *process, int priority)
+{
+	int id = process->id;
+	uint32_t flags;
+
+	/* The process belongs to its thread from here on, and may be gone by the time this returns */
+	flags = interrupts_save_disable();
+	list_add_tail(&process->state_entry, &processes);
+	if (!thread_create(process->name, priority, process_start, process)) {
+		list_del(&process->state_entry);
+		interrupts_restore(flags);
+		process_free(process);
+		return -ENOMEM;
+	}
+
+	interrupts_restore(flags);
+	return id;
+}
+
+int process_create(const char *name, const void *image, uint32_t size, int priority)
+{
+	struct process *process;
+	uint32_t image_size = (size + PAGING_PAGE_SIZE - 1) & ~(PAGING_PAGE_SIZE - 1);
+	uint32_t stack_bottom = PROCESS_USER_END - PROCESS_STACK_SIZE;
+
+	if (image_size > VDSO_ADDRESS - PROCESS_USER_START)
+		return -EINVARG;
+
+	process = process_alloc(name);
+	if (!process)
+		return -ENOMEM;
+
+	if (process_map_range(process, PROCESS_USER_START, image_size, image, size) < 0 ||
+	    process_map_range(process, stack_bottom, PROCESS_STACK_SIZE, 0, 0) < 0) {
+		process_free(process);
+		return -ENOMEM;
+	}
+
+	process->entry = PROCESS_USER_START;
+	process->user_stack = PROCESS_USER_END;
+	return process_launch(process, priority);
+}
+
+void process_exit(int code)
+{
+	struct thread *self = thread_current();
+	struct process *process = self->process;
+
+	if (!process)
+		panic("process_exit from a kernel thread");
+
+	/* Off the process's page directory before freeing it, and out of reach of ipc */
+	disable_interrupts();
+	list_del(&process->state_entry);
+	ipc_exit(process);
+	paging_switch(get_pgd(kernel_paging));
+	self->process = 0;
+	enable_interrupts();
+
+	process->exit_code = code;
+	ioring_destroy(process);
+	pipe_exit(process);
+	vm_area_free_all(process);
+	paging_free_process(process->paging);
+
+	if (process->killed) {
+		print("Process ");
+		print_dec(process->id);
+		print(" (");
+		print(process->name);
+		print(") killed\n");
+	}
+
+	disable_interrupts();
+	list_add_tail(&process->state_entry, &zombies);
+	wake_up_all(&exit_wait);
+	thread_exit();
+}
+
+/* Take process id off the zombie list.  Interrupts are disabled */
+static struct process *process_reap(int id)
+{
+	struct list_head *pos;
+
+	list_for_each(pos, &zombies) {
+		struct process *process = list_entry(pos, struct process, state_entry);
+		if (process->id == id) {
+			list_del(&process->state_entry);
+			return process;
+		}
+	}
+
+	return 0;
+}
+
+void process_wait(int id, int *code_out)
+{
+	struct process *process;
+
+	wait_event(&exit_wait, (process = process_reap(id)) != 0);
+
+	*code_out = process->exit_code;
+	kfree(process);
+}
+
+void process_kill(struct process *process)
+{
+	process->killed = true;
+
+	/* Sleeps that check killed (futex_wait) give up, the others check their condition and sleep on */
+	if (process->thread)
+		thread_wake(process->thread);
+}
+
+void process_switch(struct thread *next)
+{
+	struct process *process = next->process;
+
+	if (!process)
+		return;
+
+	gdt_set_kernel_stack(kernel_stack_top(next));
+	if (paging_current_pgd() != get_pgd(process->paging))
+		paging_switch(get_pgd(process->paging));
+}
+
+void process_return_to_user(struct interrupt_frame *frame)
+{
+	struct process *process = process_current();
+
+	if (process && process->killed) {
+		enable_interrupts();
+		process_exit(-1);
+	}
+}
@@ -0,0 +1,103 @@
+/* process.h
+ * user processes
+ *
+ * A process is a ring 3 program with its own page directory: the kernel's mappings, which ring 3
+ * can't touch, plus private pages in [PROCESS_USER_START, PROCESS_USER_END).  It runs on a kernel
+ * thread that drops to ring 3 with an iret.  Interrupts, exceptions and system calls bring it
+ * back to ring 0 on that thread's kernel stack, which the scheduler puts in the tss as esp0.
+ */
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "thread.h"
+#include "lib/list.h"
+#include "memory/paging/paging.h"
+#include "idt/irq.h"
+#include "ipc/ipc.h"
+
+struct ioring;
+
+struct process {
+	uint32_t id;
+	const char *name;
+	struct paging_desc *paging;
+	struct thread *thread;		// 0 until the thread first runs
+	uint32_t entry;			// user address execution starts at
+	uint32_t user_stack;		// initial user esp
+	bool killed;			// exits the next time it would return to ring 3
+	int exit_code;
+	struct list_head vm_areas;	// demand paged parts of user space, see vm.h
+	struct ioring *ioring;		// 0 until io_ring_setup, see ioring.h
+	struct ipc_endpoint ipc;	// see ipc.h
+	struct list_head state_entry;	// on the list of running processes, or of zombies once it exited
+};
+
+/*
+ * process_init - remember the kernel's page tables, every process shares them
+ *
+ * prereq - paging is on
+ */
+void process_init(struct paging_desc *kernel_paging);
+
+/*
+ * process_create - start a process running a flat binary
+ *
+ * image is copied to PROCESS_USER_START, which is also where it starts executing, with a
+ * PROCESS_STACK_SIZE stack below PROCESS_USER_END.  It must end below VDSO_ADDRESS.  Returns the process id, or -ENOMEM
+ */
+int process_create(const char *name, const void *image, uint32_t size, int priority);
+
+/*
+ * process_wait - sleep until process id exits, and return its exit code in code_out
+ *
+ * An exited process keeps its struct process until it's waited for.  Only one caller may wait for
+ * each process, and only for one that exists
+ */
+void process_wait(int id, int *code_out);
+
+/*
+ * process_alloc - an empty process with its own page directory and the vdso, not running yet
+ *
+ * Set up its user space and entry and user_stack, then start it with process_launch or get rid of
+ * it with process_free.  Returns 0 if out of memory
+ */
+struct process *process_alloc(const char *name);
+
+/* Start process's thread.  Returns the process id, or -ENOMEM, in which case process is freed */
+int process_launch(struct process *process, int priority);
+
+/* Free a process that was never launched */
+void process_free(struct process *process);
+
+/* The running process with id id, or 0.  Interrupts must be disabled, it could exit otherwise */
+struct process *process_find(uint32_t id);
+
+/* The process the calling thread runs, 0 for kernel threads */
+struct process *process_current();
+
+/* Tear down the calling thread's process and exit the thread.  Never returns */
+void process_exit(int code);
+
+/* Make process exit once it next heads back to ring 3, e.g. after a fault in user mode.  Wakes
+ * its thread if it is asleep in the kernel, so waits that check killed end.  Safe from interrupts
+ */
+void process_kill(struct process *process);
+
+/*
+ * process_switch - load next's address space and kernel stack, if it's a process
+ *
+ * Called by the scheduler before switching to next, with interrupts disabled.  Kernel threads
+ * just keep whichever page directory is loaded, the kernel half is the same in all of them
+ */
+void process_switch(struct thread *next);
+
+/* Called by int_common_entry before returning to ring 3, with interrupts disabled */
+void process_return_to_user(struct interrupt_frame *frame);
+
+/* iret to ring 3 at eip with stack esp.  Never returns */
+void process_enter_user(uint32_t eip, uint32_t esp);
+
+#endif /* PROCESS_H */
@@ -0,0 +1,235 @@
+#include "sched.h"
+#include "process.h"
+#include "idt/idt.h"
+#include "idt/irq.h"
+#include "timer/timer_wheel.h"
+#include "lib/list.h"
+#include "lib/atomic.h"
+#include "smp/percpu.h"
+
+static struct sched_percpu *this_sched()
+{
+	return &this_cpu()->sched;
+}
+
+/* bsf: index of the lowest set bit, i.e. the highest priority level with a runnable thread */
+static inline int sched_first_level(uint32_t bitmap)
+{
+	return __builtin_ctz(bitmap);
+}
+
+static void rq_add(struct sched_percpu *s, struct thread *thread, bool at_head)
+{
+	struct list_head *queue = &s->rq.queues[thread->priority];
+
+	thread->state = THREAD_RUNNABLE;
+	thread->enqueued_at = s->ticks;
+
+	if (at_head) {
+		list_add(&thread->run_entry, queue);
+	} else {
+		list_add_tail(&thread->run_entry, queue);
+	}
+	s->rq.bitmap |= 1u << thread->priority;
+}
+
+static void rq_del(struct sched_percpu *s, struct thread *thread)
+{
+	list_del(&thread->run_entry);
+	if (list_empty(&s->rq.queues[thread->priority]))
+		s->rq.bitmap &= ~(1u << thread->priority);
+}
+
+static struct thread *rq_pick(struct sched_percpu *s)
+{
+	struct thread *next;
+
+	if (!s->rq.bitmap)
+		return s->idle;
+
+	next = list_first_entry(&s->rq.queues[sched_first_level(s->rq.bitmap)], struct thread, run_entry);
+	rq_del(s, next);
+	return next;
+}
+
+/* Would the highest priority runnable thread preempt the current one? */
+static bool rq_should_preempt(struct sched_percpu *s)
+{
+	if (!s->rq.bitmap)
+		return false;
+
+	return s->current == s->idle || sched_first_level(s->rq.bitmap) < s->current->priority;
+}
+
+/*
+ * Raise threads that have waited SCHED_AGING_TICKS by one level.  The whole queue is scanned: a
+ * preempted thread goes back at the head with a fresh enqueued_at, so a young thread can sit in
+ * front of old ones.  Threads already at the top of their band stay put
+ */
+static void rq_age(struct sched_percpu *s)
+{
+	for (int level = 1; level < SCHED_PRIORITIES; level++) {
+		struct list_head *queue = &s->rq.queues[level];
+		struct list_head *pos;
+		struct list_head *n;
+
+		list_for_each_safe(pos, n, queue) {
+			struct thread *thread = list_entry(pos, struct thread, run_entry);
+			if (s->ticks - thread->enqueued_at < SCHED_AGING_TICKS ||
+			    level - 1 < SCHED_BAND_TOP(thread->base_priority))
+				continue;
+
+			rq_del(s, thread);
+			thread->priority = level - 1;
+			rq_add(s, thread, false);
+		}
+	}
+}
+
+void sched_init(struct thread *idle)
+{
+	struct sched_percpu *s = this_sched();
+
+	for (int i = 0; i < SCHED_PRIORITIES; i++) {
+		list_init(&s->rq.queues[i]);
+	}
+	s->rq.bitmap = 0;
+
+	s->idle = idle;
+	s->current = idle;
+}
+
+struct thread *sched_current()
+{
+	return this_cpu_read(sched.current);
+}
+
+bool sched_runnable()
+{
+	return this_cpu_read(sched.rq.bitmap) != 0;
+}
+
+/*
+ * preempt says the current thread is being pushed off the cpu rather than giving it up, in which
+ * case it keeps its place at the front of its level
+ */
+static void __schedule(bool preempt)
+{
+	struct sched_percpu *s = this_sched();
+	struct thread *prev = s->current;
+	struct thread *next;
+
+	s->need_resched = false;
+
+	if (prev->state == THREAD_RUNNING && prev != s->idle) {
+		if (prev->slice == 0) {
+			/* Used its whole slice: cpu bound, so it drops a level and waits its turn */
+			if (prev->priority < SCHED_PRIORITY_LOWEST)
+				prev->priority++;
+			rq_add(s, prev, false);
+		} else {
+			rq_add(s, prev, preempt);
+		}
+	}
+
+	next = rq_pick(s);
+	next->state = THREAD_RUNNING;
+	if (next->slice == 0)
+		next->slice = SCHED_TIMESLICE_TICKS;
+
+	if (next == prev)
+		return;
+
+	/* The idle thread went tickless before it halted, running threads need the tick back */
+	if (prev == s->idle)
+		timer_set_tickless(false);
+
+	s->current = next;
+	process_switch(next);
+	switch_to(prev, next);
+
+	/* Back on prev, maybe much later.  Whoever switched to us isn't on its stack anymore */
+	thread_reap();
+}
+
+void schedule()
+{
+	__schedule(false);
+}
+
+void sched_handoff(struct thread *next)
+{
+	struct sched_percpu *s = this_sched();
+	struct thread *prev = s->current;
+
+	/* next inherits the cpu, and the rest of prev's slice with it */
+	next->state = THREAD_RUNNING;
+	next->slice = prev->slice ? prev->slice : SCHED_TIMESLICE_TICKS;
+
+	s->current = next;
+	process_switch(next);
+	switch_to(prev, next);
+
+	thread_reap();
+}
+
+void sched_enqueue(struct thread *thread)
+{
+	uint32_t flags = interrupts_save_disable();
+	struct sched_percpu *s = this_sched();
+
+	rq_add(s, thread, false);
+	if (rq_should_preempt(s)) {
+		s->need_resched = true;
+		if (!in_interrupt() && s->preempt_count == 0)
+			__schedule(true);
+	}
+
+	interrupts_restore(flags);
+}
+
+void sched_tick()
+{
+	struct sched_percpu *s = this_sched();
+	struct thread *current = s->current;
+
+	if (!current)
+		return;
+
+	s->ticks++;
+	if (s->ticks % SCHED_AGING_TICKS == 0)
+		rq_age(s);
+
+	if (current != s->idle && current->slice > 0 && --current->slice == 0)
+		s->need_resched = true;
+
+	if (rq_should_preempt(s))
+		s->need_resched = true;
+}
+
+void sched_preempt_irq()
+{
+	struct sched_percpu *s = this_sched();
+
+	/* Cpus that don't run threads have no current thread to preempt */
+	if (s->current && s->need_resched && s->preempt_count == 0 && !in_interrupt())
+		__schedule(true);
+}
+
+void preempt_disable()
+{
+	this_cpu()->sched.preempt_count++;
+	barrier();
+}
+
+void preempt_enable()
+{
+	struct sched_percpu *s = this_sched();
+
+	barrier();
+	if (--s->preempt_count == 0 && s->need_resched && !in_interrupt()) {
+		uint32_t flags = interrupts_save_disable();
+		__schedule(true);
+		interrupts_restore(flags);
+	}
+}
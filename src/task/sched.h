@@ -0,0 +1,104 @@
+/* sched.h
+ * preemptive priority scheduler
+ *
+ * Every priority level has its own FIFO run queue, and a bitmap of the non empty levels finds
+ * the highest runnable one with a single bsf.  Level 0 is the highest priority.
+ *
+ * The running thread is preempted when its time slice runs out or a higher priority thread
+ * becomes runnable.  Preemption happens on the way out of the outermost hardware interrupt,
+ * back on the interrupted thread's stack, or right away if a thread wakes another one up.
+ *
+ * Threads that use up their slice drop a level, so cpu bound work sinks below threads that
+ * mostly sleep, and a woken interactive thread preempts it immediately.  Threads left waiting
+ * on a run queue for SCHED_AGING_MS rise a level, so nothing starves, but never past the top of
+ * the band of SCHED_BAND_LEVELS levels their base priority is in: a long wait doesn't let a
+ * thread outrank the levels above its band.
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdbool.h>
+#include "thread.h"
+#include "lib/list.h"
+#include "config.h"
+
+#define SCHED_PRIORITIES	32		// one bit each in the run queue bitmap
+#define SCHED_PRIORITY_LOWEST	(SCHED_PRIORITIES - 1)
+#define SCHED_BAND_LEVELS	8		// levels per band, aging stays inside a band
+#define SCHED_BAND_TOP(prio)	((prio) - (prio) % SCHED_BAND_LEVELS)
+
+#define SCHED_TIMESLICE_TICKS	((SCHED_TIMESLICE_MS * TIMER_HZ + 999) / 1000)
+#define SCHED_AGING_TICKS	((SCHED_AGING_MS * TIMER_HZ + 999) / 1000)
+
+struct run_queue {
+	uint32_t bitmap;				// bit n set when queues[n] is not empty
+	struct list_head queues[SCHED_PRIORITIES];
+};
+
+/* Scheduler state of one cpu, lives in its struct percpu */
+struct sched_percpu {
+	struct thread *current;			// 0 on cpus that don't run threads
+	struct thread *idle;
+	uint32_t need_resched;
+	uint32_t preempt_count;
+	uint32_t ticks;				// ticks since sched_init, timestamps run queue waits
+	struct run_queue rq;
+};
+
+/*
+ * sched_init - start scheduling on this cpu, with idle running whenever nothing else is runnable
+ *
+ * idle is the thread running right now.  It is never put on a run queue
+ */
+void sched_init(struct thread *idle);
+
+/* The thread running on this cpu */
+struct thread *sched_current();
+
+/* Returns true if some thread other than the current one is waiting to run */
+bool sched_runnable();
+
+/*
+ * sched_enqueue - make a thread runnable
+ *
+ * Preempts the caller if thread has a higher priority, or asks the interrupt exit path to
+ * if called from an interrupt handler.  Safe from any context
+ */
+void sched_enqueue(struct thread *thread);
+
+/*
+ * schedule - switch to the highest priority runnable thread
+ *
+ * The current thread goes to the back of its level if it is still THREAD_RUNNING, otherwise it
+ * is left for whoever blocked or killed it.  Interrupts must be disabled
+ */
+void schedule();
+
+/*
+ * sched_handoff - switch straight to next, a blocked thread, without going through the run queue
+ *
+ * The current thread must already have given up the cpu (it is blocked), and next runs on what
+ * is left of its time slice.  For synchronous ipc, where the sender sleeps until the receiver
+ * answers, so the receiver is what should run next anyway.  Interrupts must be disabled
+ */
+void sched_handoff(struct thread *next);
+
+/* Account a timer tick to the current thread.  Called from the timer interrupt */
+void sched_tick();
+
+/*
+ * sched_preempt_irq - switch threads if the current one should be preempted
+ *
+ * Called by int_common_entry after the outermost hardware interrupt, once back on the
+ * interrupted thread's stack and with interrupts still disabled
+ */
+void sched_preempt_irq();
+
+/* Keep the current thread on the cpu until the matching preempt_enable.  Nests */
+void preempt_disable();
+
+/* Undo preempt_disable, switching threads if a preemption came due in between */
+void preempt_enable();
+
+#endif /* SCHED_H */
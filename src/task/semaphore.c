@@ -0,0 +1,33 @@
+#include "semaphore.h"
+#include "lib/atomic.h"
+
+void sem_init(struct semaphore *sem, int32_t count)
+{
+	sem->count = count;
+	wait_queue_init(&sem->waiters);
+}
+
+bool sem_trydown(struct semaphore *sem)
+{
+	int32_t count = atomic_load(&sem->count);
+
+	while (count > 0) {
+		if (atomic_cmpxchg(&sem->count, &count, count - 1))
+			return true;
+	}
+
+	return false;
+}
+
+void sem_down(struct semaphore *sem)
+{
+	wait_event(&sem->waiters, sem_trydown(sem));
+}
+
+void sem_up(struct semaphore *sem)
+{
+	atomic_fetch_add(&sem->count, 1);
+
+	/* Unconditionally: a check of the queue without its lock could miss a waiter going to sleep */
+	wake_up_one(&sem->waiters);
+}
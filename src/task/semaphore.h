@@ -0,0 +1,31 @@
+/* semaphore.h
+ * counting semaphores
+ *
+ * sem_down sleeps while the count is 0.  sem_up never blocks, so interrupt handlers can use it
+ * to hand work to a thread.
+ */
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wait.h"
+
+struct semaphore {
+	int32_t count;
+	struct wait_queue waiters;
+};
+
+void sem_init(struct semaphore *sem, int32_t count);
+
+/* Take one unit, sleeping until the count is above 0 */
+void sem_down(struct semaphore *sem);
+
+/* Take one unit if the count is above 0 right now.  Returns false if it isn't */
+bool sem_trydown(struct semaphore *sem);
+
+/* Give back one unit and wake a waiter.  Safe from interrupts */
+void sem_up(struct semaphore *sem);
+
+#endif /* SEMAPHORE_H */
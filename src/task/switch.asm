@@ -0,0 +1,29 @@
+section .asm
+
+THREAD_ESP equ 0			; offset of esp in struct thread
+
+global switch_to
+
+; void switch_to(struct thread *prev, struct thread *next)
+;
+; switch_to is an ordinary call as far as the compiler is concerned, so only the registers the
+; cdecl convention makes the callee preserve need saving.  They go on prev's own stack, leaving
+; just the stack pointer to store in prev.  The return address is already on the stack too, so
+; the ret at the end lands wherever next called switch_to from (or at its entry point, for a
+; thread that hasn't run yet).
+switch_to:
+	mov eax, [esp+4]		; prev
+	mov edx, [esp+8]		; next
+
+	push ebp
+	push ebx
+	push esi
+	push edi
+	mov [eax+THREAD_ESP], esp
+
+	mov esp, [edx+THREAD_ESP]
+	pop edi
+	pop esi
+	pop ebx
+	pop ebp
+	ret
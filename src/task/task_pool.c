@@ -0,0 +1,257 @@
+#include "task_pool.h"
+#include "sched.h"
+#include "smp/smp.h"
+#include "smp/percpu.h"
+#include "lib/atomic.h"
+
+static uint32_t pool_pending = 0;		// spawned tasks not finished yet, across all groups
+static uint32_t pool_workers = 0;		// application processors in task_pool_worker
+static int worker_limit = -1;
+
+/* Owner side.  Preemption stays off so another thread on this cpu can't use the deque halfway */
+static bool task_deque_push(struct task_deque *dq, struct task *task)
+{
+	uint32_t bottom = dq->bottom;
+	uint32_t top = atomic_load(&dq->top);
+
+	if (bottom - top >= TASK_DEQUE_SIZE)
+		return false;
+
+	dq->tasks[bottom & TASK_DEQUE_MASK] = task;
+	atomic_store(&dq->bottom, bottom + 1);		// publishes the slot to thieves
+	return true;
+}
+
+static struct task *task_deque_pop(struct task_deque *dq)
+{
+	uint32_t bottom = dq->bottom - 1;
+	uint32_t top;
+	struct task *task;
+
+	/* Claim the bottom slot before looking at top, a thief does the opposite.  The full barrier
+	 * keeps the store from being reordered after the load, which x86 would otherwise do
+	 */
+	dq->bottom = bottom;
+	smp_mb();
+	top = atomic_load(&dq->top);
+
+	if ((int32_t)(bottom - top) < 0) {
+		atomic_store(&dq->bottom, bottom + 1);	// was empty
+		return 0;
+	}
+
+	task = dq->tasks[bottom & TASK_DEQUE_MASK];
+	if (bottom == top) {
+		/* Last task, race any thief for it through top */
+		if (!atomic_cmpxchg(&dq->top, &top, top + 1))
+			task = 0;
+		atomic_store(&dq->bottom, bottom + 1);
+	}
+
+	return task;
+}
+
+/* Thief side, any cpu */
+static struct task *task_deque_steal(struct task_deque *dq)
+{
+	uint32_t top = atomic_load(&dq->top);
+	uint32_t bottom;
+	struct task *task;
+
+	smp_mb();
+	bottom = atomic_load(&dq->bottom);
+	if ((int32_t)(bottom - top) <= 0)
+		return 0;
+
+	task = dq->tasks[top & TASK_DEQUE_MASK];
+	if (!atomic_cmpxchg(&dq->top, &top, top + 1))
+		return 0;				// lost to the owner or another thief
+
+	return task;
+}
+
+/* Our own newest task, otherwise the oldest task of the first cpu after us that has one */
+static struct task *task_take()
+{
+	int ncpus = smp_cpu_count();
+	int self;
+	struct task *task;
+
+	preempt_disable();
+	self = smp_processor_id();
+	task = task_deque_pop(&this_cpu()->tasks);
+	preempt_enable();
+
+	for (int i = 1; !task && i < ncpus; i++) {
+		struct percpu *victim = percpu_area((self + i) % ncpus);
+		if (victim)
+			task = task_deque_steal(&victim->tasks);
+	}
+
+	return task;
+}
+
+/* The task may live in a frame that is gone as soon as its group drops to 0, so it isn't
+ * touched after that
+ */
+static void task_run(struct task *task)
+{
+	struct task_group *group = task->group;
+
+	task->fn(task->arg);
+	atomic_fetch_sub(&group->pending, 1);
+	atomic_fetch_sub(&pool_pending, 1);
+}
+
+/* Runs on an application processor, from its idle loop, until every spawned task is done */
+static void task_pool_worker(void *arg)
+{
+	atomic_fetch_add(&pool_workers, 1);
+
+	while (atomic_load(&pool_pending)) {
+		struct task *task = task_take();
+		if (task) {
+			task_run(task);
+		} else {
+			cpu_relax();
+		}
+	}
+
+	atomic_fetch_sub(&pool_workers, 1);
+}
+
+/*
+ * Wake the idle application processors.  smp_call turns down ones that are busy, including a
+ * worker that is just exiting as new work comes in, which then sits this batch out
+ */
+static void task_pool_kick()
+{
+	int ncpus = smp_cpu_count();
+	int limit = atomic_load(&worker_limit);
+
+	if (limit >= 0 && limit + 1 < ncpus)
+		ncpus = limit + 1;
+
+	if (atomic_load(&pool_workers) >= ncpus - 1)
+		return;
+
+	for (int cpu = 1; cpu < ncpus; cpu++) {
+		if (cpu != smp_processor_id())
+			smp_call(cpu, task_pool_worker, 0);
+	}
+}
+
+void task_group_init(struct task_group *group)
+{
+	group->pending = 0;
+}
+
+void task_init(struct task *task, task_fn_t fn, void *arg)
+{
+	task->fn = fn;
+	task->arg = arg;
+	task->group = 0;
+}
+
+void task_spawn(struct task_group *group, struct task *task)
+{
+	bool queued;
+
+	task->group = group;
+	atomic_fetch_add(&group->pending, 1);
+	atomic_fetch_add(&pool_pending, 1);
+
+	preempt_disable();
+	queued = task_deque_push(&this_cpu()->tasks, task);
+	preempt_enable();
+
+	if (!queued) {
+		task_run(task);
+		return;
+	}
+
+	task_pool_kick();
+}
+
+void task_group_wait(struct task_group *group)
+{
+	while (atomic_load(&group->pending)) {
+		struct task *task = task_take();
+		if (task) {
+			task_run(task);
+		} else {
+			cpu_relax();
+		}
+	}
+}
+
+void task_pool_set_workers(int workers)
+{
+	atomic_store(&worker_limit, workers);
+}
+
+struct parallel_for_job {
+	parallel_for_fn_t fn;
+	void *arg;
+	uint32_t grain;
+};
+
+struct parallel_for_half {
+	struct task task;
+	const struct parallel_for_job *job;
+	uint32_t start;
+	uint32_t end;
+};
+
+static void parallel_for_range(const struct parallel_for_job *job, uint32_t start, uint32_t end);
+
+static void parallel_for_task(void *arg)
+{
+	struct parallel_for_half *half = arg;
+	parallel_for_range(half->job, half->start, half->end);
+}
+
+/* Fork the upper half, recurse into the lower half, then join.  Both halves live in this
+ * frame, which doesn't return before the forked half is done
+ */
+static void parallel_for_range(const struct parallel_for_job *job, uint32_t start, uint32_t end)
+{
+	struct parallel_for_half upper;
+	struct task_group group;
+	uint32_t mid;
+
+	if (end - start <= job->grain) {
+		job->fn(start, end, job->arg);
+		return;
+	}
+
+	mid = start + (end - start) / 2;
+	upper.job = job;
+	upper.start = mid;
+	upper.end = end;
+
+	task_group_init(&group);
+	task_init(&upper.task, parallel_for_task, &upper);
+	task_spawn(&group, &upper.task);
+
+	parallel_for_range(job, start, mid);
+	task_group_wait(&group);
+}
+
+void parallel_for(uint32_t start, uint32_t end, uint32_t grain, parallel_for_fn_t fn, void *arg)
+{
+	struct parallel_for_job job = { .fn = fn, .arg = arg, .grain = grain ? grain : 1 };
+
+	if (start >= end)
+		return;
+
+	/* Nobody to share with, skip the deque traffic */
+	if (smp_cpu_count() == 1) {
+		for (uint32_t i = start; i < end; i += job.grain) {
+			fn(i, end - i > job.grain ? i + job.grain : end, arg);
+		}
+		return;
+	}
+
+	parallel_for_range(&job, start, end);
+}
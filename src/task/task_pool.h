@@ -0,0 +1,75 @@
+/* task_pool.h
+ * work stealing task pool for parallel kernel jobs
+ *
+ * Every cpu has a Chase-Lev deque of tasks.  A cpu pushes and pops tasks at the bottom of its
+ * own deque, last in first out so it keeps working on what is hot in its cache, while cpus that
+ * run out of work steal the oldest task from the top of someone else's, which is usually the
+ * biggest piece left.  Only a steal, or a pop racing a steal for the last task, needs a locked
+ * instruction.
+ *
+ * While tasks are outstanding the application processors are kicked out of their idle loop with
+ * smp_call and keep stealing until the pool drains.  A cpu waiting on a task group helps out
+ * instead of spinning.
+ *
+ * Tasks are for thread or AP context, never interrupt handlers.
+ */
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+#define TASK_DEQUE_MASK		(TASK_DEQUE_SIZE - 1)
+
+typedef void (*task_fn_t)(void *arg);
+
+/* A set of tasks that can be waited on together.  Usually lives on the forking function's stack */
+struct task_group {
+	uint32_t pending;			// spawned tasks that haven't finished yet
+};
+
+struct task {
+	task_fn_t fn;
+	void *arg;
+	struct task_group *group;
+};
+
+/* Per cpu deque, lives in struct percpu.  The owner works at bottom, thieves take from top */
+struct task_deque {
+	uint32_t top;
+	uint32_t bottom;
+	struct task *tasks[TASK_DEQUE_SIZE];
+};
+
+typedef void (*parallel_for_fn_t)(uint32_t start, uint32_t end, void *arg);
+
+void task_group_init(struct task_group *group);
+
+void task_init(struct task *task, task_fn_t fn, void *arg);
+
+/*
+ * task_spawn - fork task into group
+ *
+ * The task goes on the calling cpu's deque, where any cpu may pick it up.  If the deque is full
+ * the task runs right away on the calling cpu.  task must stay valid until group is waited on
+ */
+void task_spawn(struct task_group *group, struct task *task);
+
+/* Join: run or steal tasks until everything spawned into group has finished */
+void task_group_wait(struct task_group *group);
+
+/*
+ * parallel_for - call fn on pieces of [start, end) across every online cpu
+ *
+ * The range is split in half recursively, forking one half each time, until pieces are at most
+ * grain long.  Returns once fn has run on the whole range.  With a single cpu online it is a
+ * plain loop over the pieces
+ */
+void parallel_for(uint32_t start, uint32_t end, uint32_t grain, parallel_for_fn_t fn, void *arg);
+
+/* Limit how many application processors join in, e.g. to measure scaling.  Negative means all */
+void task_pool_set_workers(int workers);
+
+#endif /* TASK_POOL_H */
@@ -0,0 +1,186 @@
+#include "thread.h"
+#include "sched.h"
+#include "idt/idt.h"
+#include "idt/irq.h"
+#include "smp/percpu.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "kernel.h"
+#include "config.h"
+
+/* What switch_to pops off a thread's stack, lowest address first */
+struct switch_frame {
+	uint32_t edi;
+	uint32_t esi;
+	uint32_t ebx;
+	uint32_t ebp;
+	uint32_t eip;			// where switch_to returns to
+	uint32_t start_ret;		// return address slot for thread_start, which never uses it
+};
+
+static struct thread idle_thread;
+static uint32_t next_id = 0;
+static struct list_head dead_threads;	// exited threads whose stacks can't be freed until we're off them
+
+void thread_reap()
+{
+	struct list_head *pos, *n;
+
+	list_for_each_safe(pos, n, &dead_threads) {
+		struct thread *thread = list_entry(pos, struct thread, run_entry);
+		list_del(&thread->run_entry);
+		kfree(thread->stack);
+		kfree(thread);
+	}
+}
+
+/*
+ * First code every new thread runs.  switch_to "returns" here with interrupts disabled, the
+ * way schedule left them
+ */
+static void thread_start()
+{
+	struct thread *self = thread_current();
+
+	thread_reap();
+	enable_interrupts();
+
+	self->fn(self->arg);
+	thread_exit();
+}
+
+void thread_init()
+{
+	list_init(&dead_threads);
+
+	idle_thread.id = next_id++;
+	idle_thread.state = THREAD_RUNNING;
+	idle_thread.name = "idle";
+	idle_thread.base_priority = SCHED_PRIORITY_LOWEST;
+	idle_thread.priority = SCHED_PRIORITY_LOWEST;
+	idle_thread.stack = 0;
+	list_init(&idle_thread.run_entry);
+
+	sched_init(&idle_thread);
+}
+
+struct thread *thread_create(const char *name, int priority, thread_fn_t fn, void *arg)
+{
+	struct thread *thread;
+	struct switch_frame *frame;
+	uint32_t flags;
+
+	if (priority < 0 || priority > SCHED_PRIORITY_LOWEST)
+		return 0;
+
+	thread = kzalloc(sizeof(struct thread));
+	if (!thread)
+		return 0;
+
+	thread->stack = kmalloc(THREAD_STACK_SIZE);
+	if (!thread->stack) {
+		kfree(thread);
+		return 0;
+	}
+
+	thread->name = name;
+	thread->base_priority = priority;
+	thread->priority = priority;
+	thread->fn = fn;
+	thread->arg = arg;
+
+	/* Make the new stack look like the thread called switch_to from the top of thread_start */
+	frame = (struct switch_frame*)((uint8_t*)thread->stack + THREAD_STACK_SIZE) - 1;
+	memset(frame, 0, sizeof(*frame));
+	frame->eip = (uint32_t)thread_start;
+	thread->esp = (uint32_t)frame;
+
+	flags = interrupts_save_disable();
+	thread->id = next_id++;
+	interrupts_restore(flags);
+
+	sched_enqueue(thread);
+	return thread;
+}
+
+void thread_yield()
+{
+	uint32_t flags = interrupts_save_disable();
+
+	schedule();
+
+	interrupts_restore(flags);
+}
+
+void thread_block()
+{
+	uint32_t flags = interrupts_save_disable();
+	struct thread *self = thread_current();
+
+	if (self == &idle_thread)
+		panic("The idle thread can't block");
+
+	/* Sleeping before the slice ran out is what interactive threads do, undo any penalty */
+	self->state = THREAD_BLOCKED;
+	self->priority = self->base_priority;
+	schedule();
+
+	interrupts_restore(flags);
+}
+
+void thread_block_handoff(struct thread *next)
+{
+	uint32_t flags = interrupts_save_disable();
+	struct thread *self = thread_current();
+
+	if (self == &idle_thread)
+		panic("The idle thread can't block");
+
+	self->state = THREAD_BLOCKED;
+	self->priority = self->base_priority;
+	sched_handoff(next);
+
+	interrupts_restore(flags);
+}
+
+bool thread_can_block()
+{
+	struct thread *self = thread_current();
+
+	return self && self != &idle_thread && !in_interrupt() && !this_cpu_read(sched.preempt_count);
+}
+
+void thread_wake(struct thread *thread)
+{
+	uint32_t flags = interrupts_save_disable();
+
+	if (thread->state == THREAD_BLOCKED)
+		sched_enqueue(thread);
+
+	interrupts_restore(flags);
+}
+
+void thread_exit()
+{
+	struct thread *self = thread_current();
+
+	if (self == &idle_thread)
+		panic("The idle thread can't exit");
+
+	disable_interrupts();
+	self->state = THREAD_DEAD;
+	list_add_tail(&self->run_entry, &dead_threads);
+	schedule();
+
+	panic("A dead thread was scheduled");
+}
+
+struct thread *thread_current()
+{
+	return sched_current();
+}
+
+bool thread_runnable()
+{
+	return sched_runnable();
+}
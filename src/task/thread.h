@@ -0,0 +1,102 @@
+/* thread.h
+ * kernel threads
+ *
+ * Every thread has its own kmalloc'd stack.  Which thread runs when is up to the scheduler
+ * (sched.h).  The boot flow of control becomes the idle thread, which only runs when nothing
+ * else can.
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/list.h"
+
+typedef void (*thread_fn_t)(void *arg);
+
+struct process;
+
+enum thread_state {
+	THREAD_RUNNING,			// the thread on the cpu
+	THREAD_RUNNABLE,		// waiting its turn on a run queue
+	THREAD_BLOCKED,			// waiting for thread_wake
+	THREAD_DEAD,			// exited, stack is freed by the next thread to run
+};
+
+struct thread {
+	uint32_t esp;			// saved stack pointer while switched out, must stay first (see switch.asm)
+	uint32_t id;
+	enum thread_state state;
+	const char *name;
+	int base_priority;		// the priority the thread asked for
+	int priority;			// current priority, moved around by the scheduler
+	uint32_t slice;			// ticks left of the current time slice
+	uint32_t enqueued_at;		// scheduler tick it joined its run queue on
+	thread_fn_t fn;
+	void *arg;
+	void *stack;			// bottom of the kmalloc'd stack, 0 for the idle thread
+	struct process *process;	// user process running on this thread, 0 for kernel threads
+	uint32_t fault_address;		// cr2 of the last page fault in user mode, saved before it can be preempted
+	struct list_head run_entry;	// on a run queue or the dead list
+};
+
+/*
+ * thread_init - turn the code that is running now into the idle thread and start scheduling
+ *
+ * prereq - kernel_heap_init()
+ */
+void thread_init();
+
+/*
+ * thread_create - start a thread that runs fn(arg) with interrupts enabled
+ *
+ * priority is 0 (highest) to SCHED_PRIORITY_LOWEST.  Returning from fn is the same as calling
+ * thread_exit.  Returns 0 if there is no memory for the thread
+ */
+struct thread *thread_create(const char *name, int priority, thread_fn_t fn, void *arg);
+
+/* Give the cpu to the next runnable thread of the same or higher priority, if there is one */
+void thread_yield();
+
+/*
+ * thread_block - sleep until some other code calls thread_wake on us
+ *
+ * To not miss a wakeup, disable interrupts before checking whatever we wait for and keep
+ * them disabled until thread_block; it restores them once we run again
+ */
+void thread_block();
+
+/* Like thread_block, but give the cpu straight to next, which must be blocked, instead of to the
+ * highest priority runnable thread (see sched_handoff)
+ */
+void thread_block_handoff(struct thread *next);
+
+/* True if the caller may call thread_block: a thread other than the idle thread, with
+ * preemption enabled and outside of interrupt handlers
+ */
+bool thread_can_block();
+
+/* Make a blocked thread runnable.  Does nothing if it isn't blocked.  Safe from interrupts */
+void thread_wake(struct thread *thread);
+
+/* Stop the calling thread for good.  Never returns */
+void thread_exit();
+
+/* The thread running on this cpu */
+struct thread *thread_current();
+
+/* Returns true if some thread other than the current one is waiting to run */
+bool thread_runnable();
+
+/* Free threads that have exited.  Called by the scheduler once it is off their stacks */
+void thread_reap();
+
+/*
+ * switch_to - save the callee saved registers and stack pointer into prev and resume next
+ *
+ * Returns once something switches back to prev.  Interrupts should be disabled
+ */
+void switch_to(struct thread *prev, struct thread *next);
+
+#endif /* THREAD_H */
@@ -0,0 +1,87 @@
+#include "wait.h"
+#include "idt/idt.h"
+#include "cpu/cpu.h"
+
+LOCK_CLASS(wait_queue_lock_class, "wait queue");
+
+void wait_queue_init(struct wait_queue *wq)
+{
+	spin_lock_init(&wq->lock, &wait_queue_lock_class);
+	list_init(&wq->waiters);
+}
+
+uint32_t wait_prepare(struct wait_queue *wq, struct wait_entry *wait)
+{
+	uint32_t flags = interrupts_save_disable();
+
+	wait->thread = thread_can_block() ? thread_current() : 0;
+	wait->entry.next = 0;
+	wait->entry.prev = 0;
+	return flags;
+}
+
+/* Called with interrupts disabled and returns with them disabled */
+void wait_sleep(struct wait_queue *wq, struct wait_entry *wait)
+{
+	if (!wait->thread) {
+		/* Can't sleep, halt until the next interrupt might have changed things */
+		cpu_wait_for_interrupt();
+		disable_interrupts();
+		return;
+	}
+
+	/* A wake up takes us off the queue, get back on if the condition still doesn't hold */
+	spin_lock(&wq->lock);
+	if (!list_is_linked(&wait->entry))
+		list_add_tail(&wait->entry, &wq->waiters);
+	spin_unlock(&wq->lock);
+
+	thread_block();
+}
+
+void wait_finish(struct wait_queue *wq, struct wait_entry *wait, uint32_t flags)
+{
+	if (wait->thread) {
+		spin_lock(&wq->lock);
+		if (list_is_linked(&wait->entry))
+			list_del(&wait->entry);
+		spin_unlock(&wq->lock);
+	}
+
+	interrupts_restore(flags);
+}
+
+static void wake_up(struct wait_queue *wq, bool all)
+{
+	uint32_t flags = spin_lock_irqsave(&wq->lock);
+
+	while (!list_empty(&wq->waiters)) {
+		struct wait_entry *wait = list_first_entry(&wq->waiters, struct wait_entry, entry);
+		list_del(&wait->entry);
+		thread_wake(wait->thread);
+
+		if (!all)
+			break;
+	}
+
+	spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void wake_up_one(struct wait_queue *wq)
+{
+	wake_up(wq, false);
+}
+
+void wake_up_all(struct wait_queue *wq)
+{
+	wake_up(wq, true);
+}
+
+bool wait_queue_active(struct wait_queue *wq)
+{
+	uint32_t flags = spin_lock_irqsave(&wq->lock);
+	bool active = !list_empty(&wq->waiters);
+
+	spin_unlock_irqrestore(&wq->lock, flags);
+	return active;
+}
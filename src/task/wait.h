@@ -0,0 +1,73 @@
+/* wait.h
+ * wait queues
+ *
+ * A wait queue is a list of threads sleeping until some condition becomes true.  Whoever makes
+ * it true calls wake_up_one or wake_up_all, which is safe from interrupt handlers, and the woken
+ * threads check the condition again.
+ *
+ * Code that can't block (the idle thread, interrupt handlers, application processors, anything
+ * holding a spinlock) still gets the right answer from wait_event: it halts between checks
+ * instead, and an interrupt is what ends the halt.
+ *
+ * Threads only run on the boot cpu, so the wake ups have to come from there too: a thread or
+ * an interrupt handler, not a task running on an application processor.
+ */
+
+#ifndef WAIT_H
+#define WAIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "thread.h"
+#include "lib/list.h"
+#include "lib/spinlock.h"
+
+struct wait_queue {
+	spinlock_t lock;
+	struct list_head waiters;		// struct wait_entry, oldest first
+};
+
+/* A waiting thread's place on a wait queue, lives on its stack for the length of a wait_event */
+struct wait_entry {
+	struct thread *thread;
+	struct list_head entry;
+};
+
+void wait_queue_init(struct wait_queue *wq);
+
+/*
+ * wait_event - sleep on wq until cond is true
+ *
+ * cond is checked with interrupts disabled, so a wakeup from an interrupt handler can't slip in
+ * between the check and going to sleep.  It may have side effects, e.g. claiming the thing it
+ * waits for, and is evaluated again every time the thread is woken
+ */
+#define wait_event(wq, cond) do {						\
+	struct wait_entry __wait;						\
+	uint32_t __flags;							\
+										\
+	if (cond)								\
+		break;								\
+										\
+	__flags = wait_prepare((wq), &__wait);					\
+	while (!(cond)) {							\
+		wait_sleep((wq), &__wait);					\
+	}									\
+	wait_finish((wq), &__wait, __flags);					\
+} while (0)
+
+/* Wake the thread that has been waiting on wq the longest.  Safe from interrupts */
+void wake_up_one(struct wait_queue *wq);
+
+/* Wake every thread waiting on wq.  Safe from interrupts */
+void wake_up_all(struct wait_queue *wq);
+
+/* True if some thread is sleeping on wq.  Only a snapshot, a waiter can arrive right after it */
+bool wait_queue_active(struct wait_queue *wq);
+
+/* wait_event's helpers.  wait_prepare disables interrupts until the matching wait_finish */
+uint32_t wait_prepare(struct wait_queue *wq, struct wait_entry *wait);
+void wait_sleep(struct wait_queue *wq, struct wait_entry *wait);
+void wait_finish(struct wait_queue *wq, struct wait_entry *wait, uint32_t flags);
+
+#endif /* WAIT_H */
@@ -0,0 +1,73 @@
+#include "clock.h"
+#include "pit.h"
+#include "cpu/cpu.h"
+#include "lib/math.h"
+#include "status.h"
+
+#define CLOCK_CALIBRATE_MS	10
+
+static uint32_t tsc_khz = 0;
+static uint32_t cycles_to_ns_mult = 0;
+static uint32_t ns_to_cycles_mult = 0;
+static uint64_t tsc_base = 0;
+
+int clock_init()
+{
+	uint64_t cycles;
+	uint64_t mult;
+
+	cycles = pit_calibrate_tsc(CLOCK_CALIBRATE_MS);
+	div64_32(&cycles, CLOCK_CALIBRATE_MS);		// cycles per ms is the frequency in kHz
+	if (!cycles)
+		return -EIO;
+
+	tsc_khz = cycles;
+
+	mult = (uint64_t)NSEC_PER_MSEC << CLOCK_SHIFT;
+	div64_32(&mult, tsc_khz);
+	cycles_to_ns_mult = mult;
+
+	mult = (uint64_t)tsc_khz << CLOCK_SHIFT;
+	div64_32(&mult, NSEC_PER_MSEC);
+	ns_to_cycles_mult = mult;
+
+	tsc_base = read_tsc();
+	return 0;
+}
+
+uint64_t cycles_to_ns(uint64_t cycles)
+{
+	return mul_u64_u32_shr(cycles, cycles_to_ns_mult, CLOCK_SHIFT);
+}
+
+uint64_t ns_to_cycles(uint64_t ns)
+{
+	return mul_u64_u32_shr(ns, ns_to_cycles_mult, CLOCK_SHIFT);
+}
+
+uint64_t ktime_ns()
+{
+	return cycles_to_ns(read_tsc() - tsc_base);
+}
+
+uint32_t clock_tsc_khz()
+{
+	return tsc_khz;
+}
+
+uint32_t clock_cycles_to_ns_mult()
+{
+	return cycles_to_ns_mult;
+}
+
+uint64_t clock_tsc_base()
+{
+	return tsc_base;
+}
+
+void udelay(uint32_t us)
+{
+	uint64_t end = read_tsc() + ns_to_cycles((uint64_t)us * NSEC_PER_USEC);
+	while (read_tsc() < end) {
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#define NSEC_PER_USEC	1000
+#define NSEC_PER_MSEC	1000000
+#define NSEC_PER_SEC	1000000000
+
+/* ns = (cycles * mult) >> CLOCK_SHIFT, and the other way around.  Linux calls this the
+ * clocksource mult/shift pair: it keeps divisions out of ktime_ns
+ */
+#define CLOCK_SHIFT	22
+
+/*
+ * clock_init - calibrate the tsc against the PIT
+ *
+ * Must run before anything calls ktime_ns or udelay.  Returns 0 on success, -EIO if the tsc
+ * doesn't seem to be ticking
+ */
+int clock_init();
+
+/* Nanoseconds since clock_init.  Monotonic, costs one rdtsc and two multiplies */
+uint64_t ktime_ns();
+
+/* Calibrated tsc frequency in kHz */
+uint32_t clock_tsc_khz();
+
+/* The mult of cycles_to_ns, for code that scales cycles itself (the vdso) */
+uint32_t clock_cycles_to_ns_mult();
+
+/* The tsc value ktime_ns counts from */
+uint64_t clock_tsc_base();
+
+/* Convert between tsc cycles and nanoseconds using the calibrated tsc frequency */
+uint64_t cycles_to_ns(uint64_t cycles);
+uint64_t ns_to_cycles(uint64_t ns);
+
+/* Spin for at least us microseconds */
+void udelay(uint32_t us);
+
+#endif /* CLOCK_H */
@@ -0,0 +1,63 @@
+#include "lapic_timer.h"
+#include "timer.h"
+#include "clock.h"
+#include "apic/apic.h"
+#include "lib/math.h"
+#include "status.h"
+
+#define LAPIC_CALIBRATE_MS	10
+#define LAPIC_MAX_COUNT		0xffffffff
+
+static uint32_t lapic_timer_khz = 0;
+static uint32_t lapic_ns_mult = 0;		// timer ticks per ns, as a fraction of 2^32
+
+int lapic_timer_calibrate()
+{
+	uint32_t elapsed;
+	uint64_t mult;
+
+	if (!apic_enabled())
+		return -ENODEV;
+
+	/* Let it count down from the top while the tsc measures out a known interval */
+	lapic_timer_start(LAPIC_MAX_COUNT, false);
+	udelay(LAPIC_CALIBRATE_MS * 1000);
+	elapsed = LAPIC_MAX_COUNT - lapic_timer_current();
+	lapic_timer_stop();
+
+	lapic_timer_khz = elapsed / LAPIC_CALIBRATE_MS;
+	if (!lapic_timer_khz)
+		return -EIO;
+
+	mult = (uint64_t)lapic_timer_khz << 32;
+	div64_32(&mult, NSEC_PER_MSEC);
+	lapic_ns_mult = mult;
+	lapic_clock_event.max_oneshot_ns = (uint64_t)(LAPIC_MAX_COUNT / lapic_timer_khz) * NSEC_PER_MSEC;
+	return 0;
+}
+
+static void lapic_timer_set_periodic(uint32_t hz)
+{
+	lapic_timer_start(lapic_timer_khz * 1000 / hz, true);
+}
+
+static void lapic_timer_set_oneshot(uint64_t ns)
+{
+	uint64_t count = mul_u64_u32_shr(ns, lapic_ns_mult, 32);
+
+	if (count > LAPIC_MAX_COUNT)
+		count = LAPIC_MAX_COUNT;
+	if (count == 0)
+		count = 1;
+
+	lapic_timer_start(count, false);
+}
+
+struct clock_event lapic_clock_event = {
+	.name = "lapic",
+	.vector = LAPIC_TIMER_VECTOR,
+	.max_oneshot_ns = 0,			// filled in by calibration
+	.set_periodic = lapic_timer_set_periodic,
+	.set_oneshot = lapic_timer_set_oneshot,
+	.stop = lapic_timer_stop,
+};
@@ -0,0 +1,18 @@
+#ifndef LAPIC_TIMER_H
+#define LAPIC_TIMER_H
+
+struct clock_event;
+
+/* Tick source backed by this cpu's local apic timer */
+extern struct clock_event lapic_clock_event;
+
+/*
+ * lapic_timer_calibrate - measure the local apic timer's frequency against the tsc
+ *
+ * Returns 0 on success, -ENODEV if the apics aren't in use and -EIO if the timer didn't count
+ *
+ * prereq - called clock_init() and apic_init()
+ */
+int lapic_timer_calibrate();
+
+#endif /* LAPIC_TIMER_H */
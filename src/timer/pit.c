@@ -0,0 +1,82 @@
+#include "pit.h"
+#include "timer.h"
+#include "io/io.h"
+#include "cpu/cpu.h"
+#include "idt/irq.h"
+#include "lib/math.h"
+#include "clock.h"
+
+/* Refer to the OSDev Wiki Programmable Interval Timer article */
+#define PIT_CHANNEL0_DATA	0x40
+#define PIT_CHANNEL2_DATA	0x42
+#define PIT_COMMAND		0x43
+#define PIT_CHANNEL2_GATE_PORT	0x61		// keyboard controller port b, also gates channel 2
+#define PIT_CHANNEL2_GATE	0x01
+#define PIT_SPEAKER_ENABLE	0x02
+#define PIT_CHANNEL2_OUT	0x20
+
+#define PIT_CMD_CHANNEL0	0x00
+#define PIT_CMD_CHANNEL2	0x80
+#define PIT_CMD_LOHI		0x30		// access mode: low byte then high byte
+#define PIT_CMD_MODE0		0x00		// interrupt on terminal count (one shot)
+#define PIT_CMD_MODE2		0x04		// rate generator (periodic)
+#define PIT_MAX_COUNT		0xffff
+
+/* Number of PIT input ticks per ns, as a fraction of 2^32 */
+#define PIT_NS_MULT		((uint32_t)(((uint64_t)PIT_FREQUENCY << 32) / NSEC_PER_SEC))
+
+static void pit_load(int channel_cmd, int data_port, int mode, uint32_t count)
+{
+	if (count > PIT_MAX_COUNT)
+		count = PIT_MAX_COUNT;
+	if (count == 0)
+		count = 1;
+
+	outb(PIT_COMMAND, channel_cmd | PIT_CMD_LOHI | mode);
+	outb(data_port, count & 0xff);
+	outb(data_port, count >> 8);
+}
+
+uint64_t pit_calibrate_tsc(uint32_t ms)
+{
+	uint64_t start;
+	unsigned char gate;
+
+	/* Raise channel 2's gate with the speaker disconnected, then count down from ms worth of ticks */
+	gate = insb(PIT_CHANNEL2_GATE_PORT);
+	outb(PIT_CHANNEL2_GATE_PORT, (gate & ~PIT_SPEAKER_ENABLE) | PIT_CHANNEL2_GATE);
+	pit_load(PIT_CMD_CHANNEL2, PIT_CHANNEL2_DATA, PIT_CMD_MODE0, PIT_FREQUENCY / 1000 * ms);
+
+	/* Channel 2's output goes high on terminal count */
+	start = read_tsc();
+	while (!(insb(PIT_CHANNEL2_GATE_PORT) & PIT_CHANNEL2_OUT)) {
+	}
+
+	return read_tsc() - start;
+}
+
+static void pit_set_periodic(uint32_t hz)
+{
+	pit_load(PIT_CMD_CHANNEL0, PIT_CHANNEL0_DATA, PIT_CMD_MODE2, PIT_FREQUENCY / hz);
+	irq_unmask(0);
+}
+
+static void pit_set_oneshot(uint64_t ns)
+{
+	pit_load(PIT_CMD_CHANNEL0, PIT_CHANNEL0_DATA, PIT_CMD_MODE0, mul_u64_u32_shr(ns, PIT_NS_MULT, 32));
+	irq_unmask(0);
+}
+
+static void pit_stop()
+{
+	irq_mask(0);
+}
+
+struct clock_event pit_clock_event = {
+	.name = "pit",
+	.vector = IRQ_VECTOR_BASE + 0,
+	.max_oneshot_ns = (uint64_t)PIT_MAX_COUNT * NSEC_PER_SEC / PIT_FREQUENCY,
+	.set_periodic = pit_set_periodic,
+	.set_oneshot = pit_set_oneshot,
+	.stop = pit_stop,
+};
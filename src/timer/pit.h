@@ -0,0 +1,21 @@
+#ifndef PIT_H
+#define PIT_H
+
+#include <stdint.h>
+
+/* The 8253/8254 programmable interval timer's input clock */
+#define PIT_FREQUENCY	1193182
+
+struct clock_event;
+
+/* Tick source backed by PIT channel 0 on isa irq 0 */
+extern struct clock_event pit_clock_event;
+
+/*
+ * pit_calibrate_tsc - count tsc cycles over ms milliseconds (at most 50)
+ *
+ * Runs PIT channel 2 as a one shot and polls its output, so interrupts aren't needed
+ */
+uint64_t pit_calibrate_tsc(uint32_t ms);
+
+#endif /* PIT_H */
@@ -0,0 +1,120 @@
+#include "timer.h"
+#include "clock.h"
+#include "pit.h"
+#include "lapic_timer.h"
+#include "idt/irq.h"
+#include "idt/idt.h"
+#include "lib/math.h"
+#include "task/sched.h"
+#include "smp/smp.h"
+#include "vdso/vdso.h"
+#include "print/print.h"
+#include "config.h"
+
+static struct clock_event *timer_dev = 0;
+static timer_event_handler_t timer_event_handler = 0;
+static uint64_t jiffies = 0;
+static uint64_t jiffies_start_ns = 0;		// ktime the current jiffy began at
+
+/* Catch jiffies up with the clock.  Usually a compare, only long gaps (tickless) need a division */
+static void timer_update_jiffies()
+{
+	uint64_t delta = ktime_ns() - jiffies_start_ns;
+	uint64_t ticks;
+
+	if (delta < TIMER_NSEC_PER_TICK)
+		return;
+
+	if (delta < 2 * TIMER_NSEC_PER_TICK) {
+		ticks = 1;
+	} else {
+		ticks = delta;
+		div64_32(&ticks, TIMER_NSEC_PER_TICK);
+	}
+
+	jiffies += ticks;
+	jiffies_start_ns += ticks * TIMER_NSEC_PER_TICK;
+}
+
+static void timer_interrupt(struct interrupt_frame *frame, void *ctx)
+{
+	/* Every cpu's local apic timer raises this vector, but time keeping, timers and the
+	 * scheduler belong to the boot cpu
+	 */
+	if (smp_processor_id() != 0) {
+		smp_ap_tick();
+		return;
+	}
+
+	timer_update_jiffies();
+	vdso_update();
+
+	if (timer_event_handler)
+		timer_event_handler();
+
+	sched_tick();
+}
+
+void timer_init()
+{
+	timer_dev = &pit_clock_event;
+	if (lapic_timer_calibrate() == 0) {
+		timer_dev = &lapic_clock_event;
+	}
+
+	irq_register(timer_dev->vector, timer_interrupt, 0);
+	timer_set_periodic();
+
+	print("Timer tick source: ");
+	print(timer_dev->name);
+	print(", tsc ");
+	print_dec(clock_tsc_khz());
+	print(" kHz\n");
+}
+
+void timer_suspend()
+{
+	timer_dev->stop();
+	irq_unregister(timer_dev->vector);
+}
+
+void timer_resume()
+{
+	irq_register(timer_dev->vector, timer_interrupt, 0);
+	timer_set_periodic();
+}
+
+struct clock_event *timer_clock_event()
+{
+	return timer_dev;
+}
+
+void timer_set_periodic()
+{
+	timer_dev->set_periodic(TIMER_HZ);
+}
+
+void timer_set_oneshot(uint64_t ns)
+{
+	if (ns > timer_dev->max_oneshot_ns)
+		ns = timer_dev->max_oneshot_ns;
+
+	timer_dev->set_oneshot(ns);
+}
+
+void timer_set_event_handler(timer_event_handler_t fn)
+{
+	timer_event_handler = fn;
+}
+
+uint64_t timer_jiffies()
+{
+	uint32_t flags = interrupts_save_disable();
+	uint64_t now;
+
+	timer_update_jiffies();
+	now = jiffies;
+
+	interrupts_restore(flags);
+	return now;
+}
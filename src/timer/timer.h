@@ -0,0 +1,61 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include "clock.h"
+#include "config.h"
+
+#define TIMER_NSEC_PER_TICK	(NSEC_PER_SEC / TIMER_HZ)
+
+/*
+ * A device that can raise an interrupt at some point in the future, either every 1/hz
+ * seconds or once after a delay.  The PIT and the local apic timer both provide one
+ */
+struct clock_event {
+	const char *name;
+	int vector;
+	uint64_t max_oneshot_ns;		// longest delay set_oneshot can program
+	void (*set_periodic)(uint32_t hz);
+	void (*set_oneshot)(uint64_t ns);
+	void (*stop)();
+};
+
+/* Called from the timer interrupt on every tick or one shot expiry */
+typedef void (*timer_event_handler_t)();
+
+/*
+ * timer_init - pick a tick source and start a periodic TIMER_HZ tick
+ *
+ * The local apic timer is preferred when the apics are routing interrupts, otherwise the PIT
+ * is used.
+ *
+ * prereq - called clock_init(), irq_controller_init() and idt_init()
+ */
+void timer_init();
+
+/* The tick source picked by timer_init */
+struct clock_event *timer_clock_event();
+
+/* Switch the tick source to a periodic TIMER_HZ tick */
+void timer_set_periodic();
+
+/* Switch the tick source to one shot mode and fire once, ns nanoseconds from now.  Delays
+ * longer than the device supports are clamped, the handler just sees an early event
+ */
+void timer_set_oneshot(uint64_t ns);
+
+/* Stop the tick source and release its vector, e.g. so a benchmark can drive it directly */
+void timer_suspend();
+
+/* Take the tick source back after timer_suspend and restart the periodic tick */
+void timer_resume();
+
+/* Install fn to be called on every timer event */
+void timer_set_event_handler(timer_event_handler_t fn);
+
+/* Number of TIMER_HZ ticks since clock_init.  Derived from the tsc rather than counted
+ * interrupts, so it stays correct while the tick source runs one shot
+ */
+uint64_t timer_jiffies();
+
+#endif /* TIMER_H */
@@ -0,0 +1,336 @@
+#include "timer_wheel.h"
+#include "timer.h"
+#include "clock.h"
+#include "idt/idt.h"
+#include "softirq/softirq.h"
+
+#define ROOT_MASK		(TIMER_WHEEL_ROOT_SIZE - 1)
+#define LEVEL_MASK		(TIMER_WHEEL_LEVEL_SIZE - 1)
+#define TIMER_LEVEL_EXPIRED	0xff
+#define TIMER_MAX_DELTA		0xffffffffULL	// furthest out the top level can represent
+
+static struct timer_wheel kernel_wheel;
+static bool tickless = false;
+static struct softirq_work timer_work;
+
+/* Timers on level n (1 based) hash on the bits of expires above level_shift(n - 1) */
+static int level_shift(int level)
+{
+	return TIMER_WHEEL_ROOT_BITS + level * TIMER_WHEEL_LEVEL_BITS;
+}
+
+static struct list_head *timer_slot(struct timer_wheel *wheel, int level, int slot)
+{
+	return level ? &wheel->levels[level - 1][slot] : &wheel->root[slot];
+}
+
+static uint32_t *timer_bitmap(struct timer_wheel *wheel, int level)
+{
+	return level ? wheel->level_bitmap[level - 1] : wheel->root_bitmap;
+}
+
+static void bitmap_set(uint32_t *bitmap, int bit)
+{
+	bitmap[bit / 32] |= 1U << (bit % 32);
+}
+
+static void bitmap_clear(uint32_t *bitmap, int bit)
+{
+	bitmap[bit / 32] &= ~(1U << (bit % 32));
+}
+
+/* First non empty root slot at index from or later, -1 if there is none before the wheel wraps */
+static int timer_wheel_root_next(struct timer_wheel *wheel, int from)
+{
+	for (int word = from / 32; word < TIMER_WHEEL_ROOT_SIZE / 32; word++) {
+		uint32_t bits = wheel->root_bitmap[word];
+		if (word == from / 32)
+			bits &= ~0U << (from % 32);
+
+		if (bits)
+			return word * 32 + __builtin_ctz(bits);	// a single bsf
+	}
+
+	return -1;
+}
+
+/* Hash t into the slot matching how far away it expires.  O(1) */
+static void timer_wheel_enqueue(struct timer_wheel *wheel, struct timer *t)
+{
+	uint64_t expires = t->expires;
+	int64_t delta = (int64_t)(expires - wheel->clk);
+	int level = 0;
+	int slot;
+
+	if (delta < 0) {
+		/* Already due, the next tick processed picks it up */
+		slot = wheel->clk & ROOT_MASK;
+	} else if (delta < TIMER_WHEEL_ROOT_SIZE) {
+		slot = expires & ROOT_MASK;
+	} else {
+		if ((uint64_t)delta > TIMER_MAX_DELTA) {
+			/* Park it as far out as we can, it gets rehashed when cascaded */
+			expires = wheel->clk + TIMER_MAX_DELTA;
+			delta = TIMER_MAX_DELTA;
+		}
+
+		for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+			if ((uint64_t)delta < (1ULL << level_shift(level)))
+				break;
+		}
+		slot = (expires >> level_shift(level - 1)) & LEVEL_MASK;
+	}
+
+	t->level = level;
+	t->slot = slot;
+	list_add_tail(&t->entry, timer_slot(wheel, level, slot));
+	bitmap_set(timer_bitmap(wheel, level), slot);
+}
+
+/* Rehash every timer in the current slot of level one wheel closer to the root.  Returns the
+ * slot index, the next level only needs cascading when this one wrapped around to 0
+ */
+static int timer_wheel_cascade(struct timer_wheel *wheel, int level)
+{
+	int slot = (wheel->clk >> level_shift(level - 1)) & LEVEL_MASK;
+	struct list_head work;
+
+	list_init(&work);
+	list_splice_tail_init(timer_slot(wheel, level, slot), &work);
+	bitmap_clear(timer_bitmap(wheel, level), slot);
+
+	while (!list_empty(&work)) {
+		struct timer *t = list_first_entry(&work, struct timer, entry);
+		list_del(&t->entry);
+		timer_wheel_enqueue(wheel, t);
+	}
+
+	return slot;
+}
+
+void timer_setup(struct timer *t, timer_fn_t fn, void *data)
+{
+	t->entry.next = NULL;
+	t->entry.prev = NULL;
+	t->expires = 0;
+	t->fn = fn;
+	t->data = data;
+	t->level = 0;
+	t->slot = 0;
+}
+
+bool timer_pending(struct timer *t)
+{
+	return list_is_linked(&t->entry);
+}
+
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now)
+{
+	wheel->clk = now;
+	wheel->pending = 0;
+
+	for (int i = 0; i < TIMER_WHEEL_ROOT_SIZE; i++) {
+		list_init(&wheel->root[i]);
+	}
+
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		for (int i = 0; i < TIMER_WHEEL_LEVEL_SIZE; i++) {
+			list_init(&wheel->levels[level][i]);
+		}
+		for (int i = 0; i < TIMER_WHEEL_LEVEL_SIZE / 32; i++) {
+			wheel->level_bitmap[level][i] = 0;
+		}
+	}
+
+	for (int i = 0; i < TIMER_WHEEL_ROOT_SIZE / 32; i++) {
+		wheel->root_bitmap[i] = 0;
+	}
+
+	list_init(&wheel->expired);
+}
+
+void timer_wheel_add(struct timer_wheel *wheel, struct timer *t, uint64_t expires)
+{
+	timer_wheel_del(wheel, t);
+
+	t->expires = expires;
+	timer_wheel_enqueue(wheel, t);
+	wheel->pending++;
+}
+
+void timer_wheel_del(struct timer_wheel *wheel, struct timer *t)
+{
+	if (!timer_pending(t))
+		return;
+
+	list_del(&t->entry);
+	if (t->level == TIMER_LEVEL_EXPIRED)
+		return;
+
+	wheel->pending--;
+	if (list_empty(timer_slot(wheel, t->level, t->slot)))
+		bitmap_clear(timer_bitmap(wheel, t->level), t->slot);
+}
+
+void timer_wheel_advance(struct timer_wheel *wheel, uint64_t now)
+{
+	while (wheel->clk <= now) {
+		int index = wheel->clk & ROOT_MASK;
+
+		/* Skip straight over empty slots.  We only have to stop at a non empty slot or at the
+		 * wrap around, where the coarser wheels get cascaded
+		 */
+		if (index) {
+			int next = timer_wheel_root_next(wheel, index);
+			uint64_t target = wheel->clk - index + (next < 0 ? TIMER_WHEEL_ROOT_SIZE : next);
+			if (target > now) {
+				wheel->clk = now + 1;
+				break;
+			}
+			wheel->clk = target;
+			index = wheel->clk & ROOT_MASK;
+		}
+
+		if (!index) {
+			int level = 1;
+			while (level <= TIMER_WHEEL_LEVELS && timer_wheel_cascade(wheel, level) == 0) {
+				level++;
+			}
+		}
+
+		struct list_head *slot = &wheel->root[index];
+		struct list_head *pos;
+		list_for_each(pos, slot) {
+			list_entry(pos, struct timer, entry)->level = TIMER_LEVEL_EXPIRED;
+			wheel->pending--;
+		}
+		list_splice_tail_init(slot, &wheel->expired);
+		bitmap_clear(wheel->root_bitmap, index);
+
+		wheel->clk++;
+	}
+}
+
+bool timer_wheel_next_event(struct timer_wheel *wheel, uint64_t *tick_out)
+{
+	int index = wheel->clk & ROOT_MASK;
+	int next;
+
+	if (!wheel->pending)
+		return false;
+
+	/* A wrap around is pending, the coarser wheels have to be cascaded first */
+	if (!index) {
+		*tick_out = wheel->clk;
+		return true;
+	}
+
+	next = timer_wheel_root_next(wheel, index);
+	*tick_out = wheel->clk - index + (next < 0 ? TIMER_WHEEL_ROOT_SIZE : next);
+	return true;
+}
+
+struct timer *timer_wheel_pop_expired(struct timer_wheel *wheel)
+{
+	struct timer *t;
+
+	if (list_empty(&wheel->expired))
+		return 0;
+
+	t = list_first_entry(&wheel->expired, struct timer, entry);
+	list_del(&t->entry);
+	return t;
+}
+
+/* Program a one shot for the next tick the kernel wheel cares about */
+static void timer_program_next()
+{
+	uint64_t tick;
+	uint64_t now;
+	uint64_t deadline;
+
+	if (!timer_wheel_next_event(&kernel_wheel, &tick)) {
+		timer_set_oneshot(timer_clock_event()->max_oneshot_ns);
+		return;
+	}
+
+	now = ktime_ns();
+	deadline = tick * TIMER_NSEC_PER_TICK;
+	timer_set_oneshot(deadline > now ? deadline - now : 0);
+}
+
+static void timer_softirq(void *data)
+{
+	timer_run_expired();
+}
+
+/* Interrupt context.  Only moves due timers to the expired list, the softirq runs them */
+static void timer_wheel_event()
+{
+	timer_wheel_advance(&kernel_wheel, timer_jiffies());
+	if (timer_expired_pending())
+		softirq_raise(&timer_work);
+
+	if (tickless)
+		timer_program_next();
+}
+
+void timer_wheel_kernel_init()
+{
+	timer_wheel_init(&kernel_wheel, timer_jiffies());
+	softirq_work_init(&timer_work, timer_softirq, 0);
+	timer_set_event_handler(timer_wheel_event);
+}
+
+void timer_add(struct timer *t, uint64_t expires)
+{
+	uint32_t flags = interrupts_save_disable();
+
+	timer_wheel_add(&kernel_wheel, t, expires);
+	if (tickless)
+		timer_program_next();
+
+	interrupts_restore(flags);
+}
+
+void timer_del(struct timer *t)
+{
+	uint32_t flags = interrupts_save_disable();
+	timer_wheel_del(&kernel_wheel, t);
+	interrupts_restore(flags);
+}
+
+void timer_set_tickless(bool on)
+{
+	uint32_t flags = interrupts_save_disable();
+
+	tickless = on;
+	if (tickless) {
+		timer_program_next();
+	} else {
+		timer_set_periodic();
+	}
+
+	interrupts_restore(flags);
+}
+
+bool timer_expired_pending()
+{
+	return !list_empty(&kernel_wheel.expired);
+}
+
+void timer_run_expired()
+{
+	struct timer *t;
+
+	while (1) {
+		uint32_t flags = interrupts_save_disable();
+		t = timer_wheel_pop_expired(&kernel_wheel);
+		interrupts_restore(flags);
+
+		if (!t)
+			break;
+
+		t->fn(t->data);
+	}
+}
@@ -0,0 +1,107 @@
+/* timer_wheel.h
+ * hashed hierarchical timer wheel (Varghese & Lauck), in the layout of the classic Linux one
+ *
+ * A timer due within the next 256 ticks hashes into a slot of the root wheel.  Timers further out
+ * go into one of four coarser 64 slot wheels and are cascaded down a level whenever the root wheel
+ * wraps around.  Adding and deleting a timer is O(1) regardless of how many timers are pending.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lib/list.h"
+
+#define TIMER_WHEEL_ROOT_BITS	8
+#define TIMER_WHEEL_LEVEL_BITS	6
+#define TIMER_WHEEL_ROOT_SIZE	(1 << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_LEVEL_SIZE	(1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVELS	4			// root + 4 levels cover 2^32 ticks
+
+typedef void (*timer_fn_t)(void *data);
+
+struct timer {
+	struct list_head entry;
+	uint64_t expires;				// tick the timer is due at, see timer_jiffies
+	timer_fn_t fn;
+	void *data;
+	uint8_t level;					// which wheel (0 is root) and slot entry is on
+	uint8_t slot;
+};
+
+struct timer_wheel {
+	uint64_t clk;					// next tick to be processed
+	uint32_t pending;				// timers on the wheel, not counting expired ones
+	struct list_head root[TIMER_WHEEL_ROOT_SIZE];
+	struct list_head levels[TIMER_WHEEL_LEVELS][TIMER_WHEEL_LEVEL_SIZE];
+
+	/* One bit per slot, set when the slot is non empty.  Lets us find the next deadline
+	 * without walking the slots
+	 */
+	uint32_t root_bitmap[TIMER_WHEEL_ROOT_SIZE / 32];
+	uint32_t level_bitmap[TIMER_WHEEL_LEVELS][TIMER_WHEEL_LEVEL_SIZE / 32];
+
+	/* Timers whose tick has passed, waiting for timer_wheel_run_expired */
+	struct list_head expired;
+};
+
+/* Prepare t to call fn(data) once it expires */
+void timer_setup(struct timer *t, timer_fn_t fn, void *data);
+
+/* Returns true if t is armed or expired but not yet run */
+bool timer_pending(struct timer *t);
+
+/* Initialize an empty wheel whose clock starts at tick now */
+void timer_wheel_init(struct timer_wheel *wheel, uint64_t now);
+
+/* Arm t to expire at tick expires.  Already passed ticks expire on the next advance */
+void timer_wheel_add(struct timer_wheel *wheel, struct timer *t, uint64_t expires);
+
+/* Disarm t.  Does nothing if t isn't pending */
+void timer_wheel_del(struct timer_wheel *wheel, struct timer *t);
+
+/* Process every tick up to and including now, moving due timers onto the expired list */
+void timer_wheel_advance(struct timer_wheel *wheel, uint64_t now);
+
+/*
+ * timer_wheel_next_event - earliest tick the wheel needs to see again
+ *
+ * That is either the next non empty root slot or the next time a coarser wheel has to be
+ * cascaded, whichever comes first.  Returns false if nothing is armed
+ */
+bool timer_wheel_next_event(struct timer_wheel *wheel, uint64_t *tick_out);
+
+/* Remove one expired timer, or return 0 if there are none */
+struct timer *timer_wheel_pop_expired(struct timer_wheel *wheel);
+
+/*
+ * The kernel's timer wheel, driven by the timer interrupt
+ */
+
+/* Hook the kernel wheel up to the timer interrupt.  prereq - called timer_init() */
+void timer_wheel_kernel_init();
+
+/* Arm t to expire at tick expires (see timer_jiffies) on the kernel wheel.  Safe from interrupt context */
+void timer_add(struct timer *t, uint64_t expires);
+
+/* Disarm t on the kernel wheel.  Safe from interrupt context */
+void timer_del(struct timer *t);
+
+/*
+ * timer_set_tickless - switch between a periodic tick and tickless operation
+ *
+ * When tickless, the timer interrupt reprograms the tick source as a one shot for the next
+ * tick the wheel actually needs instead of taking every tick
+ */
+void timer_set_tickless(bool tickless);
+
+/* Returns true if timer_run_expired has work to do */
+bool timer_expired_pending();
+
+/* Run the callbacks of every expired timer.  The timer interrupt only moves timers to the
+ * expired list and raises a softirq, which is where they actually run
+ */
+void timer_run_expired();
+
+#endif /* TIMER_WHEEL_H */
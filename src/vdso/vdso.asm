@@ -0,0 +1,91 @@
+section .asm
+
+; User mode half of the vdso.  vdso_init copies everything between vdso_text_start and
+; vdso_text_end into the page every process maps at VDSO_TEXT_ADDRESS, so the code must be
+; position independent: relative jumps and calls only.  The data page is at a fixed address.
+;
+; Both routines follow the C calling convention, only eax, ecx and edx are clobbered.
+
+VDSO_DATA_ADDRESS equ 0x7FFE0000	; VDSO_ADDRESS in config.h
+VDSO_SEQ equ VDSO_DATA_ADDRESS + 0	; fields of struct vdso_data in vdso.h
+VDSO_MULT equ VDSO_DATA_ADDRESS + 4
+VDSO_SHIFT equ VDSO_DATA_ADDRESS + 8
+VDSO_BASE_TSC equ VDSO_DATA_ADDRESS + 16
+VDSO_BASE_NS equ VDSO_DATA_ADDRESS + 24
+NSEC_PER_SEC equ 1000000000
+
+global vdso_text_start
+global vdso_text_end
+
+bits 32
+
+; Entry points at fixed offsets, VDSO_TIME_NS and VDSO_CLOCK_GETTIME in vdso.h
+vdso_text_start:
+	jmp vdso_time_ns
+	times 8 - ($ - vdso_text_start) db 0xcc
+	jmp vdso_clock_gettime
+	times 16 - ($ - vdso_text_start) db 0xcc
+
+; uint64_t time_ns(), in edx:eax
+vdso_time_ns:
+	push ebx
+	push esi
+	push edi
+	push ebp
+
+.retry:
+	mov ebp, [VDSO_SEQ]
+	test ebp, 1
+	jnz .busy			; the timer interrupt is halfway through an update
+
+	; x86 doesn't reorder loads with other loads, so these can't be read before the count
+	rdtsc
+	sub eax, [VDSO_BASE_TSC]
+	sbb edx, [VDSO_BASE_TSC + 4]
+	mov esi, edx			; high half of the delta, 0 unless ticks were skipped
+	mov ecx, [VDSO_SHIFT]
+	mul dword [VDSO_MULT]		; edx:eax = low half * mult
+	shrd eax, edx, cl
+	shr edx, cl
+	test esi, esi
+	jz .add_base
+
+	; (high half * mult) << (32 - shift), the same as mul_u64_u32_shr
+	mov ebx, eax
+	mov edi, edx
+	mov eax, esi
+	mul dword [VDSO_MULT]
+	neg ecx
+	add ecx, 32
+	shld edx, eax, cl
+	shl eax, cl
+	add eax, ebx
+	adc edx, edi
+
+.add_base:
+	add eax, [VDSO_BASE_NS]
+	adc edx, [VDSO_BASE_NS + 4]
+	cmp ebp, [VDSO_SEQ]
+	jne .retry			; the base moved while we read it
+
+	pop ebp
+	pop edi
+	pop esi
+	pop ebx
+	ret
+
+.busy:
+	pause
+	jmp .retry
+
+; int clock_gettime(struct vdso_timespec *ts)
+vdso_clock_gettime:
+	call vdso_time_ns
+	mov ecx, NSEC_PER_SEC
+	div ecx				; eax = seconds, edx = nanoseconds.  Fits for 136 years of uptime
+	mov ecx, [esp + 4]
+	mov [ecx], eax
+	mov [ecx + 4], edx
+	xor eax, eax
+	ret
+vdso_text_end:
@@ -0,0 +1,74 @@
+#include "vdso.h"
+#include "task/process.h"
+#include "memory/vm/vm.h"
+#include "memory/paging/paging.h"
+#include "memory/memory.h"
+#include "memory/heap/kernel_heap.h"
+#include "timer/clock.h"
+#include "cpu/cpu.h"
+#include "kernel.h"
+#include "status.h"
+
+extern uint8_t vdso_text_start[];
+extern uint8_t vdso_text_end[];
+
+static struct vdso_data *vdso_data = 0;
+static uint8_t *vdso_text = 0;
+
+void vdso_update()
+{
+	uint64_t tsc, now_ns, old_ns;
+
+	if (!vdso_data)
+		return;
+
+	/* Only the boot cpu's timer interrupt writes, so writers are serialized already.  The tsc is
+	 * read inside the write section, so no reader that gets the old base saw a later tsc
+	 */
+	write_seqcount_begin(&vdso_data->seq);
+	tsc = read_tsc();
+
+	/* Scaling since boot and scaling since the last base round differently, the new base can
+	 * come out a nanosecond below what readers of the old one got at tsc.  Never go back
+	 */
+	now_ns = cycles_to_ns(tsc - clock_tsc_base());
+	old_ns = vdso_data->base_ns + cycles_to_ns(tsc - vdso_data->base_tsc);
+	vdso_data->base_tsc = tsc;
+	vdso_data->base_ns = now_ns > old_ns ? now_ns : old_ns;
+
+	write_seqcount_end(&vdso_data->seq);
+}
+
+void vdso_init()
+{
+	struct vdso_data *data = kzalloc(PAGING_PAGE_SIZE);
+
+	vdso_text = kzalloc(PAGING_PAGE_SIZE);
+	if (!data || !vdso_text || vdso_text_end - vdso_text_start > PAGING_PAGE_SIZE)
+		panic("vdso_init: can't set up the vdso pages");
+
+	memcpy(vdso_text, vdso_text_start, vdso_text_end - vdso_text_start);
+
+	seqcount_init(&data->seq);
+	data->mult = clock_cycles_to_ns_mult();
+	data->shift = CLOCK_SHIFT;
+	data->base_tsc = clock_tsc_base();	// time 0, where vdso_update carries on from
+	vdso_data = data;
+	vdso_update();
+}
+
+int vdso_map(struct process *process)
+{
+	int res;
+
+	res = vm_area_add(process, VDSO_ADDRESS, VDSO_ADDRESS + VDSO_SIZE, 0, 0, 0);
+	if (res < 0)
+		return res;
+
+	/* Read only, and the pages stay with us when the process goes */
+	res = paging_map_user(process->paging, (void *)VDSO_DATA_ADDRESS, vdso_data, PAGING_SHARED);
+	if (res < 0)
+		return res;
+
+	return paging_map_user(process->paging, (void *)VDSO_TEXT_ADDRESS, vdso_text, PAGING_SHARED);
+}
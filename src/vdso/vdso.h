@@ -0,0 +1,65 @@
+/* vdso.h
+ * time without system calls
+ *
+ * Every process maps two kernel pages read only near the top of its user space.  The data page
+ * at VDSO_DATA_ADDRESS holds the tsc to nanoseconds scale and a base time: the tsc value at the
+ * last timer tick and the nanoseconds since boot it stands for.  The text page at
+ * VDSO_TEXT_ADDRESS holds small user mode routines that read the tsc and scale the cycles since
+ * the base, tens of cycles instead of a trip through the kernel.
+ *
+ * The timer interrupt moves the base forward every tick under a sequence count (seqlock.h),
+ * which keeps the cycle delta within 32 bits, so the scaling is usually a single multiply.
+ * The routines retry if they see a tick's update half done.
+ *
+ * Times are since boot.  There is no real time clock driver, so no wall clock time yet.
+ */
+
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <stdint.h>
+#include "lib/seqlock.h"
+#include "config.h"
+
+#define VDSO_DATA_ADDRESS	VDSO_ADDRESS
+#define VDSO_TEXT_ADDRESS	(VDSO_ADDRESS + 0x1000)
+#define VDSO_SIZE		0x2000
+
+/* Entry points in the text page, both follow the C calling convention:
+ *  uint64_t time_ns()					nanoseconds since boot
+ *  int clock_gettime(struct vdso_timespec *ts)		the same in seconds and nanoseconds, returns 0
+ */
+#define VDSO_TIME_NS		(VDSO_TEXT_ADDRESS + 0)
+#define VDSO_CLOCK_GETTIME	(VDSO_TEXT_ADDRESS + 8)
+
+struct vdso_timespec {
+	uint32_t tv_sec;
+	uint32_t tv_nsec;
+};
+
+/* The data page.  vdso.asm has the offsets too */
+struct vdso_data {
+	seqcount_t seq;
+	uint32_t mult;			// ns = base_ns + ((tsc - base_tsc) * mult >> shift)
+	uint32_t shift;
+	uint32_t pad;
+	uint64_t base_tsc;
+	uint64_t base_ns;
+};
+
+struct process;
+
+/*
+ * vdso_init - fill in the pages every process maps
+ *
+ * prereq - kernel_heap_init() and clock_init()
+ */
+void vdso_init();
+
+/* Map the vdso pages into a new process and reserve their range.  Returns -ENOMEM if out of memory */
+int vdso_map(struct process *process);
+
+/* Move the base time up to now.  Called by the boot cpu's timer interrupt */
+void vdso_update();
+
+#endif /* VDSO_H */